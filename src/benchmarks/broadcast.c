@@ -0,0 +1,205 @@
+/**
+ * \file broadcast.c
+ * \brief Measures the cost of broadcasting a packet to the members of a room.
+ *
+ * Two layouts of the room membership are compared :
+ * - pointers : an array of client pointers with holes left by members who left, each member
+ *   receiving its own copy of the packet (the former Room.clients with outbound_send).
+ * - packed : members packed at the front of an array of outbound paths, all members sharing a
+ *   single copy of the packet (Room.memberOutbounds with outbound_sendToAll).
+ *
+ * Members are stand-ins for clients : their queue sits behind cold data, as the outbound path
+ * does in a Client. Queues are drained between broadcasts, out of the measured time.
+ *
+ * Build with -DBUILD_BENCHMARKS=ON, then run ./BroadcastBenchmark
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../common/atomics.h"
+#include "../common/mpsc-queue.h"
+#include "../common/packets.h"
+#include "../common/timers.h"
+
+/**
+ * \def PUSHES_PER_RUN
+ * \brief Amount of packets queued by a run, whatever the amount of members
+ */
+#define PUSHES_PER_RUN 4000000
+
+/**
+ * \def MEMBER_COLD_BYTES
+ * \brief Size of the client fields not read by a broadcast
+ */
+#define MEMBER_COLD_BYTES 1024
+
+/**
+ * \def HOLE_PERIOD
+ * \brief One slot out of HOLE_PERIOD is left empty in the pointers layout
+ */
+#define HOLE_PERIOD 8
+
+/**
+ * \brief Stand-in for an outbound path
+ */
+struct MemberOutbound {
+    MpscQueue* queue;
+    volatile unsigned int failed;
+    volatile unsigned int closing;
+};
+
+/**
+ * \brief Stand-in for a client
+ */
+struct Member {
+    char cold[MEMBER_COLD_BYTES];
+    struct MemberOutbound outbound;
+};
+
+/**
+ * \brief Stand-in for a queued packet
+ */
+struct QueuedPacket {
+    volatile unsigned int references;
+    Packet packet;
+};
+
+void releasePacket(struct QueuedPacket* queued) {
+    if (atomics_fetchAdd(&queued->references, (unsigned int) -1) == 1) {
+        free(queued);
+    }
+}
+
+/**
+ * \brief Broadcasts through an array of client pointers with holes, copying the packet for each member.
+ */
+void broadcastPointers(struct Member** slots, unsigned int slotCount, Packet* packet) {
+    for (unsigned int i = 0; i < slotCount; i++) {
+        struct Member* member = slots[i];
+        if (member == NULL) {
+            continue;
+        }
+        struct MemberOutbound* outbound = &member->outbound;
+        if (atomics_load(&outbound->failed) || atomics_load(&outbound->closing)) {
+            continue;
+        }
+        struct QueuedPacket* queued = malloc(sizeof(struct QueuedPacket));
+        queued->references = 1;
+        memcpy(&queued->packet, packet, sizeof(Packet));
+        if (!mpsc_push(outbound->queue, queued)) {
+            free(queued);
+        }
+    }
+}
+
+/**
+ * \brief Broadcasts through packed outbound paths, sharing a single copy of the packet.
+ */
+void broadcastPacked(struct MemberOutbound* const* outbounds, unsigned int count, Packet* packet) {
+    struct QueuedPacket* queued = malloc(sizeof(struct QueuedPacket));
+    queued->references = count;
+    memcpy(&queued->packet, packet, packets_sizeOf(packet));
+    for (unsigned int i = 0; i < count; i++) {
+        struct MemberOutbound* outbound = outbounds[i];
+        if (atomics_load(&outbound->failed) || atomics_load(&outbound->closing)
+            || !mpsc_push(outbound->queue, queued)) {
+            releasePacket(queued);
+        }
+    }
+}
+
+/**
+ * \brief Pops and releases all packets queued to the given members, as their writers would.
+ */
+void drain(struct Member** members, unsigned int count) {
+    for (unsigned int i = 0; i < count; i++) {
+        struct QueuedPacket* queued;
+        while ((queued = mpsc_pop(members[i]->outbound.queue)) != NULL) {
+            releasePacket(queued);
+        }
+    }
+}
+
+/**
+ * \brief Runs both layouts with the given amount of members and prints their results.
+ *
+ * \param count The amount of members of the room
+ */
+void benchmark(unsigned int count) {
+    unsigned int slotCount = count + count / (HOLE_PERIOD - 1);
+    struct Member** members = malloc(sizeof(struct Member*) * count);
+    struct Member** slots = malloc(sizeof(struct Member*) * slotCount);
+    struct MemberOutbound** outbounds = malloc(sizeof(struct MemberOutbound*) * count);
+
+    for (unsigned int i = 0; i < count; i++) {
+        members[i] = malloc(sizeof(struct Member));
+        memset(members[i]->cold, 0, MEMBER_COLD_BYTES);
+        members[i]->outbound.queue = mpsc_create(4);
+        members[i]->outbound.failed = 0;
+        members[i]->outbound.closing = 0;
+    }
+
+    /* Members joined in any order : shuffling them so walking the room doesn't walk memory */
+    srand(count);
+    for (unsigned int i = count - 1; i > 0; i--) {
+        unsigned int j = (unsigned int) rand() % (i + 1);
+        struct Member* swapped = members[i];
+        members[i] = members[j];
+        members[j] = swapped;
+    }
+
+    unsigned int member = 0;
+    for (unsigned int i = 0; i < slotCount; i++) {
+        slots[i] = (i % HOLE_PERIOD == HOLE_PERIOD - 1 || member == count) ? NULL : members[member++];
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        outbounds[i] = &members[i]->outbound;
+    }
+
+    Packet packet = NewPacketText;
+    memcpy(packet.asTextPacket.username, "someone", 8);
+    memcpy(packet.asTextPacket.message, "Hello everyone !", 17);
+
+    unsigned int rounds = PUSHES_PER_RUN / count;
+    unsigned long long pointersMicros = 0;
+    unsigned long long packedMicros = 0;
+    for (unsigned int round = 0; round < rounds; round++) {
+        unsigned long long start = timers_nowMicros();
+        broadcastPointers(slots, slotCount, &packet);
+        pointersMicros += timers_nowMicros() - start;
+        drain(members, count);
+
+        start = timers_nowMicros();
+        broadcastPacked(outbounds, count, &packet);
+        packedMicros += timers_nowMicros() - start;
+        drain(members, count);
+    }
+
+    double pushes = (double) rounds * count;
+    printf("%5u members : pointers %7.2f ns/member, packed %7.2f ns/member (x%.2f)\n", count,
+           pointersMicros * 1000.0 / pushes, packedMicros * 1000.0 / pushes,
+           packedMicros ? (double) pointersMicros / (double) packedMicros : 0.0);
+
+    for (unsigned int i = 0; i < count; i++) {
+        mpsc_destroy(members[i]->outbound.queue);
+        free(members[i]);
+    }
+    free(outbounds);
+    free(slots);
+    free(members);
+}
+
+/**
+ * \brief Program entry.
+ *
+ * \return EXIT_SUCCESS - normal program termination.
+ */
+int main() {
+    unsigned int memberCounts[] = {16, 256, 1024, 4096};
+    for (int i = 0; i < 4; i++) {
+        benchmark(memberCounts[i]);
+    }
+
+    return EXIT_SUCCESS;
+}
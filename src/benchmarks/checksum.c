@@ -0,0 +1,93 @@
+/**
+ * \file checksum.c
+ * \brief Measures the cost of checksumming file data as it is received.
+ *
+ * File data is received by chunks of FILE_TRANSFER_CHUNK_SIZE bytes, each copied to the buffer of
+ * the file. This compares copying the chunks of a file alone, copying them while updating the
+ * checksum of the file, and checksumming the whole file at once as a resumed upload does.
+ *
+ * Build with -DBUILD_BENCHMARKS=ON, then run ./ChecksumBenchmark
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../common/constants.h"
+#include "../common/crc32c.h"
+#include "../common/timers.h"
+
+/**
+ * \def FILE_BYTES
+ * \brief Size of the checksummed file
+ */
+#define FILE_BYTES (64 * 1024 * 1024)
+
+/**
+ * \def ROUNDS
+ * \brief Amount of times the file is processed
+ */
+#define ROUNDS 8
+
+/**
+ * \brief Prints the throughput of a benchmark.
+ *
+ * \param name The name of the benchmark
+ * \param elapsed The time the benchmark took (microseconds)
+ */
+void printThroughput(const char* name, unsigned long long elapsed) {
+    double bytes = (double) FILE_BYTES * ROUNDS;
+    printf("%-22s : %8.1f MB/s\n", name, bytes / (elapsed > 0 ? elapsed : 1));
+}
+
+/**
+ * \brief Program entry.
+ *
+ * \return EXIT_SUCCESS - normal program termination.
+ */
+int main() {
+    crc32c_init();
+    printf("CRC32C computed by the %s\n", crc32c_isAccelerated() ? "processor (SSE4.2)" : "software version");
+
+    char* source = malloc(FILE_BYTES);
+    char* destination = malloc(FILE_BYTES);
+    for (unsigned int i = 0; i < FILE_BYTES; i++) {
+        source[i] = (char) (i * 2654435761u >> 24);
+    }
+    memset(destination, 0, FILE_BYTES);
+
+    unsigned int checksums = 0;
+    unsigned long long start = timers_nowMicros();
+    for (int round = 0; round < ROUNDS; round++) {
+        for (unsigned int offset = 0; offset < FILE_BYTES; offset += FILE_TRANSFER_CHUNK_SIZE) {
+            unsigned int chunk = FILE_BYTES - offset < FILE_TRANSFER_CHUNK_SIZE ? FILE_BYTES - offset : FILE_TRANSFER_CHUNK_SIZE;
+            memcpy(destination + offset, source + offset, chunk);
+        }
+        checksums += (unsigned char) destination[round];
+    }
+    printThroughput("copy", timers_nowMicros() - start);
+
+    start = timers_nowMicros();
+    for (int round = 0; round < ROUNDS; round++) {
+        unsigned int crc = 0;
+        for (unsigned int offset = 0; offset < FILE_BYTES; offset += FILE_TRANSFER_CHUNK_SIZE) {
+            unsigned int chunk = FILE_BYTES - offset < FILE_TRANSFER_CHUNK_SIZE ? FILE_BYTES - offset : FILE_TRANSFER_CHUNK_SIZE;
+            memcpy(destination + offset, source + offset, chunk);
+            crc = crc32c_update(crc, destination + offset, chunk);
+        }
+        checksums += crc;
+    }
+    printThroughput("copy and checksum", timers_nowMicros() - start);
+
+    start = timers_nowMicros();
+    for (int round = 0; round < ROUNDS; round++) {
+        checksums += crc32c_update(0, source, FILE_BYTES);
+    }
+    printThroughput("checksum at once", timers_nowMicros() - start);
+
+    /* Printed so the computations aren't optimized away */
+    printf("(%u)\n", checksums);
+
+    free(source);
+    free(destination);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,224 @@
+/**
+ * \file queues.c
+ * \brief Measures the throughput of the lock-free queues against a mutex-protected queue.
+ *
+ * Producers push ITEMS_PER_PRODUCER items each while a consumer pops them all. Producers retry
+ * when the queue is full, the consumer parks on a notifier when it's empty, as the outbound
+ * writer does.
+ *
+ * Build with -DBUILD_BENCHMARKS=ON, then run ./QueuesBenchmark
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "../common/spsc-queue.h"
+#include "../common/mpsc-queue.h"
+#include "../common/notifier.h"
+#include "../common/synchronization.h"
+#include "../common/threads.h"
+#include "../common/timers.h"
+
+/**
+ * \def ITEMS_PER_PRODUCER
+ * \brief Amount of items pushed by each producer
+ */
+#define ITEMS_PER_PRODUCER 1000000 // MUST stay below 2^24
+
+/**
+ * \def QUEUE_CAPACITY
+ * \brief Capacity of the benchmarked queues
+ */
+#define QUEUE_CAPACITY 1024
+
+/**
+ * \def MAX_PRODUCERS
+ * \brief Maximum amount of producer threads
+ */
+#define MAX_PRODUCERS 8
+
+/**
+ * \brief The queue implementations under test
+ */
+enum QueueKind {
+    SPSC_QUEUE,
+    MPSC_QUEUE,
+    MUTEX_QUEUE,
+};
+
+/**
+ * \brief A ring buffer protected by a mutex, the baseline
+ */
+struct MutexQueue {
+    void** slots;
+    unsigned int capacity;
+    unsigned int head;
+    unsigned int size;
+    Mutex lock;
+};
+
+/**
+ * \brief State shared by the threads of a run
+ */
+struct Run {
+    enum QueueKind kind;
+    SpscQueue* spsc;
+    MpscQueue* mpsc;
+    struct MutexQueue mutexQueue;
+    Notifier notifier;
+};
+
+/**
+ * \brief Data of a producer thread
+ */
+struct Producer {
+    struct Run* run;
+    unsigned int index;
+};
+
+int mutexQueue_push(struct MutexQueue* queue, void* item) {
+    acquireMutex(&queue->lock);
+    int pushed = queue->size < queue->capacity;
+    if (pushed) {
+        queue->slots[(queue->head + queue->size) % queue->capacity] = item;
+        queue->size++;
+    }
+    releaseMutex(&queue->lock);
+    return pushed;
+}
+
+void* mutexQueue_pop(struct MutexQueue* queue) {
+    void* item = NULL;
+    acquireMutex(&queue->lock);
+    if (queue->size > 0) {
+        item = queue->slots[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->size--;
+    }
+    releaseMutex(&queue->lock);
+    return item;
+}
+
+int push(struct Run* run, void* item) {
+    switch (run->kind) {
+        case SPSC_QUEUE:
+            return spsc_push(run->spsc, item);
+        case MPSC_QUEUE:
+            return mpsc_push(run->mpsc, item);
+        default:
+            return mutexQueue_push(&run->mutexQueue, item);
+    }
+}
+
+void* pop(struct Run* run) {
+    switch (run->kind) {
+        case SPSC_QUEUE:
+            return spsc_pop(run->spsc);
+        case MPSC_QUEUE:
+            return mpsc_pop(run->mpsc);
+        default:
+            return mutexQueue_pop(&run->mutexQueue);
+    }
+}
+
+THREAD_ENTRY_POINT producerThread(void* data) {
+    struct Producer* producer = data;
+    /* Items encode the producer index and a sequence number, never NULL */
+    uintptr_t base = ((uintptr_t) producer->index << 24) + 1;
+    for (uintptr_t i = 0; i < ITEMS_PER_PRODUCER; i++) {
+        while (!push(producer->run, (void*) (base + i))) {
+            /* Queue full, letting the consumer run */
+            threadSleep(0);
+        }
+        notifier_notify(&producer->run->notifier);
+    }
+    return 0;
+}
+
+/**
+ * \brief Runs a benchmark and prints its results.
+ *
+ * \param name The name of the benchmark
+ * \param kind The queue to use
+ * \param producers The amount of producer threads
+ */
+void benchmark(const char* name, enum QueueKind kind, unsigned int producers) {
+    struct Run run;
+    run.kind = kind;
+    run.spsc = spsc_create(QUEUE_CAPACITY);
+    run.mpsc = mpsc_create(QUEUE_CAPACITY);
+    run.mutexQueue.slots = malloc(sizeof(void*) * QUEUE_CAPACITY);
+    run.mutexQueue.capacity = QUEUE_CAPACITY;
+    run.mutexQueue.head = 0;
+    run.mutexQueue.size = 0;
+    initMutex(&run.mutexQueue.lock);
+    notifier_init(&run.notifier);
+
+    struct Producer producerData[MAX_PRODUCERS];
+    Thread threads[MAX_PRODUCERS];
+
+    unsigned long long start = timers_nowMicros();
+    for (unsigned int i = 0; i < producers; i++) {
+        producerData[i].run = &run;
+        producerData[i].index = i;
+        threads[i] = createThread(producerThread, &producerData[i]);
+    }
+
+    unsigned long long total = (unsigned long long) ITEMS_PER_PRODUCER * producers;
+    unsigned long long expected[MAX_PRODUCERS] = {0};
+    unsigned long long received = 0;
+    unsigned long long parks = 0;
+    int ordered = 1;
+    while (received < total) {
+        void* item = pop(&run);
+        if (item == NULL) {
+            notifier_prepareWait(&run.notifier);
+            if ((item = pop(&run)) == NULL) {
+                notifier_wait(&run.notifier);
+                parks++;
+                continue;
+            }
+            notifier_cancelWait(&run.notifier);
+        }
+
+        /* Items of a producer must come out in the order they were pushed */
+        uintptr_t value = (uintptr_t) item - 1;
+        unsigned int producer = (unsigned int) (value >> 24);
+        ordered &= (value & 0xFFFFFFu) == expected[producer];
+        expected[producer]++;
+        received++;
+    }
+    unsigned long long elapsed = timers_nowMicros() - start;
+
+    for (unsigned int i = 0; i < producers; i++) {
+        joinThread(&threads[i]);
+    }
+
+    printf("%-24s %u producer(s) : %8.2f M items/s, %llu parks%s\n", name, producers,
+           (double) total / (double) elapsed, parks, ordered ? "" : " (ORDER VIOLATED)");
+
+    notifier_destroy(&run.notifier);
+    destroyMutex(&run.mutexQueue.lock);
+    free(run.mutexQueue.slots);
+    mpsc_destroy(run.mpsc);
+    spsc_destroy(run.spsc);
+}
+
+/**
+ * \brief Program entry.
+ *
+ * \return EXIT_SUCCESS - normal program termination.
+ */
+int main() {
+    benchmark("SPSC lock-free", SPSC_QUEUE, 1);
+    benchmark("MPSC lock-free", MPSC_QUEUE, 1);
+    benchmark("Mutex", MUTEX_QUEUE, 1);
+
+    unsigned int producerCounts[] = {2, 4, 8};
+    for (int i = 0; i < 3; i++) {
+        benchmark("MPSC lock-free", MPSC_QUEUE, producerCounts[i]);
+        benchmark("Mutex", MUTEX_QUEUE, producerCounts[i]);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,148 @@
+/**
+ * \file relay.c
+ * \brief Measures the relay path : packets received on a socket and sent to the members of a room.
+ *
+ * A sender pushes PACKETS text messages to the relay through a loopback connection. The relay
+ * receives each packet and sends it to MEMBERS connections, as a room broadcast does, while a
+ * thread per member drains its connection. Only the sockets and threads API is used, so the
+ * benchmark builds against any version of these primitives.
+ *
+ * Build with -DBUILD_BENCHMARKS=ON, then run ./RelayBenchmark [port]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../common/packets.h"
+#include "../common/sockets.h"
+#include "../common/threads.h"
+#include "../common/timers.h"
+
+/**
+ * \def PACKETS
+ * \brief Amount of packets relayed by a run
+ */
+#define PACKETS 200000
+
+/**
+ * \def MEMBERS
+ * \brief Amount of connections each packet is relayed to
+ */
+#define MEMBERS 4
+
+/**
+ * \def RUNS
+ * \brief Amount of runs, the best one is kept
+ */
+#define RUNS 5
+
+/**
+ * \brief A member connection, drained by its own thread
+ */
+struct Member {
+    Socket serverSide;
+    Socket clientSide;
+    unsigned long long expected;
+};
+
+/**
+ * \brief The relay connections
+ */
+struct Relay {
+    Socket source;
+    struct Member members[MEMBERS];
+};
+
+THREAD_ENTRY_POINT memberThread(void* data) {
+    struct Member* member = data;
+    char buffer[16384];
+    unsigned long long received = 0;
+    while (received < member->expected) {
+        int bytes = receiveFrom(member->clientSide, buffer, sizeof(buffer));
+        if (bytes <= 0) {
+            break;
+        }
+        received += bytes;
+    }
+    return 0;
+}
+
+THREAD_ENTRY_POINT relayThread(void* data) {
+    struct Relay* relay = data;
+    Packet packet;
+    for (int i = 0; i < PACKETS; i++) {
+        if (receiveNextPacket(relay->source, &packet) <= 0) {
+            break;
+        }
+        unsigned int size = packets_sizeOf(&packet);
+        for (int j = 0; j < MEMBERS; j++) {
+            sendTo(relay->members[j].serverSide, (char*) &packet, size);
+        }
+    }
+    return 0;
+}
+
+/**
+ * \brief Relays PACKETS packets and returns the elapsed time in microseconds.
+ */
+unsigned long long run(Socket server, const char* port) {
+    Socket sender = createClientSocket("127.0.0.1", port);
+    struct Relay relay;
+    relay.source = acceptClient(server);
+
+    Packet packet = NewPacketText;
+    memcpy(packet.asTextPacket.username, "someone", 8);
+    memcpy(packet.asTextPacket.message, "Hello everyone !", 17);
+    unsigned int size = packets_sizeOf(&packet);
+
+    Thread members[MEMBERS];
+    for (int i = 0; i < MEMBERS; i++) {
+        relay.members[i].clientSide = createClientSocket("127.0.0.1", port);
+        relay.members[i].serverSide = acceptClient(server);
+        relay.members[i].expected = (unsigned long long) size * PACKETS;
+        members[i] = createThread(memberThread, &relay.members[i]);
+    }
+
+    unsigned long long start = timers_nowMicros();
+    Thread relayer = createThread(relayThread, &relay);
+    for (int i = 0; i < PACKETS; i++) {
+        sendTo(sender, (char*) &packet, size);
+    }
+    joinThread(&relayer);
+    for (int i = 0; i < MEMBERS; i++) {
+        joinThread(&members[i]);
+    }
+    unsigned long long elapsed = timers_nowMicros() - start;
+
+    for (int i = 0; i < MEMBERS; i++) {
+        closeSocket(&relay.members[i].clientSide);
+        closeSocket(&relay.members[i].serverSide);
+    }
+    closeSocket(&relay.source);
+    closeSocket(&sender);
+    return elapsed;
+}
+
+/**
+ * \brief Program entry.
+ *
+ * \return EXIT_SUCCESS - normal program termination.
+ */
+int main(int argc, char** argv) {
+    const char* port = argc > 1 ? argv[1] : "27016";
+    Socket server = createServerSocket(port);
+
+    unsigned long long best = 0;
+    for (int i = 0; i < RUNS; i++) {
+        unsigned long long elapsed = run(server, port);
+        if (best == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    printf("Relayed %d packets to %d members : %.2f us/packet (best of %d runs)\n",
+           PACKETS, MEMBERS, (double) best / PACKETS, RUNS);
+
+    closeSocket(&server);
+    cleanUp();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,148 @@
+/**
+ * \file slab.c
+ * \brief Measures connection churn on the slab allocator against malloc.
+ *
+ * Each thread keeps LIVE_OBJECTS objects the size of a client, and replaces a random one of them
+ * REPLACEMENTS_PER_THREAD times : it releases it and allocates a new one, writing its first bytes
+ * as a client initialization would. Replaced objects are handed to the next thread half of the
+ * time, so objects are also released by another thread than the one which allocated them, as
+ * clients allocated by the accept loop and released by their own thread.
+ *
+ * Build with -DBUILD_BENCHMARKS=ON, then run ./SlabBenchmark
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../common/slab.h"
+#include "../common/threads.h"
+#include "../common/timers.h"
+
+/**
+ * \def OBJECT_SIZE
+ * \brief Size of the allocated objects, about the size of a client
+ */
+#define OBJECT_SIZE 1200
+
+/**
+ * \def LIVE_OBJECTS
+ * \brief Amount of objects kept by each thread
+ */
+#define LIVE_OBJECTS 256
+
+/**
+ * \def REPLACEMENTS_PER_THREAD
+ * \brief Amount of objects released and allocated by each thread
+ */
+#define REPLACEMENTS_PER_THREAD 2000000
+
+/**
+ * \def MAX_THREADS
+ * \brief Maximum amount of threads
+ */
+#define MAX_THREADS 8
+
+/**
+ * \brief Data of a thread
+ */
+struct Worker {
+    /** NULL to use malloc */
+    Slab* slab;
+    unsigned int seed;
+    void* objects[LIVE_OBJECTS];
+};
+
+void* allocate(Slab* slab) {
+    void* object = slab ? slab_alloc(slab) : malloc(OBJECT_SIZE);
+    memset(object, 0, 64);
+    return object;
+}
+
+void release(Slab* slab, void* object) {
+    if (slab) {
+        slab_free(slab, object);
+    } else {
+        free(object);
+    }
+}
+
+THREAD_ENTRY_POINT workerThread(void* data) {
+    struct Worker* worker = data;
+    for (unsigned int i = 0; i < REPLACEMENTS_PER_THREAD; i++) {
+        worker->seed = worker->seed * 1103515245 + 12345;
+        unsigned int index = (worker->seed >> 16) % LIVE_OBJECTS;
+        release(worker->slab, worker->objects[index]);
+        worker->objects[index] = allocate(worker->slab);
+    }
+    return 0;
+}
+
+/**
+ * \brief Runs a benchmark and prints its results.
+ *
+ * \param name The name of the allocator
+ * \param slab The slab to use, NULL to use malloc
+ * \param threadCount The amount of threads
+ */
+void benchmark(const char* name, Slab* slab, unsigned int threadCount) {
+    struct Worker workers[MAX_THREADS];
+    Thread threads[MAX_THREADS];
+
+    for (unsigned int i = 0; i < threadCount; i++) {
+        workers[i].slab = slab;
+        workers[i].seed = i + 1;
+        for (unsigned int j = 0; j < LIVE_OBJECTS; j++) {
+            workers[i].objects[j] = allocate(slab);
+        }
+    }
+    /* Half of the objects of each thread were allocated by the previous thread */
+    for (unsigned int i = 0; i < threadCount; i++) {
+        struct Worker* next = &workers[(i + 1) % threadCount];
+        for (unsigned int j = 0; j < LIVE_OBJECTS; j += 2) {
+            void* swapped = workers[i].objects[j];
+            workers[i].objects[j] = next->objects[j + 1];
+            next->objects[j + 1] = swapped;
+        }
+    }
+
+    unsigned long long start = timers_nowMicros();
+    for (unsigned int i = 0; i < threadCount; i++) {
+        threads[i] = createThread(workerThread, &workers[i]);
+    }
+    for (unsigned int i = 0; i < threadCount; i++) {
+        joinThread(&threads[i]);
+    }
+    unsigned long long elapsed = timers_nowMicros() - start;
+
+    for (unsigned int i = 0; i < threadCount; i++) {
+        for (unsigned int j = 0; j < LIVE_OBJECTS; j++) {
+            release(slab, workers[i].objects[j]);
+        }
+    }
+
+    double operations = (double) REPLACEMENTS_PER_THREAD * threadCount;
+    printf("%-6s %u thread(s) : %7.2f ns/replacement", name, threadCount, elapsed * 1000.0 / operations);
+    if (slab) {
+        SlabStats stats;
+        slab_stats(slab, &stats);
+        printf(", %u pages for %u objects", stats.pages, threadCount * LIVE_OBJECTS);
+    }
+    printf("\n");
+}
+
+/**
+ * \brief Program entry.
+ *
+ * \return EXIT_SUCCESS - normal program termination.
+ */
+int main() {
+    unsigned int threadCounts[] = {1, 4, 8};
+    for (int i = 0; i < 3; i++) {
+        benchmark("malloc", NULL, threadCounts[i]);
+        Slab* slab = slab_create(OBJECT_SIZE);
+        benchmark("slab", slab, threadCounts[i]);
+        slab_destroy(slab);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -18,11 +18,19 @@
 #include <stdio.h>
 #include "file-transfer.h"
 #include "room.h"
+#include "../common/crc32c.h"
 
 Socket clientSocket;
+Outbound serverOutbound;
 struct UploadData uploadData[MAX_CONCURRENT_FILE_TRANSFER];
+volatile BitmapWord uploadSlots[BITMAP_WORDS(MAX_CONCURRENT_FILE_TRANSFER)] = {0};
+Throttle uploadThrottle;
 struct DownloadData downloadData[MAX_CONCURRENT_FILE_TRANSFER];
 
+int sendToServer(Packet* packet) {
+    return outbound_send(&serverOutbound, packet, OUTBOUND_PRIORITY_CONTROL);
+}
+
 THREAD_ENTRY_POINT sendMessage(void* data) {
     Packet packet = NewPacketText;
     while(1) {
@@ -30,7 +38,7 @@ THREAD_ENTRY_POINT sendMessage(void* data) {
         if (strncmp("/", packet.asTextPacket.message, 1) == 0) { // Is a command
             commandHandler(packet.asTextPacket.message + 1);
         } else {
-            sendPacket(clientSocket, &packet);
+            sendToServer(&packet);
         }
     }
 }
@@ -59,15 +67,25 @@ COMMAND(file, "Usage: /file <send | receive>",
                 return;
             }
         )
+        COMMAND(stats, "Usage: /stats",
+            requestStats();
+            return;
+        )
         COMMAND(quit, "Usage: /quit",
             Packet quitPacket = NewPacketQuit;
-            sendPacket(clientSocket, &quitPacket);
+            sendToServer(&quitPacket);
             return;
         )
-        COMMAND(room, "Usage: /room <create | join | leave | list>",
+        COMMAND(room, "Usage: /room <create | large | join | leave | list>",
             COMMAND(create, "Usage: /room create <name> <description>",
                     if(strlen(command) > 0) {
-                        createRoom(command);
+                        createRoom(command, 0);
+                        return;
+                    }
+                )
+                COMMAND(large, "Usage: /room large <name> <description>",
+                    if(strlen(command) > 0) {
+                        createRoom(command, 1);
                         return;
                     }
                 )
@@ -122,9 +140,19 @@ void receiveMessages() {
                 case FILE_TRANSFER_CANCEL_MESSAGE_TYPE:
                     handleFileDownloadCancel(&packet.asFileTransferCancelPacket);
                     break;
+                case FILE_DATA_ACK_MESSAGE_TYPE:
+                    handleFileDataAck(&packet.asFileDataAckPacket);
+                    break;
+                case FILE_BLOCK_PROOF_MESSAGE_TYPE:
+                    handleFileBlockProof(&packet.asFileBlockProofPacket);
+                    break;
                 case SERVER_SUCCESS_MESSAGE_TYPE:
                     ui_successMessage(packet.asServerSuccessMessagePacket.message);
                     break;
+                case PING_MESSAGE_TYPE:
+                    packet.type = PONG_MESSAGE_TYPE; // A pong echoes the ping sequence
+                    sendToServer(&packet);
+                    break;
             }
         }
     } while (bytesCount > 0);
@@ -134,7 +162,8 @@ void pickUsername() {
     int success = 0;
     do {
         char username[50];
-        ui_getUserInput("Your username : ", username, 20);
+        /* Long enough for a spectate request (see SPECTATE_HANDSHAKE_PREFIX) */
+        ui_getUserInput("Your username : ", username, sizeof(SPECTATE_HANDSHAKE_PREFIX) + ROOM_NAME_MAX_LENGTH + 1);
         int bytesReceived = sendTo(clientSocket, username, strlen(username));
 
         if (bytesReceived < 0) {
@@ -171,7 +200,12 @@ void setUsername(const char* newUsername) {
 
     Packet packet = NewPacketDefineUsername;
     memcpy(packet.asDefineUsernamePacket.username, newUsername, userNameLength + 1);
-    sendPacket(clientSocket, &packet);
+    sendToServer(&packet);
+}
+
+void requestStats() {
+    Packet packet = NewPacketStatsRequest;
+    sendToServer(&packet);
 }
 
 /**
@@ -183,15 +217,19 @@ int main() {
     /* Initialize upload data */
     for (int i = 0; i < MAX_CONCURRENT_FILE_TRANSFER; i++) {
         uploadData[i].uploadFilename = NULL;
+        uploadData[i].ackEvent = createEvent();
         downloadData[i].downloadBuffer = NULL;
         downloadData[i].downloadFileId = 0;
     }
+    throttle_init(&uploadThrottle, UPLOAD_BYTES_PER_SECOND, UPLOAD_BURST_BYTES);
+    crc32c_init();
 
     ui_init();
     clientSocket = createClientSocket("127.0.0.1", "27015");
     ui_informationMessage("Hi, you're connected to server !");
 
     pickUsername();
+    outbound_init(&serverOutbound, clientSocket);
     ui_welcomeMessage();
 
     Thread senderThread = createThread(sendMessage, NULL);
@@ -199,12 +237,15 @@ int main() {
     receiveMessages();
 
     destroyThread(&senderThread);
+    saveDownloads();
 
     ui_reset();
 
     ui_informationMessage("End of chat.");
     ui_cleanUp();
 
+    shutdownSocket(clientSocket);
+    outbound_destroy(&serverOutbound);
     closeSocket(&clientSocket);
     cleanUp();
     return EXIT_SUCCESS;
@@ -9,26 +9,135 @@
 #include "../common/threads.h"
 #include "../common/sockets.h"
 #include "../common/constants.h"
+#include "../common/outbound.h"
+#include "../common/bitmap.h"
+#include "../common/throttle.h"
+#include "../common/hash-tree.h"
+#include "../common/synchronization.h"
+
+#ifndef UPLOAD_BYTES_PER_SECOND
+/**
+ * \def UPLOAD_BYTES_PER_SECOND
+ * \brief Bandwidth of the uploads (bytes per second), 0 not to limit it
+ *
+ * Staying below the file data rate limit of the server, which slows down the whole connection once exceeded.
+ */
+#define UPLOAD_BYTES_PER_SECOND 3000000
+#endif
+
+/**
+ * \def UPLOAD_BURST_BYTES
+ * \brief Amount of bytes of uploads sent at once when the bandwidth wasn't used for a while
+ */
+#define UPLOAD_BURST_BYTES 65536
+
+#ifndef UPLOAD_READ_BYTES
+/**
+ * \def UPLOAD_READ_BYTES
+ * \brief Size of the buffer uploaded files are read by (bytes)
+ *
+ * MUST be a multiple of FILE_TRANSFER_CHUNK_SIZE : the server expects full chunks of data but the last one.
+ */
+#define UPLOAD_READ_BYTES (256 * FILE_TRANSFER_CHUNK_SIZE)
+#endif
 
 struct UploadData {
     char* uploadFilename;
     Thread uploadThread;
+    /* Token the server gave the upload, kept in "<filename>.resume" to resume it after a disconnection */
+    unsigned long long resumeToken;
+    /* Amount of bytes the server already has */
+    long long offset;
+    unsigned int fileId;
+    /* Size of the file when requesting the upload, it's read as it's sent */
+    long long size;
+    /* Amount of bytes the server acknowledged (see FILE_TRANSFER_WINDOW_BYTES) */
+    volatile unsigned long long acked;
+    /* Signaled when the server acknowledges data */
+    Event ackEvent;
+};
+
+#ifndef DOWNLOAD_STREAMS
+/**
+ * \def DOWNLOAD_STREAMS
+ * \brief Amount of ranges of a file downloaded at once
+ *
+ * The server sends at most MAX_DOWNLOAD_STREAMS ranges at once to a client, it queues the other ones.
+ */
+#define DOWNLOAD_STREAMS 4
+#endif
+
+#ifndef DOWNLOAD_RANGE_BYTES
+/**
+ * \def DOWNLOAD_RANGE_BYTES
+ * \brief Size of the ranges files are downloaded by (bytes)
+ */
+#define DOWNLOAD_RANGE_BYTES 1000000
+#endif
+
+struct DownloadRange {
+    /* Offset of the range in the file, -1 if the stream is free */
+    long long offset;
+    /* Offset following the range */
+    long long end;
+    long long received;
+    /* Amount of received bytes acknowledged to the server */
+    long long acked;
+};
+
+struct DownloadBlock {
+    /* Amount of received bytes of the block */
+    unsigned int received;
+    /* Hash of the block, once proven by the server */
+    TreeHash hash;
+    char proven;
 };
 
 struct DownloadData {
+    /* Allocated once the size of the file is known */
     char* downloadBuffer;
     long long downloadFileSize;
     long long downloadedSize;
+    /* 0 if the slot is free */
     unsigned int downloadFileId;
+    /* Amount of bytes of the file received before a disconnection */
+    long long resumedSize;
+    /* Offset of the next range to request */
+    long long nextRange;
+    struct DownloadRange ranges[DOWNLOAD_STREAMS];
+    /* Root of the hash tree of the file, blocks are checked against it as they're received */
+    TreeHash rootHash;
+    unsigned int blockCount;
+    /* Proof being received, its packets follow each other */
+    unsigned int proofBlock;
+    unsigned int proofReceived;
+    TreeHash proofHash;
+    TreeHash proofSiblings[HASH_TREE_MAX_DEPTH];
+    /* Allocated with the buffer */
+    struct DownloadBlock* blocks;
 };
 
 extern Socket clientSocket;
+/* The path packets are sent to the server through, once the username is picked */
+extern Outbound serverOutbound;
 /* Upload */
 extern struct UploadData uploadData[MAX_CONCURRENT_FILE_TRANSFER]; // TODO: Sync access
+/* Taken slots of uploadData, taken by the input thread and freed by the receiving and upload threads */
+extern volatile BitmapWord uploadSlots[BITMAP_WORDS(MAX_CONCURRENT_FILE_TRANSFER)];
+/* Bandwidth shared by the uploads */
+extern Throttle uploadThrottle;
 /* Download */
 extern struct DownloadData downloadData[MAX_CONCURRENT_FILE_TRANSFER]; // TODO: Sync access
 
 
+/**
+ * \brief Sends a packet to the server with control priority
+ *
+ * \param packet The packet to send
+ * \return 1 if the packet was accepted, -1 if the connection with the server failed
+ */
+int sendToServer(Packet* packet);
+
 /**
  * \brief An entry point for a thread that gets user input and send it to server
  *
@@ -60,4 +169,9 @@ void commandHandler(const char* command);
  */
 void setUsername(const char* username);
 
+/**
+ * \brief Asks the server for its statistics
+ */
+void requestStats();
+
 #endif //C_CHAT_CLIENT_H
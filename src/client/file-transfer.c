@@ -4,15 +4,13 @@
 #include <stdlib.h>
 #include "client.h"
 #include "../common/files.h"
+#include "../common/atomics.h"
+#include "../common/crc32c.h"
+#include "../common/hash-tree.h"
 #include <string.h>
 
 int findFirstFreeUploadIndex() {
-    int i = 0;
-    while (i < MAX_CONCURRENT_FILE_TRANSFER && uploadData[i].uploadFilename != NULL) {
-        i++;
-    }
-
-    return i == MAX_CONCURRENT_FILE_TRANSFER ? -1 : i;
+    return bitmap_acquireShared(uploadSlots, MAX_CONCURRENT_FILE_TRANSFER);
 }
 
 int findFirstTakenUploadIndex() {
@@ -26,22 +24,243 @@ int findFirstTakenUploadIndex() {
 
 int findFirstFreeDownloadIndex() {
     int i = 0;
-    while (i < MAX_CONCURRENT_FILE_TRANSFER && downloadData[i].downloadBuffer != NULL) {
+    while (i < MAX_CONCURRENT_FILE_TRANSFER && downloadData[i].downloadFileId != 0) {
         i++;
     }
 
     return i == MAX_CONCURRENT_FILE_TRANSFER ? -1 : i;
 }
 
+/**
+ * \brief Formats the name of the file keeping the resume token of the given upload.
+ *
+ * \return the name, to free
+ */
+char* resumeFilenameFor(const char* filename) {
+    char* resumeFilename = malloc(strlen(filename) + 8);
+    sprintf(resumeFilename, "%s.resume", filename);
+    return resumeFilename;
+}
+
+/**
+ * \brief Reads the token of the interrupted upload of the given file.
+ *
+ * \return the token, or 0 if the upload of the file wasn't interrupted
+ */
+unsigned long long readResumeToken(const char* filename) {
+    char* resumeFilename = resumeFilenameFor(filename);
+    FileInfo info = files_getInfo(resumeFilename);
+    unsigned long long token = 0;
+    char content[21] = {0};
+    if (info.exists && !info.isDirectory && info.size < (long long) sizeof(content)
+        && files_readFile(resumeFilename, content, info.size) == (unsigned long) info.size) {
+        token = strtoull(content, NULL, 10);
+    }
+    free(resumeFilename);
+    return token;
+}
+
+/**
+ * \brief Keeps the token of the upload of the given file, so it can be resumed after a disconnection.
+ */
+void writeResumeToken(const char* filename, unsigned long long token) {
+    char* resumeFilename = resumeFilenameFor(filename);
+    char content[21];
+    int length = sprintf(content, "%llu", token);
+    files_writeFile(resumeFilename, content, length);
+    free(resumeFilename);
+}
+
+/**
+ * \brief Formats the name of the file keeping the received part of the download of the given file.
+ */
+void formatPartName(unsigned int fileId, char* buffer) {
+    sprintf(buffer, "r%u.part", fileId);
+}
+
 int findDownloadIdFor(unsigned int fileId) {
     int i = 0;
-    while (i < MAX_CONCURRENT_FILE_TRANSFER && (downloadData[i].downloadBuffer == NULL || downloadData[i].downloadFileId != fileId)) {
+    while (i < MAX_CONCURRENT_FILE_TRANSFER && downloadData[i].downloadFileId != fileId) {
         i++;
     }
 
     return i == MAX_CONCURRENT_FILE_TRANSFER ? -1 : i;
 }
 
+/**
+ * \brief Finds the range of the given download containing the given offset.
+ *
+ * \return the index of the range, or -1 if no requested range contains it
+ */
+int findRangeFor(struct DownloadData* download, long long offset) {
+    int i = 0;
+    while (i < DOWNLOAD_STREAMS && (download->ranges[i].offset == -1 || offset < download->ranges[i].offset || offset >= download->ranges[i].end)) {
+        i++;
+    }
+
+    return i == DOWNLOAD_STREAMS ? -1 : i;
+}
+
+/**
+ * \brief Requests the next range of the given download, if a stream is free.
+ *
+ * \return 1 if a range was requested, else 0
+ */
+int requestNextRange(struct DownloadData* download) {
+    if (download->downloadFileSize >= 0 && download->nextRange >= download->downloadFileSize) {
+        /* The whole file is requested */
+        return 0;
+    }
+
+    int rangeId = 0;
+    while (rangeId < DOWNLOAD_STREAMS && download->ranges[rangeId].offset != -1) {
+        rangeId++;
+    }
+    if (rangeId == DOWNLOAD_STREAMS) {
+        return 0;
+    }
+
+    /* The first range is shortened by the server if the file is smaller */
+    long long length = DOWNLOAD_RANGE_BYTES;
+    if (download->downloadFileSize >= 0 && download->downloadFileSize - download->nextRange < length) {
+        length = download->downloadFileSize - download->nextRange;
+    }
+
+    /* Set before sending, the validation may be received right away */
+    struct DownloadRange* range = &download->ranges[rangeId];
+    range->offset = download->nextRange;
+    range->end = download->nextRange + length;
+    range->received = 0;
+    range->acked = 0;
+
+    Packet downloadRequestPacket = NewPacketFileDownloadRequest;
+    downloadRequestPacket.asFileDownloadRequestPacket.fileId = download->downloadFileId;
+    downloadRequestPacket.asFileDownloadRequestPacket.offset = range->offset;
+    downloadRequestPacket.asFileDownloadRequestPacket.length = length;
+    if (sendToServer(&downloadRequestPacket) <= 0) {
+        range->offset = -1;
+        return 0;
+    }
+
+    download->nextRange += length;
+    return 1;
+}
+
+/**
+ * \brief Resets the given download, freeing its slot.
+ */
+void resetDownload(struct DownloadData* download) {
+    free(download->downloadBuffer);
+    download->downloadBuffer = NULL;
+    free(download->blocks);
+    download->blocks = NULL;
+    download->downloadFileSize = -1;
+    download->downloadedSize = -1;
+    download->downloadFileId = 0;
+}
+
+/**
+ * \brief Abandons the given download, telling the server to stop sending its ranges.
+ *
+ * Ranges still sent would be mixed with the ones of the next download of the file.
+ */
+void cancelDownload(struct DownloadData* download) {
+    Packet cancelPacket = NewPacketFileTransferCancel;
+    cancelPacket.asFileTransferCancelPacket.id = download->downloadFileId;
+    sendToServer(&cancelPacket);
+    resetDownload(download);
+}
+
+/**
+ * \brief Writes the received part of the given download to disk, so it can be resumed.
+ *
+ * Ranges are received out of order : only the bytes before the first missing one are kept. The received
+ * part can be shorter than the resumed one, if the resumed one was found corrupted.
+ */
+void saveDownload(struct DownloadData* download) {
+    if (download->downloadBuffer == NULL) {
+        /* The size of the file is unknown yet, nothing was received */
+        return;
+    }
+
+    long long contiguous = download->nextRange;
+    for (int i = 0; i < DOWNLOAD_STREAMS; i++) {
+        struct DownloadRange* range = &download->ranges[i];
+        if (range->offset != -1 && range->offset + range->received < contiguous) {
+            contiguous = range->offset + range->received;
+        }
+    }
+
+    if (contiguous != download->resumedSize) {
+        char partFilename[18];
+        formatPartName(download->downloadFileId, partFilename);
+        files_writeFile(partFilename, download->downloadBuffer, contiguous);
+    }
+}
+
+/**
+ * \brief Frees the given range once received, requesting the next one, and writes the file once complete.
+ */
+void rangeProgressed(struct DownloadData* download, struct DownloadRange* range) {
+    if (range->offset + range->received < range->end) {
+        return;
+    }
+
+    range->offset = -1;
+    while (requestNextRange(download));
+
+    if (download->downloadedSize >= download->downloadFileSize) {
+        /* File download is terminated. Writing file content to disk */
+        char filename[13];
+        sprintf(filename, "r%d", download->downloadFileId);
+        files_writeFile(filename, download->downloadBuffer, download->downloadFileSize);
+
+        char partFilename[18];
+        formatPartName(download->downloadFileId, partFilename);
+        files_deleteFile(partFilename);
+
+        resetDownload(download);
+        ui_informationMessage("File download complete.");
+    }
+}
+
+/**
+ * \brief Computes the size of the given block of the given download.
+ */
+unsigned int blockSizeOf(struct DownloadData* download, unsigned int block) {
+    long long remaining = download->downloadFileSize - (long long) block * HASH_TREE_BLOCK_BYTES;
+    return remaining > HASH_TREE_BLOCK_BYTES ? HASH_TREE_BLOCK_BYTES : (unsigned int) remaining;
+}
+
+/**
+ * \brief Counts the given received bytes in the blocks they belong to, checking the blocks they complete.
+ *
+ * Blocks are checked on their own, whatever the range they were received by.
+ *
+ * \return -1 if the completed blocks match their proven hash, else the offset of the first corrupted block
+ */
+long long blocksReceived(struct DownloadData* download, long long offset, unsigned int length) {
+    long long corrupted = -1;
+    long long end = offset + length;
+    while (offset < end) {
+        unsigned int block = (unsigned int) (offset / HASH_TREE_BLOCK_BYTES);
+        long long blockOffset = (long long) block * HASH_TREE_BLOCK_BYTES;
+        unsigned int blockSize = blockSizeOf(download, block);
+        long long blockEnd = blockOffset + blockSize < end ? blockOffset + blockSize : end;
+        download->blocks[block].received += blockEnd - offset;
+
+        if (download->blocks[block].received == blockSize && corrupted == -1) {
+            TreeHash hash = hashTree_hashBlock(download->downloadBuffer + blockOffset, blockSize);
+            if (!download->blocks[block].proven || !hashTree_equals(&hash, &download->blocks[block].hash)) {
+                corrupted = blockOffset;
+            }
+        }
+        offset = blockEnd;
+    }
+
+    return corrupted;
+}
+
 void sendFileUploadRequest(const char* filename) {
     int uploadId = findFirstFreeUploadIndex();
     if (uploadId == -1) {
@@ -53,68 +272,155 @@ void sendFileUploadRequest(const char* filename) {
     if (info.exists && !info.isDirectory) {
         uploadData[uploadId].uploadFilename = malloc(strlen(filename) + 1);
         memcpy(uploadData[uploadId].uploadFilename, filename, strlen(filename) + 1);
+        uploadData[uploadId].size = info.size;
 
+        /* The file is read once the upload is accepted, its checksum follows its data */
         Packet fileUploadPacket = NewPacketFileUploadRequest;
         fileUploadPacket.asFileUploadRequestPacket.fileSize = info.size;
-        if(sendPacket(clientSocket, &fileUploadPacket) <= 0) {
+        fileUploadPacket.asFileUploadRequestPacket.resumeToken = readResumeToken(filename);
+        if(sendToServer(&fileUploadPacket) <= 0) {
             ui_errorMessage("Unable to send the file, unknown error.");
             free(uploadData[uploadId].uploadFilename);
             uploadData[uploadId].uploadFilename = NULL;
+            bitmap_releaseShared(uploadSlots, uploadId);
         }
     } else {
         ui_errorMessage("This file does not exist or is a directory.");
+        bitmap_releaseShared(uploadSlots, uploadId);
     }
 }
 
 void sendFileDownloadRequest(unsigned int fileId) {
-    int downloadId = findDownloadIdFor(fileId);
-    if (downloadId == -1) {
-        Packet downloadRequestPacket = NewPacketFileDownloadRequest;
-        downloadRequestPacket.asFileDownloadRequestPacket.fileId = fileId;
-        sendPacket(clientSocket, &downloadRequestPacket);
-    } else {
+    if (findDownloadIdFor(fileId) != -1) {
         ui_errorMessage("You're already downloading this file. Just be patient.");
+        return;
+    }
+
+    int downloadId = findFirstFreeDownloadIndex();
+    if (downloadId == -1) {
+        ui_errorMessage("Can't download more files.");
+        return;
+    }
+
+    /* Resuming from the part received before a disconnection, if any */
+    char partFilename[18];
+    formatPartName(fileId, partFilename);
+    FileInfo partInfo = files_getInfo(partFilename);
+    long long resumedSize = partInfo.exists && !partInfo.isDirectory ? partInfo.size : 0;
+
+    struct DownloadData* download = &downloadData[downloadId];
+    download->downloadBuffer = NULL;
+    download->downloadFileSize = -1;
+    download->downloadedSize = resumedSize;
+    download->resumedSize = resumedSize;
+    download->nextRange = resumedSize;
+    download->blocks = NULL;
+    for (int i = 0; i < DOWNLOAD_STREAMS; i++) {
+        download->ranges[i].offset = -1;
+    }
+    download->downloadFileId = fileId;
+
+    /* The size of the file is unknown : the other ranges are requested once the first one is accepted */
+    if (!requestNextRange(download)) {
+        ui_errorMessage("Unable to download the file, unknown error.");
+        resetDownload(download);
     }
 }
 
 void handleFileDownloadCancel(struct PacketFileTransferCancel* packet) {
     int downloadId = findDownloadIdFor(packet->id);
     if (downloadId != -1) {
-        free(downloadData[downloadId].downloadBuffer);
-        downloadData[downloadId].downloadBuffer = NULL;
-        downloadData[downloadId].downloadFileSize = -1;
-        downloadData[downloadId].downloadedSize = -1;
-        downloadData[downloadId].downloadFileId = 0;
+        /* The other ranges of the file may still be sent */
+        cancelDownload(&downloadData[downloadId]);
+
+        char partFilename[18];
+        formatPartName(packet->id, partFilename);
+        files_deleteFile(partFilename);
         ui_errorMessage("File download canceled.");
     }
 }
 
+/**
+ * \brief Waits until the server acknowledged enough data of the given upload to send the given position.
+ *
+ * \return 1 once the position can be sent, 0 if the server stopped acknowledging data
+ */
+int waitForUploadWindow(unsigned int uploadId, long long position) {
+    while (position - (long long) atomics_load64(&uploadData[uploadId].acked) >= FILE_TRANSFER_WINDOW_BYTES) {
+        if (!waitEventFor(uploadData[uploadId].ackEvent, FILE_TRANSFER_ACK_TIMEOUT_MILLIS)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
 THREAD_ENTRY_POINT fileUploadWorker(void* data) {
     unsigned int* threadData = (unsigned int*) data;
     unsigned int fileId = threadData[0];
     unsigned int uploadId = threadData[1];
     free(data);
 
-    FileInfo info = files_getInfo(uploadData[uploadId].uploadFilename);
-    char* content = malloc(info.size);
-    if (files_readFile(uploadData[uploadId].uploadFilename, content, info.size) != -1) {
-        Packet dataPacket = NewPacketFileDataTransfer;
-        dataPacket.asFileDataTransferPacket.id = fileId;
-        long long sent = 0;
-        while (sent < info.size) {
-            long long remaining = info.size - sent;
+    /* The file is read by buffers as it's sent, checksumming it along the way */
+    const char* filename = uploadData[uploadId].uploadFilename;
+    long long size = uploadData[uploadId].size;
+    char* buffer = malloc(UPLOAD_READ_BYTES);
+    unsigned int checksum = 0;
+    Packet dataPacket = NewPacketFileDataTransfer;
+    dataPacket.asFileDataTransferPacket.id = fileId;
+    long long position = 0;
+    long long sent = uploadData[uploadId].offset;
+    int interrupted = 0;
+    while (!interrupted && position < size) {
+        long long remainingInFile = size - position;
+        unsigned long bufferSize = remainingInFile > UPLOAD_READ_BYTES ? UPLOAD_READ_BYTES : (unsigned long) remainingInFile;
+        if (files_readFileAt(filename, position, buffer, bufferSize) != bufferSize) {
+            ui_errorMessage("Unable to read file content.");
+            break;
+        }
+        checksum = crc32c_update(checksum, buffer, bufferSize);
+
+        /* The start of a resumed upload is only read for the checksum, the server already has it */
+        while (sent < position + (long long) bufferSize) {
+            long long remaining = position + (long long) bufferSize - sent;
             long long toSend = remaining > FILE_TRANSFER_CHUNK_SIZE ? FILE_TRANSFER_CHUNK_SIZE : remaining;
-            memcpy(dataPacket.asFileDataTransferPacket.data, content + sent, toSend);
-            sendPacket(clientSocket, &dataPacket);
+            dataPacket.asFileDataTransferPacket.offset = sent;
+            memcpy(dataPacket.asFileDataTransferPacket.data, buffer + (sent - position), toSend);
+
+            /* Only a window of data is ahead of the server, so other packets don't wait behind file data */
+            if (!waitForUploadWindow(uploadId, sent)) {
+                ui_errorMessage("File upload stalled.");
+                interrupted = 1;
+                break;
+            }
+            throttle_wait(&uploadThrottle, toSend);
+            if (outbound_send(&serverOutbound, &dataPacket, OUTBOUND_PRIORITY_BULK) == -1) {
+                interrupted = 1;
+                break;
+            }
             sent += toSend;
         }
-    } else {
-        ui_errorMessage("Unable to read file content.");
+        position += (long long) bufferSize;
     }
-    free(content);
+    free(buffer);
+
+    if (position == size && sent == size) {
+        /* Sent behind the data, the server keeps the file once it checked it */
+        Packet digestPacket = NewPacketFileUploadDigest;
+        digestPacket.asFileUploadDigestPacket.id = fileId;
+        digestPacket.asFileUploadDigestPacket.checksum = checksum;
+        if (outbound_send(&serverOutbound, &digestPacket, OUTBOUND_PRIORITY_BULK) != -1) {
+            /* Nothing left to resume */
+            char* resumeFilename = resumeFilenameFor(filename);
+            files_deleteFile(resumeFilename);
+            free(resumeFilename);
+        }
+    }
+
     free(uploadData[uploadId].uploadFilename);
     uploadData[uploadId].uploadFilename = NULL;
     destroyThread(&uploadData[uploadId].uploadThread);
+    bitmap_releaseShared(uploadSlots, uploadId);
     return 0;
 }
 
@@ -126,7 +432,18 @@ void handleFileUploadValidation(struct PacketFileUploadValidation* packet) {
     }
 
     if (packet->accepted) {
-        ui_informationMessage("Beginning file upload.");
+        uploadData[uploadId].resumeToken = packet->token;
+        uploadData[uploadId].offset = packet->offset;
+        uploadData[uploadId].fileId = packet->id;
+        atomics_store64(&uploadData[uploadId].acked, packet->offset);
+        writeResumeToken(uploadData[uploadId].uploadFilename, packet->token);
+        if (packet->offset > 0) {
+            char message[64];
+            sprintf(message, "Resuming file upload at byte %lld.", packet->offset);
+            ui_informationMessage(message);
+        } else {
+            ui_informationMessage("Beginning file upload.");
+        }
 
         unsigned int* threadData = malloc(sizeof(unsigned int) * 2);
         threadData[0] = packet->id;
@@ -136,47 +453,165 @@ void handleFileUploadValidation(struct PacketFileUploadValidation* packet) {
         ui_errorMessage("Server rejected file upload.");
         free(uploadData[uploadId].uploadFilename);
         uploadData[uploadId].uploadFilename = NULL;
+        bitmap_releaseShared(uploadSlots, uploadId);
     }
 }
 
 void handleFileData(struct PacketFileDataTransfer* packet) {
     int downloadId = findDownloadIdFor(packet->id);
-    if (downloadId != -1) {
+    if (downloadId == -1 || downloadData[downloadId].downloadBuffer == NULL) {
+        return;
+    }
+
+    struct DownloadData* download = &downloadData[downloadId];
+    int rangeId = findRangeFor(download, packet->offset);
+    if (rangeId == -1) {
+        return;
+    }
+
+    /* Calculating expected data chunk size */
+    struct DownloadRange* range = &download->ranges[rangeId];
+    long long remainingInRange = range->end - packet->offset;
+    unsigned int chunkSize = remainingInRange > FILE_TRANSFER_CHUNK_SIZE ? FILE_TRANSFER_CHUNK_SIZE : remainingInRange;
+
+    /* Add received data to file content, where it belongs */
+    memcpy(download->downloadBuffer + packet->offset, packet->data, chunkSize);
+    range->received += chunkSize;
+    download->downloadedSize += chunkSize;
+
+    long long corrupted = blocksReceived(download, packet->offset, chunkSize);
+    if (corrupted != -1) {
+        /* Only the bytes before the corrupted block are kept to resume the download */
+        if (download->nextRange > corrupted) {
+            download->nextRange = corrupted;
+        }
+        saveDownload(download);
+        cancelDownload(download);
+        ui_errorMessage("File download corrupted.");
+        return;
+    }
+
+    if (range->offset + range->received < range->end && range->received - range->acked >= FILE_TRANSFER_ACK_BYTES) {
+        /* Letting the server send more data */
+        Packet ackPacket = NewPacketFileDataAck;
+        ackPacket.asFileDataAckPacket.id = packet->id;
+        ackPacket.asFileDataAckPacket.offset = range->offset + range->received;
+        sendToServer(&ackPacket);
+        range->acked = range->received;
+    }
+
+    rangeProgressed(download, range);
+}
 
-        /* Calculating expected next data chunk size */
-        unsigned remainingToDownload = downloadData[downloadId].downloadFileSize - downloadData[downloadId].downloadedSize;
-        unsigned int nextChunkSize = remainingToDownload > FILE_TRANSFER_CHUNK_SIZE ? FILE_TRANSFER_CHUNK_SIZE : remainingToDownload;
-
-        /* Add received data to file content */
-        memcpy(downloadData[downloadId].downloadBuffer + downloadData[downloadId].downloadedSize, packet->data, nextChunkSize);
-        downloadData[downloadId].downloadedSize += nextChunkSize;
-
-        if (downloadData[downloadId].downloadedSize >= downloadData[downloadId].downloadFileSize) {
-            /* File download is terminated. Writing file content to disk */
-            char filename[13];
-            sprintf(filename, "r%d", downloadData[downloadId].downloadFileId);
-            files_writeFile(filename, downloadData[downloadId].downloadBuffer, downloadData[downloadId].downloadFileSize);
-
-            /* Reset download state */
-            free(downloadData[downloadId].downloadBuffer);
-            downloadData[downloadId].downloadBuffer = NULL;
-            downloadData[downloadId].downloadFileSize = -1;
-            downloadData[downloadId].downloadedSize = -1;
-            downloadData[downloadId].downloadFileId = 0;
-            ui_informationMessage("File download complete.");
+void handleFileDataAck(struct PacketFileDataAck* packet) {
+    for (int i = 0; i < MAX_CONCURRENT_FILE_TRANSFER; i++) {
+        if (uploadData[i].uploadFilename != NULL && uploadData[i].fileId == packet->id) {
+            if ((unsigned long long) packet->offset > atomics_load64(&uploadData[i].acked)) {
+                atomics_store64(&uploadData[i].acked, packet->offset);
+            }
+            signalEvent(uploadData[i].ackEvent);
         }
     }
 }
 
 void handleFileDownloadValidation(struct PacketFileDownloadValidation* packet) {
-    int downloadId = findFirstFreeDownloadIndex();
-    if (packet->accepted && downloadId != -1) {
-        downloadData[downloadId].downloadFileSize = packet->fileSize;
-        downloadData[downloadId].downloadBuffer = malloc(sizeof(char) * downloadData[downloadId].downloadFileSize);
-        downloadData[downloadId].downloadedSize = 0;
-        downloadData[downloadId].downloadFileId = packet->fileId;
-        ui_informationMessage("File download beginning.");
-    } else {
+    int downloadId = findDownloadIdFor(packet->fileId);
+    if (downloadId == -1) {
+        return;
+    }
+
+    struct DownloadData* download = &downloadData[downloadId];
+    int rangeId = findRangeFor(download, packet->offset);
+    if (!packet->accepted || rangeId == -1) {
+        /* What was received can still be resumed later */
+        saveDownload(download);
+        cancelDownload(download);
         ui_errorMessage("Server rejected file download.");
+        return;
+    }
+
+    if (download->downloadBuffer == NULL) {
+        /* First range accepted, the size of the file is known */
+        char* buffer = malloc(sizeof(char) * (packet->fileSize > 0 ? packet->fileSize : 1));
+        if (download->resumedSize > 0) {
+            /* The server sends the bytes following the received part */
+            char partFilename[18];
+            formatPartName(packet->fileId, partFilename);
+            if (files_readFile(partFilename, buffer, download->resumedSize) != (unsigned long) download->resumedSize) {
+                ui_errorMessage("Unable to resume file download.");
+                free(buffer);
+                cancelDownload(download);
+                return;
+            }
+        }
+
+        /* Whole blocks of the resumed part were checked before, the last one is checked once complete */
+        download->rootHash = packet->rootHash;
+        download->blockCount = hashTree_blockCount(packet->fileSize);
+        download->proofReceived = 0;
+        download->blocks = malloc(sizeof(struct DownloadBlock) * download->blockCount);
+        for (unsigned int i = 0; i < download->blockCount; i++) {
+            long long received = download->resumedSize - (long long) i * HASH_TREE_BLOCK_BYTES;
+            download->blocks[i].received = received <= 0 ? 0 : (received > HASH_TREE_BLOCK_BYTES ? HASH_TREE_BLOCK_BYTES : received);
+            download->blocks[i].proven = 0;
+        }
+
+        download->downloadBuffer = buffer;
+        download->downloadFileSize = packet->fileSize;
+        if (download->nextRange > packet->fileSize) {
+            download->nextRange = packet->fileSize;
+        }
+        ui_informationMessage(download->resumedSize > 0 ? "File download resuming." : "File download beginning.");
     }
-}
\ No newline at end of file
+
+    /* The range is shortened if it goes past the end of the file */
+    struct DownloadRange* range = &download->ranges[rangeId];
+    range->end = packet->offset + packet->length;
+
+    /* More ranges can be downloaded at once, now the size of the file is known */
+    while (requestNextRange(download));
+    rangeProgressed(download, range);
+}
+
+void handleFileBlockProof(struct PacketFileBlockProof* packet) {
+    int downloadId = findDownloadIdFor(packet->fileId);
+    if (downloadId == -1 || downloadData[downloadId].downloadBuffer == NULL) {
+        return;
+    }
+
+    /* An unproven block is found corrupted once received */
+    struct DownloadData* download = &downloadData[downloadId];
+    if (packet->proofLength > HASH_TREE_MAX_DEPTH || packet->first > packet->proofLength || packet->block >= download->blockCount) {
+        return;
+    }
+
+    /* A split proof is checked once all its packets are received, a missed packet drops it */
+    if (packet->first == 0) {
+        download->proofBlock = packet->block;
+        download->proofHash = packet->hash;
+        download->proofReceived = 0;
+    } else if (packet->block != download->proofBlock || packet->first != download->proofReceived) {
+        return;
+    }
+
+    unsigned int count = packet->proofLength - packet->first;
+    if (count > HASH_TREE_PROOF_HASHES) {
+        count = HASH_TREE_PROOF_HASHES;
+    }
+    memcpy(download->proofSiblings + packet->first, packet->siblings, sizeof(TreeHash) * count);
+    download->proofReceived = packet->first + count;
+
+    if (download->proofReceived == packet->proofLength
+        && hashTree_verify(&download->proofHash, packet->block, download->blockCount, download->proofSiblings, &download->rootHash)) {
+        download->blocks[packet->block].hash = download->proofHash;
+        download->blocks[packet->block].proven = 1;
+    }
+}
+
+void saveDownloads() {
+    for (int i = 0; i < MAX_CONCURRENT_FILE_TRANSFER; i++) {
+        if (downloadData[i].downloadFileId != 0) {
+            saveDownload(&downloadData[i]);
+        }
+    }
+}
@@ -41,6 +41,20 @@ void handleFileUploadValidation(struct PacketFileUploadValidation* packet);
  */
 void handleFileData(struct PacketFileDataTransfer* packet);
 
+/**
+ * \brief Processes received PacketFileDataAck, letting an upload send more data.
+ *
+ * \param packet The received packet
+ */
+void handleFileDataAck(struct PacketFileDataAck* packet);
+
+/**
+ * \brief Processes received PacketFileBlockProof, keeping the hash of the block if it's proven.
+ *
+ * \param packet The received packet
+ */
+void handleFileBlockProof(struct PacketFileBlockProof* packet);
+
 /**
  * \brief Processed received PacketFileDownloadValidation.
  *
@@ -48,4 +62,11 @@ void handleFileData(struct PacketFileDataTransfer* packet);
  */
 void handleFileDownloadValidation(struct PacketFileDownloadValidation* packet);
 
+/**
+ * \brief Writes the received part of the unfinished downloads to disk, so they can be resumed.
+ *
+ * A download of the same file resumes from this part, until it completes.
+ */
+void saveDownloads();
+
 #endif //C_CHAT_FILE_TRANSFER_H
@@ -5,7 +5,7 @@
 #include "../common/packets.h"
 #include "client.h"
 
-void createRoom(const char* command) {
+void createRoom(const char* command, short large) {
     char roomName[ROOM_NAME_MAX_LENGTH + 1];
     char roomDesc[ROOM_DESC_MAX_LENGTH + 1];
 
@@ -50,7 +50,8 @@ void createRoom(const char* command) {
     Packet packet = NewPacketCreateRoom;
     memcpy(packet.asCreateRoomPacket.roomName, roomName, ROOM_NAME_MAX_LENGTH + 1);
     memcpy(packet.asCreateRoomPacket.roomDesc, roomDesc, ROOM_DESC_MAX_LENGTH + 1);
-    sendPacket(clientSocket, &packet);
+    packet.asCreateRoomPacket.large = (char) large;
+    sendToServer(&packet);
 }
 
 void joinRoom(const char* command) {
@@ -66,15 +67,15 @@ void joinRoom(const char* command) {
 
     Packet packet = NewPacketJoinRoom;
     memcpy(packet.asJoinRoomPacket.roomName, roomName, ROOM_NAME_MAX_LENGTH + 1);
-    sendPacket(clientSocket, &packet);
+    sendToServer(&packet);
 }
 
 void leaveRoom() {
     Packet packet = NewPacketLeaveRoom;
-    sendPacket(clientSocket, &packet);
+    sendToServer(&packet);
 }
 
 void listRooms() {
     Packet packet = NewPacketListRooms;
-    sendPacket(clientSocket, &packet);
+    sendToServer(&packet);
 }
\ No newline at end of file
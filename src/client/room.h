@@ -8,8 +8,9 @@
  * Then sends a packet to the server to create the room.
  *
  * \param command The part of the command containing the name and the description of the room to create
+ * \param large 1 to create a large room (see LARGE_ROOM_MAX_USERS), else 0
  */
-void createRoom(const char* command);
+void createRoom(const char* command, short large);
 
 /**
  * \brief Sends a packet to the server to join the room with the given name.
@@ -90,92 +90,92 @@ void _restoreUserInput() {
 #endif
 
 void ui_init() {
-    inputStateMutex = createMutex();
+    initMutex(&inputStateMutex);
 }
 
 void ui_cleanUp() {
-    destroyMutex(inputStateMutex);
+    destroyMutex(&inputStateMutex);
 }
 
 void ui_reset() {
-    acquireMutex(inputStateMutex);
+    acquireMutex(&inputStateMutex);
     {
         _storeUserInput();
         inputState = 0;
     }
-    releaseMutex(inputStateMutex);
+    releaseMutex(&inputStateMutex);
 }
 
 void ui_getUserInput(const char* prompt, char* buffer, int buffer_size) {
     do {
         // Modify input state
-        acquireMutex(inputStateMutex);
+        acquireMutex(&inputStateMutex);
         {
             _beginUserInput();
             // Keep prompt in memory for future prompt restoration
             unsigned int promptLength = strlen(prompt);
             memcpy(promptBuffer, prompt, promptLength < PROMPT_MAX_LENGTH ? promptLength : PROMPT_MAX_LENGTH);
         }
-        releaseMutex(inputStateMutex);
+        releaseMutex(&inputStateMutex);
 
         resetColor();
         printf("%s", promptBuffer);
         fgets(buffer, buffer_size, stdin);
         if ((strlen(buffer) - 1) == 0) { // If user entered an empty message.
             // Modify input state
-            acquireMutex(inputStateMutex);
+            acquireMutex(&inputStateMutex);
             {
                 _endUserInput();
             }
-            releaseMutex(inputStateMutex);
+            releaseMutex(&inputStateMutex);
 
             ui_errorMessage("You can't send an empty message.");
         }
     } while((strlen(buffer) - 1) == 0);
 
     // Modify input state
-    acquireMutex(inputStateMutex);
+    acquireMutex(&inputStateMutex);
     {
         _endUserInput();
     }
-    releaseMutex(inputStateMutex);
+    releaseMutex(&inputStateMutex);
 
     // Trim carriage return
     buffer[strlen(buffer) - 1] = '\0';
 }
 
 void ui_messageReceived(const char* sender, const char* message) {
-    acquireMutex(inputStateMutex);
+    acquireMutex(&inputStateMutex);
     {
         _storeUserInput();
     }
-    releaseMutex(inputStateMutex);
+    releaseMutex(&inputStateMutex);
 
     printf("[%s] %s\n", sender, message);
 
-    acquireMutex(inputStateMutex);
+    acquireMutex(&inputStateMutex);
     {
         _restoreUserInput();
     }
-    releaseMutex(inputStateMutex);
+    releaseMutex(&inputStateMutex);
 }
 
 void _ui_coloredMessage(const char* message, unsigned int colorCode) {
-    acquireMutex(inputStateMutex);
+    acquireMutex(&inputStateMutex);
     {
         _storeUserInput();
     }
-    releaseMutex(inputStateMutex);
+    releaseMutex(&inputStateMutex);
 
     setTextColor(colorCode);
     printf("%s\n", message);
     resetColor();
 
-    acquireMutex(inputStateMutex);
+    acquireMutex(&inputStateMutex);
     {
         _restoreUserInput();
     }
-    releaseMutex(inputStateMutex);
+    releaseMutex(&inputStateMutex);
 }
 
 void ui_informationMessage(const char* message) {
@@ -191,47 +191,47 @@ void ui_successMessage(const char* message) {
 }
 
 void ui_joinMessage(const char* username) {
-    acquireMutex(inputStateMutex);
+    acquireMutex(&inputStateMutex);
     {
         _storeUserInput();
     }
-    releaseMutex(inputStateMutex);
+    releaseMutex(&inputStateMutex);
 
     setTextColor(FG_YELLOW);
     printf("%s joined the channel\n", username);
     resetColor();
 
-    acquireMutex(inputStateMutex);
+    acquireMutex(&inputStateMutex);
     {
         _restoreUserInput();
     }
-    releaseMutex(inputStateMutex);
+    releaseMutex(&inputStateMutex);
 }
 
 void ui_leaveMessage(const char* username) {
-    acquireMutex(inputStateMutex);
+    acquireMutex(&inputStateMutex);
     {
         _storeUserInput();
     }
-    releaseMutex(inputStateMutex);
+    releaseMutex(&inputStateMutex);
 
     setTextColor(FG_YELLOW);
     printf("%s left the channel\n", username);
     resetColor();
 
-    acquireMutex(inputStateMutex);
+    acquireMutex(&inputStateMutex);
     {
         _restoreUserInput();
     }
-    releaseMutex(inputStateMutex);
+    releaseMutex(&inputStateMutex);
 }
 
 void ui_welcomeMessage() {
-    acquireMutex(inputStateMutex);
+    acquireMutex(&inputStateMutex);
     {
         _storeUserInput();
     }
-    releaseMutex(inputStateMutex);
+    releaseMutex(&inputStateMutex);
 
     setTextColor(FG_BLUE);
     printf("Welcome on C-Chat\n");
@@ -242,27 +242,28 @@ void ui_welcomeMessage() {
     printf("  * nick: used to choose a new username\n");
     printf("  * quit: used to quit the server\n");
     printf("  * room: used to create, join or leave a room\n");
+    printf("  * stats: used to display server statistics\n");
 
-    acquireMutex(inputStateMutex);
+    acquireMutex(&inputStateMutex);
     {
         _restoreUserInput();
     }
-    releaseMutex(inputStateMutex);
+    releaseMutex(&inputStateMutex);
 }
 
 void ui_usernameChanged(const char* oldUsername, const char* newUsername) {
-    acquireMutex(inputStateMutex);
+    acquireMutex(&inputStateMutex);
     {
         _storeUserInput();
     }
-    releaseMutex(inputStateMutex);
+    releaseMutex(&inputStateMutex);
 
     setTextColor(FG_YELLOW);
     printf("%s changed its username to %s\n", oldUsername, newUsername);
 
-    acquireMutex(inputStateMutex);
+    acquireMutex(&inputStateMutex);
     {
         _restoreUserInput();
     }
-    releaseMutex(inputStateMutex);
+    releaseMutex(&inputStateMutex);
 }
@@ -0,0 +1,93 @@
+#include "adaptive-lock.h"
+#include "interop.h"
+
+/**
+ * \brief Parks the calling thread while the lock state is equal to 2.
+ */
+void adaptiveLock_park(AdaptiveLock* lock);
+
+void adaptiveLock_init(AdaptiveLock* lock) {
+    lock->state = 0;
+#ifdef ADAPTIVE_LOCK_STATS
+    lock->acquisitions = 0;
+    lock->contentions = 0;
+    lock->parks = 0;
+#endif
+}
+
+void adaptiveLock_acquireContended(AdaptiveLock* lock) {
+#ifdef ADAPTIVE_LOCK_STATS
+    atomics_fetchAdd(&lock->contentions, 1);
+#endif
+
+    /* The owner is expected to leave its critical section soon */
+    unsigned int backoff = 1;
+    for (int i = 0; i < ADAPTIVE_LOCK_SPINS; i++) {
+        for (unsigned int j = 0; j < backoff; j++) {
+            atomics_pause();
+        }
+        if (backoff < 64) {
+            backoff <<= 1;
+        }
+
+        if (atomics_load(&lock->state) == 0 && atomics_compareExchange(&lock->state, 0, 1)) {
+            return;
+        }
+    }
+
+    /*
+     * Marking the lock as having parked threads so the owner wakes one up on release.
+     * Once acquired this way, the lock stays marked : we don't know whether other threads are parked.
+     */
+    while (atomics_exchange(&lock->state, 2) != 0) {
+#ifdef ADAPTIVE_LOCK_STATS
+        atomics_fetchAdd(&lock->parks, 1);
+#endif
+        adaptiveLock_park(lock);
+    }
+}
+
+#if defined(__linux__)
+
+    #include <linux/futex.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+
+    void adaptiveLock_park(AdaptiveLock* lock) {
+        /* Returns at once if the state isn't 2 anymore */
+        syscall(SYS_futex, &lock->state, FUTEX_WAIT_PRIVATE, 2, NULL, NULL, 0);
+    }
+
+    void adaptiveLock_wake(AdaptiveLock* lock) {
+        syscall(SYS_futex, &lock->state, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+    }
+
+#elif IS_WINDOWS
+
+    #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+    #endif
+
+    void adaptiveLock_park(AdaptiveLock* lock) {
+        unsigned int parked = 2;
+        WaitOnAddress(&lock->state, &parked, sizeof(parked), INFINITE);
+    }
+
+    void adaptiveLock_wake(AdaptiveLock* lock) {
+        WakeByAddressSingle((PVOID) &lock->state);
+    }
+
+#else
+
+    #include "threads.h"
+
+    /* No portable way to wait on an address : parked threads poll the lock */
+
+    void adaptiveLock_park(AdaptiveLock* lock) {
+        threadSleep(1);
+    }
+
+    void adaptiveLock_wake(AdaptiveLock* lock) {}
+
+#endif
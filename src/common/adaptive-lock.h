@@ -0,0 +1,116 @@
+/**
+ * \file adaptive-lock.h
+ * \brief A lock for short critical sections, spinning briefly before parking the thread.
+ *
+ * The lock is a single integer meant to be embedded in the structure it protects : acquiring
+ * an available lock is a single compare-and-swap, without any function call nor pointer chase.
+ * When the lock is taken, the thread spins with an exponential backoff, expecting the owner to
+ * leave its critical section soon, then parks until the lock is released : on a futex on Linux,
+ * using WaitOnAddress on Windows, sleeping on other systems.
+ *
+ * Unlike a Mutex, the lock has no owner : it can be released by another thread than the one
+ * which acquired it.
+ *
+ * Building with ADAPTIVE_LOCK_STATS defined counts acquisitions, contended acquisitions and
+ * parks of each lock.
+ */
+
+#ifndef C_CHAT_ADAPTIVE_LOCK_H
+#define C_CHAT_ADAPTIVE_LOCK_H
+
+#include "atomics.h"
+
+/**
+ * \def ADAPTIVE_LOCK_SPINS
+ * \brief Amount of attempts to acquire a taken lock before parking
+ */
+#define ADAPTIVE_LOCK_SPINS 64
+
+/**
+ * \def ADAPTIVE_LOCK_INITIALIZER
+ * \brief Static initializer of an available lock
+ */
+#ifdef ADAPTIVE_LOCK_STATS
+#define ADAPTIVE_LOCK_INITIALIZER { 0, 0, 0, 0 }
+#else
+#define ADAPTIVE_LOCK_INITIALIZER { 0 }
+#endif
+
+/**
+ * \class AdaptiveLock
+ * \brief A spin-then-park lock
+ */
+typedef struct AdaptiveLock {
+    /** 0 if available, 1 if taken, 2 if taken and threads may be parked */
+    volatile unsigned int state;
+#ifdef ADAPTIVE_LOCK_STATS
+    /** Amount of times the lock was acquired */
+    volatile unsigned int acquisitions;
+    /** Amount of times the lock was taken when trying to acquire it */
+    volatile unsigned int contentions;
+    /** Amount of times a thread parked waiting for the lock */
+    volatile unsigned int parks;
+#endif
+} AdaptiveLock;
+
+/**
+ * \brief Initializes an available lock.
+ *
+ * \param lock The lock to initialize
+ */
+void adaptiveLock_init(AdaptiveLock* lock);
+
+/**
+ * \brief Waits for the given lock to be available and acquires it. Slow path of adaptiveLock_acquire.
+ *
+ * \param lock The lock to acquire
+ */
+void adaptiveLock_acquireContended(AdaptiveLock* lock);
+
+/**
+ * \brief Wakes up a thread parked on the given lock. Slow path of adaptiveLock_release.
+ *
+ * \param lock The released lock
+ */
+void adaptiveLock_wake(AdaptiveLock* lock);
+
+/**
+ * \brief Acquires the given lock.
+ *
+ * This is a blocking call.
+ *
+ * \param lock The lock to acquire
+ */
+static inline void adaptiveLock_acquire(AdaptiveLock* lock) {
+#ifdef ADAPTIVE_LOCK_STATS
+    atomics_fetchAdd(&lock->acquisitions, 1);
+#endif
+    if (!atomics_compareExchange(&lock->state, 0, 1)) {
+        adaptiveLock_acquireContended(lock);
+    }
+}
+
+/**
+ * \brief Acquires the given lock if it's available.
+ *
+ * This is a non-blocking call.
+ *
+ * \param lock The lock to acquire
+ * \return 1 if the lock was acquired, else 0
+ */
+static inline int adaptiveLock_tryAcquire(AdaptiveLock* lock) {
+    return atomics_compareExchange(&lock->state, 0, 1);
+}
+
+/**
+ * \brief Releases the given lock.
+ *
+ * \param lock The lock to release
+ */
+static inline void adaptiveLock_release(AdaptiveLock* lock) {
+    if (atomics_exchange(&lock->state, 0) == 2) {
+        adaptiveLock_wake(lock);
+    }
+}
+
+#endif //C_CHAT_ADAPTIVE_LOCK_H
@@ -0,0 +1,180 @@
+/**
+ * \file atomics.h
+ * \brief Atomic operations on shared integers, usable without taking a lock.
+ *
+ * Loads have acquire semantics and stores have release semantics : what a thread wrote before
+ * storing a value is visible to a thread that loaded this value. Read-modify-write operations
+ * and atomics_fence are sequentially consistent.
+ *
+ * GCC and Clang builtins are used when available, Interlocked functions otherwise (MSVC).
+ */
+
+#ifndef C_CHAT_ATOMICS_H
+#define C_CHAT_ATOMICS_H
+
+/**
+ * \def ATOMICS_CACHE_LINE
+ * \brief Size of a cache line, used to keep variables written by different threads apart
+ */
+#define ATOMICS_CACHE_LINE 64
+
+#if defined(__GNUC__) || defined(__clang__)
+
+/**
+ * \brief Reads the given integer.
+ *
+ * \param value The integer to read
+ * \return the integer value
+ */
+static inline unsigned int atomics_load(volatile unsigned int* value) {
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * \brief Writes the given integer.
+ *
+ * \param value The integer to write
+ * \param newValue The value to write
+ */
+static inline void atomics_store(volatile unsigned int* value, unsigned int newValue) {
+    __atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+}
+
+/**
+ * \brief Adds to the given integer.
+ *
+ * \param value The integer to add to
+ * \param amount The amount to add
+ * \return the integer value before the addition
+ */
+static inline unsigned int atomics_fetchAdd(volatile unsigned int* value, unsigned int amount) {
+    return __atomic_fetch_add(value, amount, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * \brief Replaces the given integer.
+ *
+ * \param value The integer to replace
+ * \param newValue The value to write
+ * \return the integer value before the replacement
+ */
+static inline unsigned int atomics_exchange(volatile unsigned int* value, unsigned int newValue) {
+    return __atomic_exchange_n(value, newValue, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * \brief Replaces the given integer if it's equal to the expected value.
+ *
+ * \param value The integer to replace
+ * \param expected The value the integer must have
+ * \param newValue The value to write
+ * \return 1 if the integer was replaced, else 0
+ */
+static inline int atomics_compareExchange(volatile unsigned int* value, unsigned int expected, unsigned int newValue) {
+    return __atomic_compare_exchange_n(value, &expected, newValue, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+/**
+ * \brief Reads the given 64 bits integer, without tearing on 32 bits platforms.
+ *
+ * \param value The integer to read
+ * \return the integer value
+ */
+static inline unsigned long long atomics_load64(volatile unsigned long long* value) {
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * \brief Writes the given 64 bits integer, without tearing on 32 bits platforms.
+ *
+ * \param value The integer to write
+ * \param newValue The value to write
+ */
+static inline void atomics_store64(volatile unsigned long long* value, unsigned long long newValue) {
+    __atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+}
+
+/**
+ * \brief Replaces the given 64 bits integer if it's equal to the expected value.
+ *
+ * \param value The integer to replace
+ * \param expected The value the integer must have
+ * \param newValue The value to write
+ * \return 1 if the integer was replaced, else 0
+ */
+static inline int atomics_compareExchange64(volatile unsigned long long* value, unsigned long long expected, unsigned long long newValue) {
+    return __atomic_compare_exchange_n(value, &expected, newValue, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+/**
+ * \brief Orders all memory accesses before this call with all memory accesses after it.
+ */
+static inline void atomics_fence() {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/**
+ * \brief Tells the processor the thread is spinning, lowering the cost of busy-waiting.
+ */
+static inline void atomics_pause() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+#elif defined(_MSC_VER)
+
+#include <intrin.h>
+
+static inline unsigned int atomics_load(volatile unsigned int* value) {
+    unsigned int read = *value;
+    _ReadWriteBarrier();
+    return read;
+}
+
+static inline void atomics_store(volatile unsigned int* value, unsigned int newValue) {
+    _ReadWriteBarrier();
+    *value = newValue;
+}
+
+static inline unsigned int atomics_fetchAdd(volatile unsigned int* value, unsigned int amount) {
+    return (unsigned int) _InterlockedExchangeAdd((volatile long*) value, (long) amount);
+}
+
+static inline unsigned int atomics_exchange(volatile unsigned int* value, unsigned int newValue) {
+    return (unsigned int) _InterlockedExchange((volatile long*) value, (long) newValue);
+}
+
+static inline int atomics_compareExchange(volatile unsigned int* value, unsigned int expected, unsigned int newValue) {
+    return (unsigned int) _InterlockedCompareExchange((volatile long*) value, (long) newValue, (long) expected) == expected;
+}
+
+static inline unsigned long long atomics_load64(volatile unsigned long long* value) {
+    return (unsigned long long) _InterlockedCompareExchange64((volatile long long*) value, 0, 0);
+}
+
+static inline void atomics_store64(volatile unsigned long long* value, unsigned long long newValue) {
+    long long expected = *(volatile long long*) value;
+    long long read;
+    while ((read = _InterlockedCompareExchange64((volatile long long*) value, (long long) newValue, expected)) != expected) {
+        expected = read;
+    }
+}
+
+static inline int atomics_compareExchange64(volatile unsigned long long* value, unsigned long long expected, unsigned long long newValue) {
+    return (unsigned long long) _InterlockedCompareExchange64((volatile long long*) value, (long long) newValue, (long long) expected) == expected;
+}
+
+static inline void atomics_fence() {
+    _mm_mfence();
+}
+
+static inline void atomics_pause() {
+    _mm_pause();
+}
+
+#endif
+
+#endif //C_CHAT_ATOMICS_H
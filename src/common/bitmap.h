@@ -0,0 +1,215 @@
+/**
+ * \file bitmap.h
+ * \brief Bitmaps tracking which slots of a fixed-size array are taken.
+ *
+ * A bitmap is an array of BitmapWord, declared with BITMAP_WORDS(capacity) words. A set bit is a
+ * taken slot. Free and taken slots are found a whole word at a time using count-trailing-zeros,
+ * so looking for a free slot or iterating over taken slots skips 64 slots per instruction.
+ *
+ * Functions without the Shared suffix MUST be called holding the lock protecting the bitmap.
+ * The Shared variants can be used by threads concurrently modifying the bitmap.
+ *
+ * Iterating over taken slots :
+ *     for (int i = bitmap_next(bitmap, capacity, 0); i != -1; i = bitmap_next(bitmap, capacity, i + 1))
+ */
+
+#ifndef C_CHAT_BITMAP_H
+#define C_CHAT_BITMAP_H
+
+#include "atomics.h"
+
+/**
+ * \def BITMAP_WORD_BITS
+ * \brief Number of slots tracked by a word of a bitmap
+ */
+#define BITMAP_WORD_BITS 64
+
+/**
+ * \def BITMAP_WORDS
+ * \brief Number of words of a bitmap tracking the given amount of slots
+ */
+#define BITMAP_WORDS(capacity) (((capacity) + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS)
+
+/**
+ * \brief A word of a bitmap
+ */
+typedef unsigned long long BitmapWord;
+
+#if defined(__GNUC__) || defined(__clang__)
+
+/**
+ * \brief Retrieves the index of the lowest set bit of the given word, which MUST NOT be 0.
+ */
+static inline unsigned int bitmap_ctz(BitmapWord word) {
+    return __builtin_ctzll(word);
+}
+
+/**
+ * \brief Retrieves the amount of set bits of the given word.
+ */
+static inline unsigned int bitmap_popcount(BitmapWord word) {
+    return __builtin_popcountll(word);
+}
+
+#elif defined(_MSC_VER)
+
+#include <intrin.h>
+
+static inline unsigned int bitmap_ctz(BitmapWord word) {
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return index;
+}
+
+static inline unsigned int bitmap_popcount(BitmapWord word) {
+    return (unsigned int) __popcnt64(word);
+}
+
+#endif
+
+/**
+ * \brief Frees all slots of the given bitmap.
+ *
+ * \param bitmap The bitmap to clear
+ * \param capacity The amount of slots tracked by the bitmap
+ */
+static inline void bitmap_clearAll(BitmapWord* bitmap, unsigned int capacity) {
+    for (unsigned int i = 0; i < BITMAP_WORDS(capacity); i++) {
+        bitmap[i] = 0;
+    }
+}
+
+/**
+ * \brief Checks whether the given slot is taken.
+ *
+ * \param bitmap The bitmap to look into
+ * \param index The slot index
+ * \return 1 if the slot is taken, else 0
+ */
+static inline int bitmap_isSet(const BitmapWord* bitmap, unsigned int index) {
+    return (bitmap[index / BITMAP_WORD_BITS] >> (index % BITMAP_WORD_BITS)) & 1;
+}
+
+/**
+ * \brief Marks the given slot as taken.
+ *
+ * \param bitmap The bitmap to modify
+ * \param index The slot index
+ */
+static inline void bitmap_set(BitmapWord* bitmap, unsigned int index) {
+    bitmap[index / BITMAP_WORD_BITS] |= 1ULL << (index % BITMAP_WORD_BITS);
+}
+
+/**
+ * \brief Marks the given slot as free.
+ *
+ * \param bitmap The bitmap to modify
+ * \param index The slot index
+ */
+static inline void bitmap_release(BitmapWord* bitmap, unsigned int index) {
+    bitmap[index / BITMAP_WORD_BITS] &= ~(1ULL << (index % BITMAP_WORD_BITS));
+}
+
+/**
+ * \brief Takes the free slot with the lowest index.
+ *
+ * \param bitmap The bitmap to look into
+ * \param capacity The amount of slots tracked by the bitmap
+ * \return the taken slot index, -1 if all slots are taken
+ */
+static inline int bitmap_acquire(BitmapWord* bitmap, unsigned int capacity) {
+    for (unsigned int i = 0; i < BITMAP_WORDS(capacity); i++) {
+        BitmapWord available = ~bitmap[i];
+        if (available != 0) {
+            unsigned int index = i * BITMAP_WORD_BITS + bitmap_ctz(available);
+            /* Bits of the last word past the capacity are never set */
+            if (index >= capacity) {
+                return -1;
+            }
+            bitmap[i] |= available & -available;
+            return index;
+        }
+    }
+    return -1;
+}
+
+/**
+ * \brief Finds the first taken slot from the given index.
+ *
+ * \param bitmap The bitmap to look into
+ * \param capacity The amount of slots tracked by the bitmap
+ * \param from The index to start looking from
+ * \return the slot index, -1 if no slot is taken from the given index
+ */
+static inline int bitmap_next(const BitmapWord* bitmap, unsigned int capacity, unsigned int from) {
+    if (from >= capacity) {
+        return -1;
+    }
+
+    unsigned int i = from / BITMAP_WORD_BITS;
+    BitmapWord word = bitmap[i] & (~0ULL << (from % BITMAP_WORD_BITS));
+    while (word == 0) {
+        if (++i == BITMAP_WORDS(capacity)) {
+            return -1;
+        }
+        word = bitmap[i];
+    }
+    return i * BITMAP_WORD_BITS + bitmap_ctz(word);
+}
+
+/**
+ * \brief Counts the taken slots.
+ *
+ * \param bitmap The bitmap to look into
+ * \param capacity The amount of slots tracked by the bitmap
+ * \return the amount of taken slots
+ */
+static inline unsigned int bitmap_count(const BitmapWord* bitmap, unsigned int capacity) {
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < BITMAP_WORDS(capacity); i++) {
+        count += bitmap_popcount(bitmap[i]);
+    }
+    return count;
+}
+
+/**
+ * \brief Takes the free slot with the lowest index, other threads may modify the bitmap meanwhile.
+ *
+ * \param bitmap The bitmap to look into
+ * \param capacity The amount of slots tracked by the bitmap
+ * \return the taken slot index, -1 if all slots are taken
+ */
+static inline int bitmap_acquireShared(volatile BitmapWord* bitmap, unsigned int capacity) {
+    for (unsigned int i = 0; i < BITMAP_WORDS(capacity); i++) {
+        BitmapWord word = atomics_load64(&bitmap[i]);
+        while (~word != 0) {
+            BitmapWord available = ~word;
+            unsigned int index = i * BITMAP_WORD_BITS + bitmap_ctz(available);
+            if (index >= capacity) {
+                return -1;
+            }
+            if (atomics_compareExchange64(&bitmap[i], word, word | (available & -available))) {
+                return index;
+            }
+            word = atomics_load64(&bitmap[i]);
+        }
+    }
+    return -1;
+}
+
+/**
+ * \brief Marks the given slot as free, other threads may modify the bitmap meanwhile.
+ *
+ * \param bitmap The bitmap to modify
+ * \param index The slot index
+ */
+static inline void bitmap_releaseShared(volatile BitmapWord* bitmap, unsigned int index) {
+    volatile BitmapWord* word = &bitmap[index / BITMAP_WORD_BITS];
+    BitmapWord mask = 1ULL << (index % BITMAP_WORD_BITS);
+    BitmapWord read;
+    do {
+        read = atomics_load64(word);
+    } while (!atomics_compareExchange64(word, read, read & ~mask));
+}
+
+#endif //C_CHAT_BITMAP_H
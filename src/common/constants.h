@@ -28,6 +28,54 @@
  */
 #define FILE_TRANSFER_CHUNK_SIZE 200
 
+#ifndef FILE_TRANSFER_WINDOW_BYTES
+/**
+ * \def FILE_TRANSFER_WINDOW_BYTES
+ * \brief Amount of bytes of a file transfer sent ahead of the acknowledgements of the receiver
+ *
+ * Large enough to keep a transfer going at full speed, small enough for other packets not to wait behind file data.
+ */
+#define FILE_TRANSFER_WINDOW_BYTES 262144
+#endif
+
+/**
+ * \def FILE_TRANSFER_ACK_BYTES
+ * \brief Amount of bytes of a file transfer received between acknowledgements
+ */
+#define FILE_TRANSFER_ACK_BYTES (FILE_TRANSFER_WINDOW_BYTES / 4)
+
+/**
+ * \def FILE_TRANSFER_ACK_TIMEOUT_MILLIS
+ * \brief Delay after which a file transfer waiting for acknowledgements is aborted (milliseconds)
+ */
+#define FILE_TRANSFER_ACK_TIMEOUT_MILLIS 30000
+
+/**
+ * \def HASH_TREE_BLOCK_BYTES
+ * \brief Size of the blocks files are hashed by, each checked on its own when downloaded (see hash-tree.h)
+ */
+#define HASH_TREE_BLOCK_BYTES 65536
+
+/**
+ * \def HASH_TREE_MAX_DEPTH
+ * \brief Maximum amount of hashes proving a block, enough for any amount of blocks
+ */
+#define HASH_TREE_MAX_DEPTH 32
+
+/**
+ * \def HASH_TREE_HASH_BYTES
+ * \brief Size of the hashes of a hash tree (bytes)
+ */
+#define HASH_TREE_HASH_BYTES 32
+
+/**
+ * \def HASH_TREE_PROOF_HASHES
+ * \brief Maximum amount of hashes of a proof sent in a single packet, longer proofs are split
+ *
+ * Kept small enough for proof packets not to be larger than text packets, the largest ones.
+ */
+#define HASH_TREE_PROOF_HASHES 7
+
 /**
  * \def MAX_FILE_SIZE_UPLOAD
  * \brief Maximum allowed size for file upload (bytes)
@@ -41,6 +89,12 @@
  */
 #define MAX_CONCURRENT_FILE_TRANSFER 2
 
+/**
+ * \def MAX_DOWNLOAD_STREAMS
+ * \brief Maximum ranges of files downloaded at once per client
+ */
+#define MAX_DOWNLOAD_STREAMS 4
+
 /**
  * \def ROOM_NAME_MAX_LENGTH
  * \brief The maximum length for a name of a room
@@ -59,12 +113,26 @@
  */
 #define MAX_USERS_PER_ROOM 10
 
+#ifndef LARGE_ROOM_MAX_USERS
+/**
+ * \def LARGE_ROOM_MAX_USERS
+ * \brief The maximum amount of users connected simultaneously to a large room
+ */
+#define LARGE_ROOM_MAX_USERS 50000
+#endif
+
 /**
  * \def NUMBER_ROOM_MAX
  * \brief The maximum of supported rooms
  */
 #define NUMBER_ROOM_MAX 20
 
+/**
+ * \def SPECTATE_HANDSHAKE_PREFIX
+ * \brief Sent instead of a username, followed by a room name, to watch the room as a spectator
+ */
+#define SPECTATE_HANDSHAKE_PREFIX "/spectate "
+
 //---------------------------------------------------------//
 //              MESSAGES TYPES DEFINITION                  //
 //---------------------------------------------------------//
@@ -177,4 +245,40 @@
  */
 #define LIST_ROOMS_MESSAGE_TYPE 17
 
+/**
+ * \def PING_MESSAGE_TYPE
+ * \brief An integer representing a message sent by server to check the client is still alive
+ */
+#define PING_MESSAGE_TYPE 18
+
+/**
+ * \def PONG_MESSAGE_TYPE
+ * \brief An integer representing a message sent by client to answer a ping
+ */
+#define PONG_MESSAGE_TYPE 19
+
+/**
+ * \def STATS_REQUEST_MESSAGE_TYPE
+ * \brief An integer representing a message sent by client to ask for server statistics
+ */
+#define STATS_REQUEST_MESSAGE_TYPE 20
+
+/**
+ * \def FILE_DATA_ACK_MESSAGE_TYPE
+ * \brief An integer representing a message sent by the receiver of file data to acknowledge it
+ */
+#define FILE_DATA_ACK_MESSAGE_TYPE 21
+
+/**
+ * \def FILE_BLOCK_PROOF_MESSAGE_TYPE
+ * \brief An integer representing a message sent by server to client to prove a block of a downloaded file
+ */
+#define FILE_BLOCK_PROOF_MESSAGE_TYPE 22
+
+/**
+ * \def FILE_UPLOAD_DIGEST_MESSAGE_TYPE
+ * \brief An integer representing a message sent by client to server after the data of an uploaded file, to check it
+ */
+#define FILE_UPLOAD_DIGEST_MESSAGE_TYPE 23
+
 #endif //C_CHAT_CONSTANTS_H
@@ -0,0 +1,116 @@
+#include "crc32c.h"
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+#define CRC32C_HARDWARE 1
+#include <nmmintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define CRC32C_TARGET
+#else
+#define CRC32C_TARGET __attribute__((target("sse4.2")))
+#endif
+#else
+#define CRC32C_HARDWARE 0
+#endif
+
+/**
+ * \def CRC32C_POLYNOMIAL
+ * \brief The Castagnoli polynomial, in reversed bit order
+ */
+#define CRC32C_POLYNOMIAL 0x82F63B78
+
+/** table[k][b] is the checksum of byte b followed by k zero bytes */
+static unsigned int table[8][256];
+/** Equal to 1 if the processor computes checksums */
+static int accelerated = 0;
+
+void crc32c_init() {
+    for (unsigned int i = 0; i < 256; i++) {
+        unsigned int crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = crc & 1 ? (crc >> 1) ^ CRC32C_POLYNOMIAL : crc >> 1;
+        }
+        table[0][i] = crc;
+    }
+    for (unsigned int i = 0; i < 256; i++) {
+        for (int k = 1; k < 8; k++) {
+            table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xFF];
+        }
+    }
+
+#if CRC32C_HARDWARE && defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    accelerated = (info[2] & (1 << 20)) != 0;
+#elif CRC32C_HARDWARE
+    __builtin_cpu_init();
+    accelerated = __builtin_cpu_supports("sse4.2") != 0;
+#endif
+}
+
+/**
+ * \brief Updates the given raw checksum 8 bytes at a time, using the tables.
+ *
+ * Bytes are combined one by one, so the result doesn't depend on the endianness.
+ */
+unsigned int softwareUpdate(unsigned int crc, const unsigned char* data, unsigned long long length) {
+    while (length >= 8) {
+        unsigned int low = crc ^ (data[0] | data[1] << 8 | data[2] << 16 | (unsigned int) data[3] << 24);
+        unsigned int high = data[4] | data[5] << 8 | data[6] << 16 | (unsigned int) data[7] << 24;
+        crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^ table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24]
+            ^ table[3][high & 0xFF] ^ table[2][(high >> 8) & 0xFF] ^ table[1][(high >> 16) & 0xFF] ^ table[0][high >> 24];
+        data += 8;
+        length -= 8;
+    }
+
+    while (length > 0) {
+        crc = table[0][(crc ^ *data) & 0xFF] ^ (crc >> 8);
+        data++;
+        length--;
+    }
+
+    return crc;
+}
+
+#if CRC32C_HARDWARE
+
+/**
+ * \brief Updates the given raw checksum 8 bytes at a time, using the CRC32 instruction.
+ */
+CRC32C_TARGET unsigned int hardwareUpdate(unsigned int crc, const unsigned char* data, unsigned long long length) {
+    unsigned long long crc64 = crc;
+    while (length >= 8) {
+        unsigned long long word;
+        memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        data += 8;
+        length -= 8;
+    }
+
+    crc = (unsigned int) crc64;
+    while (length > 0) {
+        crc = _mm_crc32_u8(crc, *data);
+        data++;
+        length--;
+    }
+
+    return crc;
+}
+
+#endif
+
+unsigned int crc32c_update(unsigned int crc, const char* data, unsigned long long length) {
+    /* The raw checksum starts with all bits set, and is inverted once done */
+    crc = ~crc;
+#if CRC32C_HARDWARE
+    if (accelerated) {
+        return ~hardwareUpdate(crc, (const unsigned char*) data, length);
+    }
+#endif
+    return ~softwareUpdate(crc, (const unsigned char*) data, length);
+}
+
+int crc32c_isAccelerated() {
+    return accelerated;
+}
@@ -0,0 +1,39 @@
+/**
+ * \file crc32c.h
+ * \brief Computes CRC32C (Castagnoli) checksums, checking the integrity of transferred files.
+ *
+ * The checksum is updated chunk by chunk, as file data is sent or received, so checking a file
+ * doesn't need another pass over it. The CRC32 instruction of SSE4.2 is used when the processor
+ * supports it, else a table-driven version processing 8 bytes at a time.
+ */
+
+#ifndef C_CHAT_CRC32C_H
+#define C_CHAT_CRC32C_H
+
+/**
+ * \brief Builds the tables of the software version and detects processor support.
+ *
+ * MUST be called once before any other function of this file.
+ */
+void crc32c_init();
+
+/**
+ * \brief Updates the checksum of some data with the data following it.
+ *
+ * The checksum of "123456789" is 0xE3069283.
+ *
+ * \param crc The checksum of the previous data, 0 for the first data
+ * \param data The following data
+ * \param length The size of the following data
+ * \return the checksum of the whole data
+ */
+unsigned int crc32c_update(unsigned int crc, const char* data, unsigned long long length);
+
+/**
+ * \brief Tells whether checksums are computed by the processor.
+ *
+ * \return 1 if the processor computes checksums, 0 if the software version is used
+ */
+int crc32c_isAccelerated();
+
+#endif //C_CHAT_CRC32C_H
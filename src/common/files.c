@@ -2,6 +2,10 @@
 #include "interop.h"
 #include <stdio.h>
 
+int files_deleteFile(const char* filename) {
+    return remove(filename) == 0 ? 0 : -1;
+}
+
 #if IS_POSIX
 
 #include <sys/stat.h>
@@ -53,6 +57,30 @@ unsigned long files_readFile(const char* filename, char* contentBuffer, unsigned
     return readLength;
 }
 
+unsigned long files_readFileAt(const char* filename, long long offset, char* contentBuffer, unsigned long bufferSize) {
+    FileInfo info = files_getInfo(filename);
+    if (info.isDirectory || offset > info.size) {
+        return -1;
+    }
+
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL) {
+        printf("Unable to open file: %s\n", filename);
+        return -1;
+    }
+
+    if (fseeko(file, (off_t) offset, SEEK_SET) != 0) {
+        printf("Unable to read file: %s\n", filename);
+        fclose(file);
+        return -1;
+    }
+
+    unsigned long readLength = fread(contentBuffer, sizeof(char), bufferSize, file);
+    fclose(file);
+
+    return readLength;
+}
+
 unsigned long files_writeFile(const char* filename, const char* contentBuffer, unsigned long bufferSize) {
     FileInfo info = files_getInfo(filename);
     if (info.isDirectory) {
@@ -77,6 +105,10 @@ unsigned long files_writeFile(const char* filename, const char* contentBuffer, u
     return writtenLength;
 }
 
+int files_renameFile(const char* filename, const char* newFilename) {
+    return rename(filename, newFilename) == 0 ? 0 : -1;
+}
+
 #elif IS_WINDOWS
 
 #define WIN32_LEAN_AND_MEAN
@@ -129,6 +161,31 @@ unsigned long files_readFile(const char* filename, char* contentBuffer, unsigned
     return readCount;
 }
 
+unsigned long files_readFileAt(const char* filename, long long offset, char* contentBuffer, unsigned long bufferSize) {
+    FileInfo info = files_getInfo(filename);
+    if (info.isDirectory || offset > info.size) {
+        return -1;
+    }
+    HANDLE file = CreateFile(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        printf("Unable to open file: %s\n", filename);
+        return -1;
+    }
+
+    LARGE_INTEGER position;
+    position.QuadPart = offset;
+    unsigned long readCount;
+    if (!SetFilePointerEx(file, position, NULL, FILE_BEGIN) || !ReadFile(file, contentBuffer, bufferSize, &readCount, NULL)) {
+        printf("Unable to read file: %s\n", filename);
+        printf("Error code: %ld\n", GetLastError());
+        CloseHandle(file);
+        return -1;
+    }
+    CloseHandle(file);
+
+    return readCount;
+}
+
 unsigned long files_writeFile(const char* filename, const char* contentBuffer, unsigned long bufferSize) {
     FileInfo info = files_getInfo(filename);
     if (info.exists && info.isDirectory) {
@@ -154,4 +211,9 @@ unsigned long files_writeFile(const char* filename, const char* contentBuffer, u
     return wroteCount;
 }
 
+int files_renameFile(const char* filename, const char* newFilename) {
+    /* Unlike POSIX rename, the one of the C runtime fails if the destination exists */
+    return MoveFileEx(filename, newFilename, MOVEFILE_REPLACE_EXISTING) ? 0 : -1;
+}
+
 #endif
@@ -43,6 +43,23 @@ FileInfo files_getInfo(const char* filename);
  */
 unsigned long files_readFile(const char* filename, char* contentBuffer, unsigned long bufferSize);
 
+/**
+ * \brief Reads a part of the given file
+ *
+ * An error can occur if :
+ *  - the given file is a directory
+ *  - the given file is protected against reading
+ *  - the given offset is past the end of the file
+ *
+ * \param filename The name of the file to read
+ * \param offset The offset to start reading the file at
+ * \param contentBuffer The buffer to store file content in
+ * \param bufferSize The size of the given buffer
+ *
+ * \return the actually read size or -1 if an error occurred
+ */
+unsigned long files_readFileAt(const char* filename, long long offset, char* contentBuffer, unsigned long bufferSize);
+
 /**
  * \brief Writes the given file
  *
@@ -59,4 +76,25 @@ unsigned long files_readFile(const char* filename, char* contentBuffer, unsigned
  */
 unsigned long files_writeFile(const char* filename, const char* contentBuffer, unsigned long bufferSize);
 
+/**
+ * \brief Deletes the given file
+ *
+ * \param filename The name of the file to delete
+ *
+ * \return 0 if the file was deleted, -1 if an error occurred
+ */
+int files_deleteFile(const char* filename);
+
+/**
+ * \brief Renames the given file, replacing the destination if it exists
+ *
+ * The destination is replaced at once : it's seen either with its old content or with the new one.
+ *
+ * \param filename The name of the file to rename
+ * \param newFilename The new name of the file
+ *
+ * \return 0 if the file was renamed, -1 if an error occurred
+ */
+int files_renameFile(const char* filename, const char* newFilename);
+
 #endif //C_CHAT_FILES_H
@@ -0,0 +1,130 @@
+#include "hash-tree.h"
+#include <string.h>
+#include "sha256.h"
+
+/**
+ * \def HASH_TREE_BLOCK_PREFIX
+ * \brief Byte hashed before the content of a block
+ */
+#define HASH_TREE_BLOCK_PREFIX 0
+
+/**
+ * \def HASH_TREE_PARENT_PREFIX
+ * \brief Byte hashed before the two children of a node
+ */
+#define HASH_TREE_PARENT_PREFIX 1
+
+/**
+ * \brief Hashes two sibling nodes into their parent.
+ */
+TreeHash combineHashes(const TreeHash* left, const TreeHash* right) {
+    char prefix = HASH_TREE_PARENT_PREFIX;
+    Sha256 sha;
+    sha256_init(&sha);
+    sha256_update(&sha, &prefix, 1);
+    sha256_update(&sha, (const char*) left->bytes, HASH_TREE_HASH_BYTES);
+    sha256_update(&sha, (const char*) right->bytes, HASH_TREE_HASH_BYTES);
+
+    TreeHash parent;
+    sha256_final(&sha, parent.bytes);
+    return parent;
+}
+
+unsigned int hashTree_blockCount(long long fileSize) {
+    if (fileSize <= 0) {
+        return 1;
+    }
+
+    return (unsigned int) ((fileSize + HASH_TREE_BLOCK_BYTES - 1) / HASH_TREE_BLOCK_BYTES);
+}
+
+unsigned int hashTree_nodeCount(unsigned int blockCount) {
+    unsigned int count = blockCount;
+    unsigned int width = blockCount;
+    while (width > 1) {
+        width = (width + 1) / 2;
+        count += width;
+    }
+
+    return count;
+}
+
+TreeHash hashTree_hashBlock(const char* data, unsigned int length) {
+    char prefix = HASH_TREE_BLOCK_PREFIX;
+    Sha256 sha;
+    sha256_init(&sha);
+    sha256_update(&sha, &prefix, 1);
+    sha256_update(&sha, data, length);
+
+    TreeHash hash;
+    sha256_final(&sha, hash.bytes);
+    return hash;
+}
+
+void hashTree_build(TreeHash* nodes, unsigned int blockCount) {
+    TreeHash* level = nodes;
+    unsigned int width = blockCount;
+    while (width > 1) {
+        TreeHash* parents = level + width;
+        for (unsigned int i = 0; 2 * i < width; i++) {
+            parents[i] = 2 * i + 1 < width ? combineHashes(&level[2 * i], &level[2 * i + 1]) : level[2 * i];
+        }
+
+        level = parents;
+        width = (width + 1) / 2;
+    }
+}
+
+TreeHash hashTree_root(const TreeHash* nodes, unsigned int blockCount) {
+    return nodes[hashTree_nodeCount(blockCount) - 1];
+}
+
+unsigned int hashTree_proof(const TreeHash* nodes, unsigned int blockCount, unsigned int block, TreeHash* siblings) {
+    unsigned int count = 0;
+    const TreeHash* level = nodes;
+    unsigned int width = blockCount;
+    unsigned int index = block;
+    while (width > 1) {
+        unsigned int sibling = index ^ 1;
+        if (sibling < width) {
+            siblings[count] = level[sibling];
+            count++;
+        }
+
+        level += width;
+        width = (width + 1) / 2;
+        index /= 2;
+    }
+
+    return count;
+}
+
+int hashTree_verify(const TreeHash* hash, unsigned int block, unsigned int blockCount, const TreeHash* siblings, const TreeHash* root) {
+    if (block >= blockCount) {
+        return 0;
+    }
+
+    /* Halving the width of levels at most HASH_TREE_MAX_DEPTH times reaches the root */
+    TreeHash node = *hash;
+    unsigned int count = 0;
+    unsigned int width = blockCount;
+    unsigned int index = block;
+    while (width > 1) {
+        if (index % 2 == 1) {
+            node = combineHashes(&siblings[count], &node);
+            count++;
+        } else if (index + 1 < width) {
+            node = combineHashes(&node, &siblings[count]);
+            count++;
+        }
+
+        width = (width + 1) / 2;
+        index /= 2;
+    }
+
+    return hashTree_equals(&node, root);
+}
+
+int hashTree_equals(const TreeHash* first, const TreeHash* second) {
+    return memcmp(first->bytes, second->bytes, HASH_TREE_HASH_BYTES) == 0;
+}
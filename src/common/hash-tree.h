@@ -0,0 +1,104 @@
+/**
+ * \file hash-tree.h
+ * \brief Hashes files by blocks into a tree, so any block can be checked on its own.
+ *
+ * A file is cut into blocks of HASH_TREE_BLOCK_BYTES bytes, hashed with SHA-256 (see sha256.h).
+ * Each node of the tree is the hash of its two children, and the root identifies the whole file.
+ * A block is checked against the root with the hashes of its siblings along the way up, its proof :
+ * blocks of a file can then be checked as they arrive, in any order and from any range.
+ *
+ * Finding data matching a SHA-256 hash is out of reach, so a block matching a trusted root is the
+ * block of the file, whoever sent it : only the root has to come from a trusted source. Blocks and
+ * parents are hashed with a different leading byte, so a pair of hashes can't pass for a block.
+ * Transmission errors of single transfers are still caught by CRC32C (see crc32c.h), which is cheaper.
+ *
+ * Nodes are stored level by level, the blocks first and the root last. A level of odd width
+ * doesn't hash its last node, it's the node of the next level as is.
+ */
+
+#ifndef C_CHAT_HASH_TREE_H
+#define C_CHAT_HASH_TREE_H
+
+#include "constants.h"
+
+/**
+ * \struct TreeHash
+ * \brief A node of a hash tree, the hash of a block or of two nodes
+ */
+typedef struct TreeHash {
+    unsigned char bytes[HASH_TREE_HASH_BYTES];
+} TreeHash;
+
+/**
+ * \brief Computes the amount of blocks of a file, at least 1.
+ *
+ * \param fileSize The size of the file (bytes)
+ * \return the amount of blocks of the file
+ */
+unsigned int hashTree_blockCount(long long fileSize);
+
+/**
+ * \brief Computes the amount of nodes of the tree of a file.
+ *
+ * \param blockCount The amount of blocks of the file
+ * \return the amount of nodes of the tree, the blocks included
+ */
+unsigned int hashTree_nodeCount(unsigned int blockCount);
+
+/**
+ * \brief Hashes the given block of a file.
+ *
+ * \param data The content of the block
+ * \param length The size of the block, HASH_TREE_BLOCK_BYTES unless it's the last block
+ * \return the hash of the block
+ */
+TreeHash hashTree_hashBlock(const char* data, unsigned int length);
+
+/**
+ * \brief Computes the nodes above the blocks of a tree.
+ *
+ * \param nodes The nodes of the tree, starting with the hashes of the blocks
+ * \param blockCount The amount of blocks of the file
+ */
+void hashTree_build(TreeHash* nodes, unsigned int blockCount);
+
+/**
+ * \brief Retrieves the root of a tree, identifying the whole file.
+ *
+ * \param nodes The nodes of the tree
+ * \param blockCount The amount of blocks of the file
+ * \return the hash at the root of the tree
+ */
+TreeHash hashTree_root(const TreeHash* nodes, unsigned int blockCount);
+
+/**
+ * \brief Collects the proof of the given block.
+ *
+ * \param nodes The nodes of the tree
+ * \param blockCount The amount of blocks of the file
+ * \param block The index of the block to prove
+ * \param siblings The buffer to store the proof in, HASH_TREE_MAX_DEPTH hashes long
+ * \return the amount of hashes of the proof
+ */
+unsigned int hashTree_proof(const TreeHash* nodes, unsigned int blockCount, unsigned int block, TreeHash* siblings);
+
+/**
+ * \brief Checks the hash of a block against the root of the tree, using its proof.
+ *
+ * \param hash The hash of the block
+ * \param block The index of the block
+ * \param blockCount The amount of blocks of the file
+ * \param siblings The proof of the block
+ * \param root The root of the tree
+ * \return 1 if the block belongs to the tree with the given root, else 0
+ */
+int hashTree_verify(const TreeHash* hash, unsigned int block, unsigned int blockCount, const TreeHash* siblings, const TreeHash* root);
+
+/**
+ * \brief Compares two hashes.
+ *
+ * \return 1 if the hashes are equal, else 0
+ */
+int hashTree_equals(const TreeHash* first, const TreeHash* second);
+
+#endif //C_CHAT_HASH_TREE_H
@@ -0,0 +1,91 @@
+#include "mpsc-queue.h"
+#include <stdlib.h>
+
+struct MpscCell {
+    /**
+     * Equal to the position when the cell is free for the producer claiming this position,
+     * to the position + 1 once the item is pushed
+     */
+    volatile unsigned int sequence;
+    void* item;
+};
+
+/**
+ * \brief Rounds the given number up to a power of 2.
+ */
+unsigned int mpsc_roundCapacity(unsigned int capacity) {
+    unsigned int rounded = 2;
+    while (rounded < capacity) {
+        rounded <<= 1;
+    }
+    return rounded;
+}
+
+MpscQueue* mpsc_create(unsigned int capacity) {
+    capacity = mpsc_roundCapacity(capacity);
+
+    MpscQueue* queue = malloc(sizeof(MpscQueue));
+    queue->cells = malloc(sizeof(struct MpscCell) * capacity);
+    for (unsigned int i = 0; i < capacity; i++) {
+        queue->cells[i].sequence = i;
+        queue->cells[i].item = NULL;
+    }
+    queue->mask = capacity - 1;
+    queue->tail = 0;
+    queue->head = 0;
+
+    return queue;
+}
+
+void mpsc_destroy(MpscQueue* queue) {
+    free(queue->cells);
+    free(queue);
+}
+
+int mpsc_push(MpscQueue* queue, void* item) {
+    unsigned int position = atomics_load(&queue->tail);
+    struct MpscCell* cell;
+
+    while (1) {
+        cell = &queue->cells[position & queue->mask];
+        int difference = (int) (atomics_load(&cell->sequence) - position);
+
+        if (difference == 0) {
+            /* The cell is free, trying to claim it */
+            if (atomics_compareExchange(&queue->tail, position, position + 1)) {
+                break;
+            }
+            position = atomics_load(&queue->tail);
+        } else if (difference < 0) {
+            /* The cell still holds the item pushed a full turn ago */
+            return 0;
+        } else {
+            /* Another producer claimed this position */
+            position = atomics_load(&queue->tail);
+        }
+    }
+
+    cell->item = item;
+    /* Publishes the item to the consumer */
+    atomics_store(&cell->sequence, position + 1);
+    return 1;
+}
+
+void* mpsc_pop(MpscQueue* queue) {
+    unsigned int position = queue->head;
+    struct MpscCell* cell = &queue->cells[position & queue->mask];
+
+    if (atomics_load(&cell->sequence) != position + 1) {
+        return NULL;
+    }
+
+    void* item = cell->item;
+    /* Frees the cell for the producer claiming it on the next turn */
+    atomics_store(&cell->sequence, position + queue->mask + 1);
+    queue->head = position + 1;
+    return item;
+}
+
+int mpsc_isEmpty(MpscQueue* queue) {
+    return atomics_load(&queue->cells[queue->head & queue->mask].sequence) != queue->head + 1;
+}
@@ -0,0 +1,83 @@
+/**
+ * \file mpsc-queue.h
+ * \brief A bounded lock-free queue for several producer threads and a single consumer thread.
+ *
+ * Items are pointers stored in a ring buffer of cells. Each cell carries a sequence number
+ * telling whether it's free for the producer claiming this position or filled for the consumer.
+ * Producers claim positions with a compare-and-swap on the tail, so they never wait for the
+ * consumer nor take a lock : when the queue is full, pushing fails and the producer decides
+ * what to do.
+ *
+ * Pair it with a Notifier (see notifier.h) to let the consumer sleep while the queue is empty.
+ */
+
+#ifndef C_CHAT_MPSC_QUEUE_H
+#define C_CHAT_MPSC_QUEUE_H
+
+#include "atomics.h"
+
+struct MpscCell;
+
+/**
+ * \class MpscQueue
+ * \brief A bounded multi-producer single-consumer queue
+ */
+typedef struct MpscQueue {
+    struct MpscCell* cells;
+    /** Capacity - 1, the capacity being a power of 2 */
+    unsigned int mask;
+    char padding0[ATOMICS_CACHE_LINE];
+
+    /** Next position to claim, shared by producers */
+    volatile unsigned int tail;
+    char padding1[ATOMICS_CACHE_LINE];
+
+    /** Next position to pop, used by the consumer only */
+    unsigned int head;
+    char padding2[ATOMICS_CACHE_LINE];
+} MpscQueue;
+
+/**
+ * \brief Creates a queue.
+ *
+ * \param capacity The minimum amount of items the queue can hold, rounded up to a power of 2
+ * \return a heap-allocated queue, to be destroyed using mpsc_destroy
+ */
+MpscQueue* mpsc_create(unsigned int capacity);
+
+/**
+ * \brief Destroys the given queue. Items still queued are NOT freed.
+ *
+ * \param queue The queue to destroy
+ */
+void mpsc_destroy(MpscQueue* queue);
+
+/**
+ * \brief Pushes an item at the end of the queue. Can be called by any thread.
+ *
+ * \param queue The queue to push to
+ * \param item The item to push
+ * \return 1 if the item was pushed, 0 if the queue is full
+ */
+int mpsc_push(MpscQueue* queue, void* item);
+
+/**
+ * \brief Pops the item at the front of the queue. Called by the consumer only.
+ *
+ * An item being pushed is only visible once its producer is done with it, so this function
+ * can return NULL while a push is in progress. The producer notifies the consumer afterwards.
+ *
+ * \param queue The queue to pop from
+ * \return the popped item or NULL if the queue is empty
+ */
+void* mpsc_pop(MpscQueue* queue);
+
+/**
+ * \brief Checks whether an item is ready to be popped. Called by the consumer only.
+ *
+ * \param queue The queue to check
+ * \return 1 if the queue has no item ready, else 0
+ */
+int mpsc_isEmpty(MpscQueue* queue);
+
+#endif //C_CHAT_MPSC_QUEUE_H
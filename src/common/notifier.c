@@ -0,0 +1,248 @@
+#include "notifier.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "atomics.h"
+#include "interop.h"
+
+/**
+ * \def NOTIFIER_POLL_STACK_COUNT
+ * \brief Amount of descriptors notifier_waitForRoom waits for without allocating
+ */
+#define NOTIFIER_POLL_STACK_COUNT 16
+
+/**
+ * \brief Wakes the parked consumer up. Only one producer calls it for each park.
+ */
+void notifier_signal(Notifier* notifier);
+
+/**
+ * \brief Blocks until notifier_signal is called, or returns at once if it was already called.
+ */
+void notifier_block(Notifier* notifier);
+
+/**
+ * \brief Blocks until notifier_signal is called or the delay expires.
+ *
+ * \return 1 if the signal was consumed, 0 if the delay expired
+ */
+int notifier_blockFor(Notifier* notifier, unsigned int milliseconds);
+
+/**
+ * \brief Blocks until notifier_signal is called, one of the given sockets can be sent to or the delay expires.
+ *
+ * \return 1 if the signal was consumed, else 0
+ */
+int notifier_blockForRoom(Notifier* notifier, const Socket* sockets, unsigned int count, char* ready, int milliseconds);
+
+void notifier_notify(Notifier* notifier) {
+    /* Orders the publication of the work before reading the waiting flag */
+    atomics_fence();
+    if (atomics_load(&notifier->waiting) && atomics_exchange(&notifier->waiting, 0)) {
+        notifier_signal(notifier);
+    }
+}
+
+void notifier_prepareWait(Notifier* notifier) {
+    /* The exchange orders setting the flag before checking for work */
+    atomics_exchange(&notifier->waiting, 1);
+}
+
+void notifier_cancelWait(Notifier* notifier) {
+    /*
+     * A producer may have cleared the flag and signaled in the meantime, the signal
+     * then stays pending and the next wait returns at once, which is harmless.
+     */
+    atomics_exchange(&notifier->waiting, 0);
+}
+
+void notifier_wait(Notifier* notifier) {
+    notifier_block(notifier);
+    atomics_exchange(&notifier->waiting, 0);
+}
+
+int notifier_waitFor(Notifier* notifier, unsigned int milliseconds) {
+    if (notifier_blockFor(notifier, milliseconds)) {
+        atomics_exchange(&notifier->waiting, 0);
+        return 1;
+    }
+
+    /* A producer clearing the flag meanwhile signals : the consumer was notified, the signal stays pending */
+    return atomics_exchange(&notifier->waiting, 0) == 0;
+}
+
+int notifier_waitForRoom(Notifier* notifier, const Socket* sockets, unsigned int count, char* ready, int milliseconds) {
+    if (notifier_blockForRoom(notifier, sockets, count, ready, milliseconds)) {
+        atomics_exchange(&notifier->waiting, 0);
+        return 1;
+    }
+
+    return atomics_exchange(&notifier->waiting, 0) == 0;
+}
+
+#if IS_POSIX
+
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <poll.h>
+
+    #if defined(__linux__)
+    #include <sys/eventfd.h>
+    #endif
+
+    struct UnixNotifier {
+        int readDescriptor;
+        int writeDescriptor;
+    };
+
+    void notifier_init(Notifier* notifier) {
+        struct UnixNotifier* unixNotifier = malloc(sizeof(struct UnixNotifier));
+
+    #if defined(__linux__)
+        int descriptor = eventfd(0, EFD_CLOEXEC);
+        if (descriptor == -1) {
+            printf("Unable to create notifier.\n");
+            exit(EXIT_FAILURE);
+        }
+        unixNotifier->readDescriptor = descriptor;
+        unixNotifier->writeDescriptor = descriptor;
+    #else
+        int descriptors[2];
+        if (pipe(descriptors) == -1) {
+            printf("Unable to create notifier.\n");
+            exit(EXIT_FAILURE);
+        }
+        fcntl(descriptors[0], F_SETFD, FD_CLOEXEC);
+        fcntl(descriptors[1], F_SETFD, FD_CLOEXEC);
+        unixNotifier->readDescriptor = descriptors[0];
+        unixNotifier->writeDescriptor = descriptors[1];
+    #endif
+
+        notifier->waiting = 0;
+        notifier->info = unixNotifier;
+    }
+
+    void notifier_destroy(Notifier* notifier) {
+        struct UnixNotifier* unixNotifier = notifier->info;
+        if (unixNotifier->writeDescriptor != unixNotifier->readDescriptor) {
+            close(unixNotifier->writeDescriptor);
+        }
+        close(unixNotifier->readDescriptor);
+        free(unixNotifier);
+        notifier->info = NULL;
+    }
+
+    void notifier_signal(Notifier* notifier) {
+        struct UnixNotifier* unixNotifier = notifier->info;
+    #if defined(__linux__)
+        unsigned long long increment = 1;
+        while (write(unixNotifier->writeDescriptor, &increment, sizeof(increment)) == -1) {}
+    #else
+        char byte = 1;
+        while (write(unixNotifier->writeDescriptor, &byte, sizeof(byte)) == -1) {}
+    #endif
+    }
+
+    void notifier_block(Notifier* notifier) {
+        struct UnixNotifier* unixNotifier = notifier->info;
+    #if defined(__linux__)
+        /* Reading an eventfd resets its counter, consuming all pending signals at once */
+        unsigned long long counter;
+        while (read(unixNotifier->readDescriptor, &counter, sizeof(counter)) == -1) {}
+    #else
+        char byte;
+        while (read(unixNotifier->readDescriptor, &byte, sizeof(byte)) == -1) {}
+    #endif
+    }
+
+    int notifier_blockFor(Notifier* notifier, unsigned int milliseconds) {
+        struct UnixNotifier* unixNotifier = notifier->info;
+        struct pollfd descriptor;
+        descriptor.fd = unixNotifier->readDescriptor;
+        descriptor.events = POLLIN;
+        if (poll(&descriptor, 1, (int) milliseconds) <= 0) {
+            return 0;
+        }
+
+        notifier_block(notifier);
+        return 1;
+    }
+
+    int notifier_blockForRoom(Notifier* notifier, const Socket* sockets, unsigned int count, char* ready, int milliseconds) {
+        struct UnixNotifier* unixNotifier = notifier->info;
+        struct pollfd stackDescriptors[NOTIFIER_POLL_STACK_COUNT];
+        struct pollfd* descriptors = count < NOTIFIER_POLL_STACK_COUNT ? stackDescriptors : malloc(sizeof(struct pollfd) * (count + 1));
+        descriptors[0].fd = unixNotifier->readDescriptor;
+        descriptors[0].events = POLLIN;
+        descriptors[0].revents = 0;
+        for (unsigned int i = 0; i < count; i++) {
+            descriptors[i + 1].fd = (int) sockets[i].handle;
+            descriptors[i + 1].events = POLLOUT;
+            descriptors[i + 1].revents = 0;
+        }
+
+        int signaled = 0;
+        if (poll(descriptors, count + 1, milliseconds) > 0) {
+            for (unsigned int i = 0; i < count; i++) {
+                ready[i] = descriptors[i + 1].revents != 0;
+            }
+            if (descriptors[0].revents != 0) {
+                notifier_block(notifier);
+                signaled = 1;
+            }
+        } else {
+            memset(ready, 0, count);
+        }
+
+        if (descriptors != stackDescriptors) {
+            free(descriptors);
+        }
+        return signaled;
+    }
+
+#elif IS_WINDOWS
+
+    #include "synchronization.h"
+
+    void notifier_init(Notifier* notifier) {
+        Event* event = malloc(sizeof(Event));
+        *event = createEvent();
+
+        notifier->waiting = 0;
+        notifier->info = event;
+    }
+
+    void notifier_destroy(Notifier* notifier) {
+        Event* event = notifier->info;
+        destroyEvent(*event);
+        free(event);
+        notifier->info = NULL;
+    }
+
+    void notifier_signal(Notifier* notifier) {
+        signalEvent(*((Event*) notifier->info));
+    }
+
+    void notifier_block(Notifier* notifier) {
+        waitEvent(*((Event*) notifier->info));
+    }
+
+    int notifier_blockFor(Notifier* notifier, unsigned int milliseconds) {
+        return waitEventFor(*((Event*) notifier->info), milliseconds);
+    }
+
+    int notifier_blockForRoom(Notifier* notifier, const Socket* sockets, unsigned int count, char* ready, int milliseconds) {
+        (void) sockets;
+        /* sendAvailable never leaves data unsent, sockets aren't expected : reported as ready, the next send tells */
+        if (count > 0) {
+            memset(ready, 1, count);
+            return 0;
+        }
+        if (milliseconds < 0) {
+            notifier_block(notifier);
+            return 1;
+        }
+        return notifier_blockFor(notifier, (unsigned int) milliseconds);
+    }
+
+#endif
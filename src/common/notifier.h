@@ -0,0 +1,112 @@
+/**
+ * \file notifier.h
+ * \brief Wakes up a consumer thread sleeping until work is available.
+ *
+ * A notifier is meant to be paired with lock-free queues (see spsc-queue.h and mpsc-queue.h) :
+ * producers push to a queue then call notifier_notify, the consumer parks only after
+ * checking again that its queues are empty :
+ *
+ *     notifier_prepareWait(&notifier);
+ *     if (queues are empty) {
+ *         notifier_wait(&notifier);
+ *     } else {
+ *         notifier_cancelWait(&notifier);
+ *     }
+ *
+ * Notifying costs a single atomic load while the consumer is busy, a system call is made only
+ * when the consumer is parked. Consumers can be woken up without any work available, so they
+ * always check their queues again.
+ *
+ * The consumer sleeps on an eventfd on Linux, a pipe on other POSIX systems and an Event on Windows.
+ */
+
+#ifndef C_CHAT_NOTIFIER_H
+#define C_CHAT_NOTIFIER_H
+
+#include "sockets.h"
+
+/**
+ * \class Notifier
+ * \brief A wake-up channel for a single consumer thread
+ */
+typedef struct Notifier {
+    /** Equal to 1 while the consumer is parked or about to park, else 0 */
+    volatile unsigned int waiting;
+    void* info;
+} Notifier;
+
+/**
+ * \brief Initializes a notifier.
+ *
+ * \param notifier The notifier to initialize
+ */
+void notifier_init(Notifier* notifier);
+
+/**
+ * \brief Releases resources of the given notifier.
+ *
+ * The consumer MUST NOT be waiting anymore.
+ *
+ * \param notifier The notifier to destroy
+ */
+void notifier_destroy(Notifier* notifier);
+
+/**
+ * \brief Wakes the consumer up if it's parked. Never blocks.
+ *
+ * MUST be called after publishing the work (pushing to a queue, setting a flag, ...).
+ *
+ * \param notifier The notifier of the consumer
+ */
+void notifier_notify(Notifier* notifier);
+
+/**
+ * \brief Announces the consumer is about to park. Called by the consumer only.
+ *
+ * The consumer MUST check for available work after this call, then either call notifier_wait or
+ * notifier_cancelWait.
+ *
+ * \param notifier The notifier of the consumer
+ */
+void notifier_prepareWait(Notifier* notifier);
+
+/**
+ * \brief Aborts parking after work was found. Called by the consumer only.
+ *
+ * \param notifier The notifier of the consumer
+ */
+void notifier_cancelWait(Notifier* notifier);
+
+/**
+ * \brief Parks the consumer until a producer calls notifier_notify. Called by the consumer only.
+ *
+ * \param notifier The notifier of the consumer
+ */
+void notifier_wait(Notifier* notifier);
+
+/**
+ * \brief Parks the consumer until a producer calls notifier_notify or the delay expires. Called by the consumer only.
+ *
+ * \param notifier The notifier of the consumer
+ * \param milliseconds The maximum time to park
+ * \return 1 if the consumer was notified, 0 if the delay expired
+ */
+int notifier_waitFor(Notifier* notifier, unsigned int milliseconds);
+
+/**
+ * \brief Parks the consumer until a producer calls notifier_notify, one of the given sockets can be sent to or the delay expires.
+ *
+ * Called by the consumer only, instead of notifier_waitFor, when it also waits for slow peers.
+ * A closed connection or an error also counts as room to send : the next send reports it.
+ * Under Windows, sockets are reported as ready at once, as sendAvailable never leaves data unsent there.
+ *
+ * \param notifier The notifier of the consumer
+ * \param sockets The sockets to wait for
+ * \param count The amount of sockets
+ * \param ready An array of count flags, set to 1 for each socket which can be sent to
+ * \param milliseconds The maximum time to park, -1 to wait until notified or a socket is ready
+ * \return 1 if the consumer was notified, else 0
+ */
+int notifier_waitForRoom(Notifier* notifier, const Socket* sockets, unsigned int count, char* ready, int milliseconds);
+
+#endif //C_CHAT_NOTIFIER_H
@@ -0,0 +1,689 @@
+#include "outbound.h"
+#include <stdlib.h>
+#include <string.h>
+#include "atomics.h"
+#include "notifier.h"
+#include "threads.h"
+#include "timers.h"
+
+/**
+ * \brief A queued packet, possibly queued to several outbound paths at once (see outbound_sendToAll)
+ */
+struct OutboundPacket {
+    /** Amount of outbound paths the packet is still queued to */
+    volatile unsigned int references;
+    Packet packet;
+};
+
+/**
+ * \brief A writer thread, shared by the outbound paths which sockets are mapped to it
+ */
+struct OutboundWriter {
+    Thread thread;
+    /** Wakes the writer up when a path is handed over */
+    Notifier notifier;
+    /** Protects the handed over paths and the registered paths */
+    AdaptiveLock lock;
+    /** Paths handed over by producers, linked through nextScheduled */
+    Outbound* scheduledHead;
+    Outbound* scheduledTail;
+    /** Paths mapped to this writer, walked to let idle ones go dormant */
+    Outbound** outbounds;
+    unsigned int count;
+    unsigned int capacity;
+    /** Equal to 1 once the thread is started, else 0. Changed while holding writersLock */
+    unsigned int started;
+};
+
+static struct OutboundWriter writers[OUTBOUND_WRITERS];
+/** Serializes starting writers */
+static AdaptiveLock writersLock = ADAPTIVE_LOCK_INITIALIZER;
+
+/**
+ * \brief Releases a reference to the given packet, freeing it once no outbound path references it.
+ */
+void outbound_releasePacket(struct OutboundPacket* queued) {
+    if (atomics_fetchAdd(&queued->references, (unsigned int) -1) == 1) {
+        free(queued);
+    }
+}
+
+/**
+ * \def OUTBOUND_ACTIVE
+ * \brief State of a path which queues are allocated
+ */
+#define OUTBOUND_ACTIVE 0
+
+/**
+ * \def OUTBOUND_HIBERNATING
+ * \brief State of a path which writer checks whether it can go dormant
+ */
+#define OUTBOUND_HIBERNATING 1
+
+/**
+ * \def OUTBOUND_DORMANT
+ * \brief State of a path without queues
+ */
+#define OUTBOUND_DORMANT 2
+
+/**
+ * \def OUTBOUND_FLUSH_IDLE
+ * \brief Nothing is left to send, the path isn't handed over to the writer anymore
+ */
+#define OUTBOUND_FLUSH_IDLE 0
+
+/**
+ * \def OUTBOUND_FLUSH_MORE
+ * \brief Data was sent, more may be waiting
+ */
+#define OUTBOUND_FLUSH_MORE 1
+
+/**
+ * \def OUTBOUND_FLUSH_BLOCKED
+ * \brief The peer doesn't accept more data for now
+ */
+#define OUTBOUND_FLUSH_BLOCKED 2
+
+/**
+ * \def OUTBOUND_FLUSH_DROPPED
+ * \brief The path failed or is closing, the writer is done with it
+ */
+#define OUTBOUND_FLUSH_DROPPED 3
+
+THREAD_ENTRY_POINT outbound_writer(void* data);
+
+/**
+ * \brief Allocates the queues and the event bulk producers wait on. MUST be called while holding wakeLock.
+ */
+void outbound_start(Outbound* outbound) {
+    outbound->queues[OUTBOUND_PRIORITY_CONTROL] = mpsc_create(OUTBOUND_CONTROL_QUEUE_CAPACITY);
+    outbound->queues[OUTBOUND_PRIORITY_BULK] = mpsc_create(OUTBOUND_BULK_QUEUE_CAPACITY);
+    outbound->controlStreak = 0;
+    outbound->bulkDequeued = createEvent();
+    outbound->lastActivity = timers_now();
+    atomics_store(&outbound->state, OUTBOUND_ACTIVE);
+}
+
+/**
+ * \brief Maps the given path to its writer, starting the writer if it isn't running yet.
+ */
+void outbound_register(Outbound* outbound) {
+    /* Windows handles are multiples of 4, they're mixed before picking a writer */
+    unsigned int key = (unsigned int) outbound->socket.handle * 2654435761u;
+    struct OutboundWriter* writer = &writers[(key >> 16) % OUTBOUND_WRITERS];
+    outbound->writer = writer;
+
+    adaptiveLock_acquire(&writersLock);
+    if (!writer->started) {
+        notifier_init(&writer->notifier);
+        adaptiveLock_init(&writer->lock);
+        writer->scheduledHead = NULL;
+        writer->scheduledTail = NULL;
+        writer->outbounds = NULL;
+        writer->count = 0;
+        writer->capacity = 0;
+        writer->thread = createThread(outbound_writer, writer);
+        writer->started = 1;
+    }
+    adaptiveLock_release(&writersLock);
+
+    adaptiveLock_acquire(&writer->lock);
+    if (writer->count == writer->capacity) {
+        writer->capacity = writer->capacity == 0 ? 16 : writer->capacity * 2;
+        writer->outbounds = realloc(writer->outbounds, sizeof(Outbound*) * writer->capacity);
+    }
+    writer->outbounds[writer->count++] = outbound;
+    adaptiveLock_release(&writer->lock);
+}
+
+/**
+ * \brief Removes the given path from the paths of its writer.
+ */
+void outbound_unregister(Outbound* outbound) {
+    struct OutboundWriter* writer = outbound->writer;
+    adaptiveLock_acquire(&writer->lock);
+    for (unsigned int i = 0; i < writer->count; i++) {
+        if (writer->outbounds[i] == outbound) {
+            writer->outbounds[i] = writer->outbounds[--writer->count];
+            break;
+        }
+    }
+    adaptiveLock_release(&writer->lock);
+}
+
+/**
+ * \brief Hands the given path over to its writer, unless it's already handed over.
+ *
+ * MUST be called after pushing packets : either the writer sees them, or this call sees the writer let go of the path.
+ */
+void outbound_schedule(Outbound* outbound) {
+    /* Orders pushing packets before reading the flag */
+    atomics_fence();
+    if (atomics_load(&outbound->scheduled) || atomics_exchange(&outbound->scheduled, 1)) {
+        return;
+    }
+
+    struct OutboundWriter* writer = outbound->writer;
+    adaptiveLock_acquire(&writer->lock);
+    outbound->nextScheduled = NULL;
+    if (writer->scheduledTail != NULL) {
+        writer->scheduledTail->nextScheduled = outbound;
+    } else {
+        writer->scheduledHead = outbound;
+    }
+    writer->scheduledTail = outbound;
+    adaptiveLock_release(&writer->lock);
+
+    notifier_notify(&writer->notifier);
+}
+
+void outbound_init(Outbound* outbound, Socket socket) {
+    outbound->socket = socket;
+    outbound->failed = 0;
+    outbound->closing = 0;
+    outbound->scheduled = 0;
+    outbound->nextScheduled = NULL;
+    outbound->pending = NULL;
+    outbound->abandoned = 0;
+    outbound->bulkWaiters = 0;
+    outbound->users = 0;
+    adaptiveLock_init(&outbound->wakeLock);
+
+    adaptiveLock_acquire(&outbound->wakeLock);
+    outbound_start(outbound);
+    adaptiveLock_release(&outbound->wakeLock);
+
+    outbound_register(outbound);
+}
+
+void outbound_destroy(Outbound* outbound) {
+    outbound->released = createEvent();
+
+    adaptiveLock_acquire(&outbound->wakeLock);
+    atomics_store(&outbound->closing, 1);
+    short dormant = atomics_load(&outbound->state) == OUTBOUND_DORMANT;
+    short abandoned = outbound->abandoned;
+    adaptiveLock_release(&outbound->wakeLock);
+
+    if (!dormant && !abandoned) {
+        /* The writer sends what's left, then lets go of the path */
+        signalEvent(outbound->bulkDequeued);
+        outbound_schedule(outbound);
+        waitEvent(outbound->released);
+    }
+    outbound_unregister(outbound);
+
+    if (!dormant) {
+        for (int i = 0; i < 2; i++) {
+            struct OutboundPacket* queued;
+            while ((queued = mpsc_pop(outbound->queues[i])) != NULL) {
+                outbound_releasePacket(queued);
+            }
+            mpsc_destroy(outbound->queues[i]);
+        }
+        destroyEvent(outbound->bulkDequeued);
+    }
+    destroyEvent(outbound->released);
+}
+
+/**
+ * \brief Releases the queues of the given path if it's idle for long enough. Called by the writer only.
+ *
+ * \param now The current time, as returned by timers_now
+ */
+void outbound_hibernate(Outbound* outbound, unsigned long long now) {
+    adaptiveLock_acquire(&outbound->wakeLock);
+    if (atomics_load(&outbound->state) != OUTBOUND_ACTIVE
+        || now - outbound->lastActivity < OUTBOUND_HIBERNATION_DELAY_MILLIS) {
+        adaptiveLock_release(&outbound->wakeLock);
+        return;
+    }
+
+    atomics_store(&outbound->state, OUTBOUND_HIBERNATING);
+    /* Producers announce themselves before reading the state : either they see it, or it sees them */
+    atomics_fence();
+    if (atomics_load(&outbound->users) != 0 || atomics_load(&outbound->closing) || atomics_load(&outbound->scheduled)
+        || !mpsc_isEmpty(outbound->queues[OUTBOUND_PRIORITY_CONTROL])
+        || !mpsc_isEmpty(outbound->queues[OUTBOUND_PRIORITY_BULK])) {
+        atomics_store(&outbound->state, OUTBOUND_ACTIVE);
+        adaptiveLock_release(&outbound->wakeLock);
+        return;
+    }
+
+    mpsc_destroy(outbound->queues[OUTBOUND_PRIORITY_CONTROL]);
+    mpsc_destroy(outbound->queues[OUTBOUND_PRIORITY_BULK]);
+    /* No bulk producer is waiting, as producers are done */
+    destroyEvent(outbound->bulkDequeued);
+    atomics_store(&outbound->state, OUTBOUND_DORMANT);
+    adaptiveLock_release(&outbound->wakeLock);
+}
+
+/**
+ * \brief Lets idle paths of the given writer go dormant. Called by the writer only.
+ *
+ * Paths handed over to the writer are busy, they're left alone.
+ *
+ * \param now The current time, as returned by timers_now
+ */
+void outbound_sweep(struct OutboundWriter* writer, unsigned long long now) {
+    adaptiveLock_acquire(&writer->lock);
+    for (unsigned int i = 0; i < writer->count; i++) {
+        Outbound* outbound = writer->outbounds[i];
+        if (!atomics_load(&outbound->scheduled) && atomics_load(&outbound->state) == OUTBOUND_ACTIVE) {
+            outbound_hibernate(outbound, now);
+        }
+    }
+    adaptiveLock_release(&writer->lock);
+}
+
+/**
+ * \brief Announces a producer is about to use the queues, allocating them again if the path is dormant.
+ *
+ * \return 1 if the queues can be used until outbound_leave is called, 0 if the path failed or is closing
+ */
+int outbound_enter(Outbound* outbound) {
+    while (1) {
+        atomics_fetchAdd(&outbound->users, 1);
+        if (atomics_load(&outbound->state) == OUTBOUND_ACTIVE) {
+            return 1;
+        }
+        atomics_fetchAdd(&outbound->users, (unsigned int) -1);
+
+        /* The path is going dormant or is dormant, waiting for the writer to decide then waking it up */
+        adaptiveLock_acquire(&outbound->wakeLock);
+        short stopped = atomics_load(&outbound->failed) || atomics_load(&outbound->closing);
+        if (!stopped && atomics_load(&outbound->state) == OUTBOUND_DORMANT) {
+            outbound_start(outbound);
+        }
+        adaptiveLock_release(&outbound->wakeLock);
+
+        if (stopped) {
+            return 0;
+        }
+    }
+}
+
+/**
+ * \brief Announces a producer is done with the queues.
+ */
+void outbound_leave(Outbound* outbound) {
+    atomics_fetchAdd(&outbound->users, (unsigned int) -1);
+}
+
+/**
+ * \brief Refuses packets from now on and wakes up bulk producers so they give up.
+ */
+void outbound_fail(Outbound* outbound) {
+    atomics_store(&outbound->failed, 1);
+    signalEvent(outbound->bulkDequeued);
+}
+
+/**
+ * \brief Lets the writer forget the given path, which failed or is closing. Called by the writer only.
+ *
+ * A closing path is released to outbound_destroy. A failed path stays handed over, so producers
+ * don't hand it over again : its queues are released by outbound_destroy.
+ *
+ * \return OUTBOUND_FLUSH_DROPPED
+ */
+int outbound_drop(Outbound* outbound) {
+    free(outbound->pending);
+    outbound->pending = NULL;
+
+    adaptiveLock_acquire(&outbound->wakeLock);
+    if (atomics_load(&outbound->closing)) {
+        adaptiveLock_release(&outbound->wakeLock);
+        signalEvent(outbound->released);
+    } else {
+        outbound->abandoned = 1;
+        adaptiveLock_release(&outbound->wakeLock);
+    }
+
+    return OUTBOUND_FLUSH_DROPPED;
+}
+
+/**
+ * \brief Picks the next packet to send. Called by the writer only.
+ *
+ * \return the packet to send (to be freed by the caller) or NULL if there is nothing to send
+ */
+struct OutboundPacket* outbound_pick(Outbound* outbound) {
+    MpscQueue* control = outbound->queues[OUTBOUND_PRIORITY_CONTROL];
+    MpscQueue* bulk = outbound->queues[OUTBOUND_PRIORITY_BULK];
+
+    struct OutboundPacket* picked = NULL;
+    if (outbound->controlStreak < OUTBOUND_CONTROL_WEIGHT) {
+        picked = mpsc_pop(control);
+    }
+    if (picked == NULL) {
+        picked = mpsc_pop(bulk);
+        if (picked != NULL) {
+            outbound->controlStreak = 0;
+            return picked;
+        }
+        picked = mpsc_pop(control);
+    }
+    if (picked != NULL) {
+        outbound->controlStreak++;
+    }
+
+    return picked;
+}
+
+/**
+ * \brief Sends the bytes the peer didn't accept yet, then a batch of waiting packets. Called by the writer only.
+ *
+ * \param batch A buffer of OUTBOUND_BATCH_SIZE bytes to pack packets in
+ * \return OUTBOUND_FLUSH_IDLE, OUTBOUND_FLUSH_MORE, OUTBOUND_FLUSH_BLOCKED or OUTBOUND_FLUSH_DROPPED
+ */
+int outbound_flush(Outbound* outbound, char* batch) {
+    if (atomics_load(&outbound->failed)) {
+        return outbound_drop(outbound);
+    }
+
+    if (outbound->pending != NULL) {
+        int sent = sendAvailable(outbound->socket, outbound->pending + outbound->pendingSent,
+                                 outbound->pendingSize - outbound->pendingSent);
+        if (sent == SOCKET_WOULD_BLOCK) {
+            return OUTBOUND_FLUSH_BLOCKED;
+        } else if (sent <= 0) {
+            outbound_fail(outbound);
+            return outbound_drop(outbound);
+        }
+
+        outbound->lastActivity = timers_now();
+        outbound->pendingSent += sent;
+        if (outbound->pendingSent < outbound->pendingSize) {
+            return OUTBOUND_FLUSH_BLOCKED;
+        }
+        free(outbound->pending);
+        outbound->pending = NULL;
+        return OUTBOUND_FLUSH_MORE;
+    }
+
+    unsigned int batchSize = 0;
+    short bulkPicked = 0;
+    struct OutboundPacket* picked;
+    while (batchSize + sizeof(Packet) <= OUTBOUND_BATCH_SIZE && (picked = outbound_pick(outbound)) != NULL) {
+        unsigned int size = packets_sizeOf(&picked->packet);
+        memcpy(batch + batchSize, &picked->packet, size);
+        batchSize += size;
+        /* Picking a bulk packet resets the control streak */
+        bulkPicked |= outbound->controlStreak == 0;
+        outbound_releasePacket(picked);
+    }
+
+    if (bulkPicked) {
+        /* Orders freeing bulk cells before reading the amount of waiting producers */
+        atomics_fence();
+        if (atomics_load(&outbound->bulkWaiters)) {
+            signalEvent(outbound->bulkDequeued);
+        }
+    }
+
+    if (batchSize > 0) {
+        int sent = sendAvailable(outbound->socket, batch, batchSize);
+        if (sent == SOCKET_WOULD_BLOCK) {
+            sent = 0;
+        } else if (sent <= 0) {
+            outbound_fail(outbound);
+            return outbound_drop(outbound);
+        } else {
+            outbound->lastActivity = timers_now();
+        }
+
+        if ((unsigned int) sent < batchSize) {
+            /* Kept aside until the peer reads, the batch buffer is shared by the paths of the writer */
+            outbound->pendingSize = batchSize - sent;
+            outbound->pendingSent = 0;
+            outbound->pending = malloc(outbound->pendingSize);
+            memcpy(outbound->pending, batch + sent, outbound->pendingSize);
+            return OUTBOUND_FLUSH_BLOCKED;
+        }
+        return OUTBOUND_FLUSH_MORE;
+    }
+
+    if (atomics_load(&outbound->closing)) {
+        return outbound_drop(outbound);
+    }
+
+    /* Producers push before handing the path over : either they see it's let go, or it sees their packets */
+    atomics_store(&outbound->scheduled, 0);
+    atomics_fence();
+    if ((atomics_load(&outbound->closing) || !mpsc_isEmpty(outbound->queues[OUTBOUND_PRIORITY_CONTROL])
+         || !mpsc_isEmpty(outbound->queues[OUTBOUND_PRIORITY_BULK]))
+        && !atomics_exchange(&outbound->scheduled, 1)) {
+        return OUTBOUND_FLUSH_MORE;
+    }
+    return OUTBOUND_FLUSH_IDLE;
+}
+
+/**
+ * \brief Checks whether paths were handed over to the given writer since it last took them.
+ */
+int outbound_hasScheduled(struct OutboundWriter* writer) {
+    adaptiveLock_acquire(&writer->lock);
+    int scheduled = writer->scheduledHead != NULL;
+    adaptiveLock_release(&writer->lock);
+    return scheduled;
+}
+
+/**
+ * \brief Entry point of a writer thread.
+ *
+ * Paths are served in rounds, a batch each. Paths which peer doesn't accept more data are set
+ * aside until their socket can be sent to again.
+ *
+ * \param data The writer
+ */
+THREAD_ENTRY_POINT outbound_writer(void* data) {
+    struct OutboundWriter* writer = data;
+    char* batch = malloc(OUTBOUND_BATCH_SIZE);
+    /* Paths to serve on the next round, linked through nextScheduled */
+    Outbound* nextHead = NULL;
+    Outbound* nextTail = NULL;
+    /* Paths waiting for their peer, with their sockets */
+    Outbound** blocked = NULL;
+    Socket* blockedSockets = NULL;
+    char* writable = NULL;
+    unsigned int blockedCount = 0;
+    unsigned int blockedCapacity = 0;
+    unsigned long long nextSweep = timers_now() + OUTBOUND_HIBERNATION_DELAY_MILLIS;
+
+    while (1) {
+        /* Paths handed over meanwhile are served after the ones already waiting */
+        adaptiveLock_acquire(&writer->lock);
+        if (writer->scheduledHead != NULL) {
+            if (nextTail != NULL) {
+                nextTail->nextScheduled = writer->scheduledHead;
+            } else {
+                nextHead = writer->scheduledHead;
+            }
+            nextTail = writer->scheduledTail;
+            writer->scheduledHead = NULL;
+            writer->scheduledTail = NULL;
+        }
+        adaptiveLock_release(&writer->lock);
+
+        Outbound* round = nextHead;
+        nextHead = NULL;
+        nextTail = NULL;
+        while (round != NULL) {
+            Outbound* outbound = round;
+            round = outbound->nextScheduled;
+
+            int result = outbound_flush(outbound, batch);
+            if (result == OUTBOUND_FLUSH_MORE) {
+                outbound->nextScheduled = NULL;
+                if (nextTail != NULL) {
+                    nextTail->nextScheduled = outbound;
+                } else {
+                    nextHead = outbound;
+                }
+                nextTail = outbound;
+            } else if (result == OUTBOUND_FLUSH_BLOCKED) {
+                if (blockedCount == blockedCapacity) {
+                    blockedCapacity = blockedCapacity == 0 ? 16 : blockedCapacity * 2;
+                    blocked = realloc(blocked, sizeof(Outbound*) * blockedCapacity);
+                    blockedSockets = realloc(blockedSockets, sizeof(Socket) * blockedCapacity);
+                    writable = realloc(writable, blockedCapacity);
+                }
+                blocked[blockedCount] = outbound;
+                blockedSockets[blockedCount] = outbound->socket;
+                blockedCount++;
+            }
+        }
+
+        int timeout = -1;
+        if (OUTBOUND_HIBERNATION_DELAY_MILLIS != 0) {
+            unsigned long long now = timers_now();
+            if (now >= nextSweep) {
+                outbound_sweep(writer, now);
+                nextSweep = now + OUTBOUND_HIBERNATION_DELAY_MILLIS;
+            }
+            timeout = (int) (nextSweep - now);
+        }
+        if (nextHead != NULL) {
+            timeout = 0;
+        }
+
+        notifier_prepareWait(&writer->notifier);
+        if (timeout != 0 && outbound_hasScheduled(writer)) {
+            timeout = 0;
+        }
+
+        if (blockedCount > 0) {
+            notifier_waitForRoom(&writer->notifier, blockedSockets, blockedCount, writable, timeout);
+
+            /* Paths which peer reads again join the next round */
+            unsigned int stillBlocked = 0;
+            for (unsigned int i = 0; i < blockedCount; i++) {
+                if (writable[i]) {
+                    blocked[i]->nextScheduled = NULL;
+                    if (nextTail != NULL) {
+                        nextTail->nextScheduled = blocked[i];
+                    } else {
+                        nextHead = blocked[i];
+                    }
+                    nextTail = blocked[i];
+                } else {
+                    blocked[stillBlocked] = blocked[i];
+                    blockedSockets[stillBlocked] = blockedSockets[i];
+                    stillBlocked++;
+                }
+            }
+            blockedCount = stillBlocked;
+        } else if (timeout == 0) {
+            notifier_cancelWait(&writer->notifier);
+        } else if (timeout < 0) {
+            notifier_wait(&writer->notifier);
+        } else {
+            notifier_waitFor(&writer->notifier, (unsigned int) timeout);
+        }
+    }
+}
+
+/**
+ * \brief Pushes a packet to the bulk queue, waiting for room if it's full.
+ *
+ * \return 1 if the packet was pushed, 0 if the outbound path failed or is closing
+ */
+int outbound_pushBulk(Outbound* outbound, struct OutboundPacket* queued) {
+    MpscQueue* bulk = outbound->queues[OUTBOUND_PRIORITY_BULK];
+    if (mpsc_push(bulk, queued)) {
+        return 1;
+    }
+
+    atomics_fetchAdd(&outbound->bulkWaiters, 1);
+    atomics_fence();
+    int pushed = 0;
+    while (!atomics_load(&outbound->failed) && !atomics_load(&outbound->closing)) {
+        /* Announced as waiting before trying again, so the writer can't miss us */
+        if (mpsc_push(bulk, queued)) {
+            pushed = 1;
+            break;
+        }
+        waitEvent(outbound->bulkDequeued);
+    }
+    atomics_fetchAdd(&outbound->bulkWaiters, (unsigned int) -1);
+
+    /* Several dequeues can be merged into a single signal, passing it on to another producer */
+    if (atomics_load(&outbound->bulkWaiters)) {
+        signalEvent(outbound->bulkDequeued);
+    }
+
+    return pushed;
+}
+
+int outbound_send(Outbound* outbound, Packet* packet, int priority) {
+    if (atomics_load(&outbound->failed) || atomics_load(&outbound->closing) || !outbound_enter(outbound)) {
+        return -1;
+    }
+
+    struct OutboundPacket* queued = malloc(sizeof(struct OutboundPacket));
+    queued->references = 1;
+    memcpy(&queued->packet, packet, sizeof(Packet));
+
+    if (priority == OUTBOUND_PRIORITY_BULK) {
+        if (!outbound_pushBulk(outbound, queued)) {
+            free(queued);
+            outbound_leave(outbound);
+            return -1;
+        }
+    } else if (!mpsc_push(outbound->queues[OUTBOUND_PRIORITY_CONTROL], queued)) {
+        /* The peer doesn't read fast enough, giving up on it rather than blocking the producer */
+        free(queued);
+        outbound_fail(outbound);
+        shutdownSocket(outbound->socket);
+        outbound_schedule(outbound);
+        outbound_leave(outbound);
+        return -1;
+    }
+
+    outbound_schedule(outbound);
+    outbound_leave(outbound);
+    return 1;
+}
+
+/**
+ * \brief Queues a packet shared by other outbound paths with control priority.
+ *
+ * \return 1 if the packet was queued, 0 if the outbound path failed or is closing
+ */
+int outbound_pushShared(Outbound* outbound, struct OutboundPacket* queued) {
+    if (atomics_load(&outbound->failed) || atomics_load(&outbound->closing) || !outbound_enter(outbound)) {
+        return 0;
+    }
+
+    int pushed = mpsc_push(outbound->queues[OUTBOUND_PRIORITY_CONTROL], queued);
+    if (!pushed) {
+        outbound_fail(outbound);
+        shutdownSocket(outbound->socket);
+    }
+
+    outbound_schedule(outbound);
+    outbound_leave(outbound);
+    return pushed;
+}
+
+unsigned int outbound_sendToAll(Outbound* const* outbounds, unsigned int count, Packet* packet) {
+    if (count == 0) {
+        return 0;
+    }
+
+    /* A single copy referenced by all queues, released by the last writer sending it */
+    struct OutboundPacket* queued = malloc(sizeof(struct OutboundPacket));
+    queued->references = count;
+    memcpy(&queued->packet, packet, packets_sizeOf(packet));
+
+    unsigned int sent = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        if (outbound_pushShared(outbounds[i], queued)) {
+            sent++;
+        } else {
+            outbound_releasePacket(queued);
+        }
+    }
+
+    return sent;
+}
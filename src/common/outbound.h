@@ -0,0 +1,183 @@
+/**
+ * \file outbound.h
+ * \brief Serializes and schedules packets sent through a socket shared by several threads.
+ *
+ * Sockets share a pool of OUTBOUND_WRITERS writer threads. A socket is always written by the same
+ * writer, picked from its handle, so packets are never interleaved. Other threads just push packets
+ * to lock-free queues (see mpsc-queue.h), then hand the outbound path over to its writer if it
+ * isn't already waiting for it.
+ *
+ * Packets are queued by priority : control packets (chat messages, notifications, requests, ...)
+ * and bulk packets (file data). When both kinds are waiting, OUTBOUND_CONTROL_WEIGHT control
+ * packets are sent for each bulk packet, so chat stays responsive during transfers while transfers
+ * still make progress.
+ *
+ * The writer packs as many waiting packets as possible into a buffer of OUTBOUND_BATCH_SIZE
+ * bytes and sends it at once, instead of issuing a system call for each packet. Paths take turns,
+ * a batch each. Sending never waits : the bytes a slow peer doesn't accept are kept aside and the
+ * writer watches its socket until it accepts data again, serving the other paths meanwhile.
+ *
+ * Once nothing was sent for OUTBOUND_HIBERNATION_DELAY_MILLIS, the path goes dormant : its queues
+ * and bulk producers event are released. The next packet queued allocates them again.
+ */
+
+#ifndef C_CHAT_OUTBOUND_H
+#define C_CHAT_OUTBOUND_H
+
+#include "packets.h"
+#include "sockets.h"
+#include "synchronization.h"
+#include "mpsc-queue.h"
+#include "adaptive-lock.h"
+
+/**
+ * \def OUTBOUND_PRIORITY_CONTROL
+ * \brief Priority of latency-sensitive packets
+ */
+#define OUTBOUND_PRIORITY_CONTROL 0
+
+/**
+ * \def OUTBOUND_PRIORITY_BULK
+ * \brief Priority of throughput-oriented packets (file data)
+ */
+#define OUTBOUND_PRIORITY_BULK 1
+
+/**
+ * \def OUTBOUND_CONTROL_WEIGHT
+ * \brief Amount of control packets sent for each bulk packet when both are waiting
+ */
+#define OUTBOUND_CONTROL_WEIGHT 8
+
+/**
+ * \def OUTBOUND_BATCH_SIZE
+ * \brief Maximum amount of bytes sent by the writer in a single call
+ */
+#define OUTBOUND_BATCH_SIZE 16384
+
+/**
+ * \def OUTBOUND_CONTROL_QUEUE_CAPACITY
+ * \brief Maximum amount of control packets waiting in the queue. The peer is considered too slow beyond this limit
+ */
+#define OUTBOUND_CONTROL_QUEUE_CAPACITY 1024
+
+/**
+ * \def OUTBOUND_BULK_QUEUE_CAPACITY
+ * \brief Maximum amount of bulk packets waiting in the queue. Bulk producers wait beyond this limit
+ */
+#define OUTBOUND_BULK_QUEUE_CAPACITY 64
+
+#ifndef OUTBOUND_WRITERS
+/**
+ * \def OUTBOUND_WRITERS
+ * \brief Amount of writer threads shared by all sockets. Writers are started once a socket needs them
+ */
+#define OUTBOUND_WRITERS 4
+#endif
+
+#ifndef OUTBOUND_HIBERNATION_DELAY_MILLIS
+/**
+ * \def OUTBOUND_HIBERNATION_DELAY_MILLIS
+ * \brief Delay without any packet to send after which the path goes dormant (milliseconds), 0 to never
+ */
+#define OUTBOUND_HIBERNATION_DELAY_MILLIS 10000
+#endif
+
+struct OutboundWriter;
+
+/**
+ * \class Outbound
+ * \brief The outbound path of a socket
+ */
+typedef struct Outbound {
+    Socket socket;
+    /** The writer thread sending the packets of this path */
+    struct OutboundWriter* writer;
+    /** Queues indexed by priority */
+    MpscQueue* queues[2];
+    /** Control packets sent since the last bulk packet, used by the writer only */
+    unsigned int controlStreak;
+    /** Equal to 1 once sending failed, else 0. Packets are refused from then on */
+    volatile unsigned int failed;
+    /** Equal to 1 once the outbound path is being destroyed, else 0 */
+    volatile unsigned int closing;
+    /** Equal to 1 while the path is handed over to its writer, else 0 */
+    volatile unsigned int scheduled;
+    /** Next path handed over to the writer, protected by the lock of the writer */
+    struct Outbound* nextScheduled;
+    /** Bytes of a batch the peer didn't accept yet, NULL if none. Used by the writer only */
+    char* pending;
+    unsigned int pendingSize;
+    unsigned int pendingSent;
+    /** When the writer last sent through the socket (milliseconds, see timers_now). Used by the writer only */
+    unsigned long long lastActivity;
+    /** Equal to 1 once the writer gave up on the failed path, else 0. Changed while holding wakeLock */
+    unsigned int abandoned;
+    /** Signaled by the writer once it's done with a closing path */
+    Event released;
+    /** Amount of bulk producers waiting for room in the bulk queue */
+    volatile unsigned int bulkWaiters;
+    /** Signaled when room is made in the bulk queue, wakes a bulk producer up */
+    Event bulkDequeued;
+    /** Whether the path is active, going dormant or dormant. Changed while holding wakeLock */
+    volatile unsigned int state;
+    /** Amount of producers using the queues, the path can't go dormant meanwhile */
+    volatile unsigned int users;
+    /** Serializes the path going dormant, producers waking it up and the path destruction */
+    AdaptiveLock wakeLock;
+} Outbound;
+
+/**
+ * \brief Initializes the outbound path of the given socket, starting its writer thread if it isn't running yet
+ *
+ * The outbound path MUST NOT be moved in memory until it's destroyed.
+ *
+ * \param outbound The outbound path to initialize
+ * \param socket The socket to send packets through
+ */
+void outbound_init(Outbound* outbound, Socket socket);
+
+/**
+ * \brief Releases resources of the given outbound path once its writer is done with it.
+ *
+ * The writer sends packets still queued first, unless sending fails. The socket
+ * should be shut down first if these packets don't matter, so this call doesn't wait for a
+ * slow peer.
+ * No other thread must be using the outbound path anymore.
+ *
+ * \param outbound The outbound path to destroy
+ */
+void outbound_destroy(Outbound* outbound);
+
+/**
+ * \brief Queues the given packet to be sent by the writer thread.
+ *
+ * Queuing a control packet never waits. If OUTBOUND_CONTROL_QUEUE_CAPACITY control packets are
+ * already queued, the peer doesn't keep up : the socket is shut down rather than blocking the
+ * producer.
+ * Queuing a bulk packet waits while OUTBOUND_BULK_QUEUE_CAPACITY bulk packets are queued, which
+ * throttles bulk producers to the socket speed.
+ *
+ * \param outbound The outbound path to send the packet through
+ * \param packet The packet to send (copied)
+ * \param priority OUTBOUND_PRIORITY_CONTROL or OUTBOUND_PRIORITY_BULK
+ * If the path is dormant, its queues are allocated again first.
+ *
+ * \return 1 if the packet was queued, -1 if the socket failed or is closing
+ */
+int outbound_send(Outbound* outbound, Packet* packet, int priority);
+
+/**
+ * \brief Queues the given packet to several outbound paths with control priority.
+ *
+ * The packet is copied once and the copy is shared by all queues, so the cost of a broadcast
+ * doesn't grow with the packet size. Outbound paths which don't keep up are shut down as
+ * outbound_send does.
+ *
+ * \param outbounds The outbound paths to send the packet through, contiguous so they're walked quickly
+ * \param count The amount of outbound paths
+ * \param packet The packet to send (copied)
+ * \return the amount of outbound paths the packet was queued to
+ */
+unsigned int outbound_sendToAll(Outbound* const* outbounds, unsigned int count, Packet* packet);
+
+#endif //C_CHAT_OUTBOUND_H
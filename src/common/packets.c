@@ -18,13 +18,13 @@ const union Packet NewPacketCreateRoom = { CREATE_ROOM_MESSAGE_TYPE };
 const union Packet NewPacketJoinRoom = { JOIN_ROOM_MESSAGE_TYPE };
 const union Packet NewPacketLeaveRoom = { LEAVE_ROOM_MESSAGE_TYPE };
 const union Packet NewPacketListRooms = { LIST_ROOMS_MESSAGE_TYPE };
+const union Packet NewPacketPing = { PING_MESSAGE_TYPE };
+const union Packet NewPacketPong = { PONG_MESSAGE_TYPE };
+const union Packet NewPacketStatsRequest = { STATS_REQUEST_MESSAGE_TYPE };
+const union Packet NewPacketFileDataAck = { FILE_DATA_ACK_MESSAGE_TYPE };
+const union Packet NewPacketFileBlockProof = { FILE_BLOCK_PROOF_MESSAGE_TYPE };
+const union Packet NewPacketFileUploadDigest = { FILE_UPLOAD_DIGEST_MESSAGE_TYPE };
 
-/**
- * \brief Retrieves the real size of the underlying type
- *
- * \param packet The packet to get real size of
- * \return the real size of the underlying type or 0 if the type isn't known
- */
 unsigned int packets_sizeOf(Packet* packet) {
     switch (packet->type) {
         case JOIN_MESSAGE_TYPE:
@@ -63,18 +63,30 @@ unsigned int packets_sizeOf(Packet* packet) {
             return sizeof(struct PacketLeaveRoom);
         case LIST_ROOMS_MESSAGE_TYPE:
             return sizeof(struct PacketListRooms);
+        case PING_MESSAGE_TYPE:
+            return sizeof(struct PacketPing);
+        case PONG_MESSAGE_TYPE:
+            return sizeof(struct PacketPong);
+        case STATS_REQUEST_MESSAGE_TYPE:
+            return sizeof(struct PacketStatsRequest);
+        case FILE_DATA_ACK_MESSAGE_TYPE:
+            return sizeof(struct PacketFileDataAck);
+        case FILE_BLOCK_PROOF_MESSAGE_TYPE:
+            return sizeof(struct PacketFileBlockProof);
+        case FILE_UPLOAD_DIGEST_MESSAGE_TYPE:
+            return sizeof(struct PacketFileUploadDigest);
         default:
             return 0;
     }
 }
 
-int receiveNextPacket(Socket socket, Packet* packet) {
-    int bytesReceived;
-    bytesReceived = receiveFrom(socket, &(packet->type), sizeof(char));
-    if (bytesReceived <= 0) {
-        return bytesReceived;
-    }
-
+/**
+ * \brief Receives the content of a packet whose type was just received, waiting for all of it.
+ *
+ * \param bytesReceived The amount of bytes received for the type
+ * \return the number of bytes received (can be lower than or equal to 0)
+ */
+int receivePacketContent(Socket socket, Packet* packet, int bytesReceived) {
     unsigned packetSize = packets_sizeOf(packet) - sizeof(char);
     if (packetSize < 0) { // Unknown packet type
         return bytesReceived;
@@ -84,12 +96,37 @@ int receiveNextPacket(Socket socket, Packet* packet) {
         return bytesReceived;
     }
 
-    bytesReceived = receiveFrom(socket, &(packet->type) + 1, packetSize);
+    /* The content can be split over several segments, especially when packets are sent in batches */
+    unsigned int received = 0;
+    while (received < packetSize) {
+        bytesReceived = receiveFrom(socket, &(packet->type) + 1 + received, packetSize - received);
+        if (bytesReceived <= 0) {
+            return bytesReceived;
+        }
+        received += bytesReceived;
+    }
+
+    return received;
+}
+
+int receiveNextPacket(Socket socket, Packet* packet) {
+    int bytesReceived;
+    bytesReceived = receiveFrom(socket, &(packet->type), sizeof(char));
+    if (bytesReceived <= 0) {
+        return bytesReceived;
+    }
+
+    return receivePacketContent(socket, packet, bytesReceived);
+}
+
+int receiveAvailablePacket(Socket socket, Packet* packet) {
+    int bytesReceived = receiveAvailable(socket, &(packet->type), sizeof(char));
     if (bytesReceived <= 0) {
         return bytesReceived;
     }
 
-    return bytesReceived;
+    /* Packets are sent at once : the rest of a started packet is about to arrive */
+    return receivePacketContent(socket, packet, bytesReceived);
 }
 
 int sendPacket(Socket socket, Packet* packet) {
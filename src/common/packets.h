@@ -8,6 +8,7 @@
 
 #include "constants.h"
 #include "sockets.h"
+#include "hash-tree.h"
 
 /**
  * \class PacketJoin
@@ -97,6 +98,8 @@ extern const union Packet NewPacketQuit;
 struct PacketFileUploadRequest {
     char type;
     long long fileSize;
+    /** Token of an interrupted upload of the same file to resume, 0 to start a new upload */
+    unsigned long long resumeToken;
 };
 /** This instance is used to create a new PacketFileUploadRequest */
 extern const union Packet NewPacketFileUploadRequest;
@@ -108,6 +111,10 @@ extern const union Packet NewPacketFileUploadRequest;
 struct PacketFileDownloadRequest {
     char type;
     unsigned int fileId;
+    /** Offset of the requested range of the file, sent data starts there */
+    long long offset;
+    /** Length of the requested range, 0 for the rest of the file */
+    long long length;
 };
 /** This instance is used to create new PacketFileDownloadRequest */
 extern const union Packet NewPacketFileDownloadRequest;
@@ -120,6 +127,10 @@ struct PacketFileUploadValidation {
     char type;
     char accepted;
     unsigned int id;
+    /** Token to give back to resume the upload if it's interrupted */
+    unsigned long long token;
+    /** Amount of bytes the server already has, the client sends data from there */
+    long long offset;
 };
 /** This instance is used to create new PacketFileUploadValidation */
 extern const union Packet NewPacketFileUploadValidation;
@@ -133,6 +144,12 @@ struct PacketFileDownloadValidation {
     char accepted;
     unsigned int fileId;
     long long fileSize;
+    /** Offset of the sent range, as requested by the client */
+    long long offset;
+    /** Length of the sent range, shortened if the requested one goes past the end of the file */
+    long long length;
+    /** Root of the hash tree of the whole file, its blocks are checked against it (see hash-tree.h) */
+    TreeHash rootHash;
 };
 /** This instance is used to create new PacketFileDownloadValidation */
 extern const union Packet NewPacketFileDownloadValidation;
@@ -144,6 +161,8 @@ extern const union Packet NewPacketFileDownloadValidation;
 struct PacketFileDataTransfer {
     char type;
     unsigned int id;
+    /** Offset of the data in the file, as ranges of a file are sent at once */
+    long long offset;
     char data[FILE_TRANSFER_CHUNK_SIZE];
 };
 /** This instance is used to create a new PacketFileDataTransfer */
@@ -179,6 +198,8 @@ struct PacketCreateRoom {
     char type;
     char roomName[ROOM_NAME_MAX_LENGTH + 1];
     char roomDesc[ROOM_DESC_MAX_LENGTH + 1];
+    /** Equal to 1 to create a large room, accepting up to LARGE_ROOM_MAX_USERS members, else 0 */
+    char large;
 };
 /** This instance is used to create a new PacketCreateRoom  */
 extern const union Packet NewPacketCreateRoom;
@@ -214,6 +235,87 @@ struct PacketListRooms {
 /** This instance is used to create a new PacketListRooms */
 extern const union Packet NewPacketListRooms;
 
+/**
+ * \class PacketPing
+ * \brief This packet is sent by server to client to check the connection is alive and measure round-trip time
+ */
+struct PacketPing {
+    char type;
+    unsigned int sequence;
+};
+/** This instance is used to create a new PacketPing */
+extern const union Packet NewPacketPing;
+
+/**
+ * \class PacketPong
+ * \brief This packet is sent by client to answer a PacketPing, echoing its sequence
+ */
+struct PacketPong {
+    char type;
+    unsigned int sequence;
+};
+/** This instance is used to create a new PacketPong */
+extern const union Packet NewPacketPong;
+
+/**
+ * \class PacketStatsRequest
+ * \brief This packet is sent by client to request server statistics
+ */
+struct PacketStatsRequest {
+    char type;
+};
+/** This instance is used to create a new PacketStatsRequest */
+extern const union Packet NewPacketStatsRequest;
+
+/**
+ * \class PacketFileDataAck
+ * \brief This packet is sent by the receiver of file data, allowing the sender to send more (see FILE_TRANSFER_WINDOW_BYTES)
+ */
+struct PacketFileDataAck {
+    char type;
+    unsigned int id;
+    /** Offset in the file up to which data was received, within the range being sent */
+    long long offset;
+};
+/** This instance is used to create a new PacketFileDataAck */
+extern const union Packet NewPacketFileDataAck;
+
+/**
+ * \class PacketFileBlockProof
+ * \brief This packet is sent to client by server before the data of a block of a downloaded file, to check the block once received
+ *
+ * A proof longer than HASH_TREE_PROOF_HASHES hashes is split over packets sent one after the other.
+ */
+struct PacketFileBlockProof {
+    char type;
+    /** Amount of hashes of the whole proof */
+    unsigned char proofLength;
+    /** Index in the proof of the first hash of this packet */
+    unsigned char first;
+    unsigned int fileId;
+    /** Index of the block in the file */
+    unsigned int block;
+    /** Hash of the block */
+    TreeHash hash;
+    /** Hashes linking the block to the root of the tree, from the bottom (see hash-tree.h) */
+    TreeHash siblings[HASH_TREE_PROOF_HASHES];
+};
+/** This instance is used to create a new PacketFileBlockProof */
+extern const union Packet NewPacketFileBlockProof;
+
+/**
+ * \class PacketFileUploadDigest
+ * \brief This packet is sent to server after the data of an uploaded file, which is kept only if the checksum matches
+ */
+struct PacketFileUploadDigest {
+    char type;
+    unsigned int id;
+    /** CRC32C of the whole file (see crc32c.h), computed as the file is sent */
+    unsigned int checksum;
+};
+/** This instance is used to create a new PacketFileUploadDigest */
+extern const union Packet NewPacketFileUploadDigest;
+
 /**
  * \class Packet
  * \brief A generic union type for packets
@@ -235,8 +337,21 @@ typedef union Packet {
     struct PacketServerSuccess asServerSuccessMessagePacket;
     struct PacketCreateRoom asCreateRoomPacket;
     struct PacketJoinRoom asJoinRoomPacket;
+    struct PacketPing asPingPacket;
+    struct PacketPong asPongPacket;
+    struct PacketFileDataAck asFileDataAckPacket;
+    struct PacketFileBlockProof asFileBlockProofPacket;
+    struct PacketFileUploadDigest asFileUploadDigestPacket;
 } Packet;
 
+/**
+ * \brief Retrieves the real size of the underlying type
+ *
+ * \param packet The packet to get real size of
+ * \return the real size of the underlying type (the number of bytes to send) or 0 if the type isn't known
+ */
+unsigned int packets_sizeOf(Packet* packet);
+
 /**
  * \brief Receives the next packet incoming on the given socket
  *
@@ -247,6 +362,18 @@ typedef union Packet {
  */
 int receiveNextPacket(Socket socket, Packet* packet);
 
+/**
+ * \brief Receives the next packet incoming on the given socket if it already started arriving
+ *
+ * It doesn't wait for a packet, but waits for the rest of a packet once its type is received.
+ *
+ * \param socket The socket to receive the packet on
+ * \param packet The packet to fill in with received data
+ *
+ * \return the number of bytes received (can be lower than or equal to 0), or SOCKET_WOULD_BLOCK if no packet arrived
+ */
+int receiveAvailablePacket(Socket socket, Packet* packet);
+
 /**
  * \brief Sends the given packet on the given socket
  *
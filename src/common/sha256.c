@@ -0,0 +1,128 @@
+#include "sha256.h"
+#include <string.h>
+
+/** First 32 bits of the fractional parts of the cube roots of the first 64 primes */
+static const unsigned int roundConstants[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+/**
+ * \brief Rotates the given word right by the given amount of bits.
+ */
+unsigned int rotateRight(unsigned int word, int bits) {
+    return (word >> bits) | (word << (32 - bits));
+}
+
+/**
+ * \brief Mixes a chunk of 64 bytes into the state.
+ *
+ * Words are read byte by byte, so the result doesn't depend on the endianness.
+ */
+void compressChunk(unsigned int* state, const unsigned char* chunk) {
+    unsigned int words[64];
+    for (int i = 0; i < 16; i++) {
+        words[i] = (unsigned int) chunk[4 * i] << 24 | (unsigned int) chunk[4 * i + 1] << 16
+            | (unsigned int) chunk[4 * i + 2] << 8 | chunk[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        unsigned int s0 = rotateRight(words[i - 15], 7) ^ rotateRight(words[i - 15], 18) ^ (words[i - 15] >> 3);
+        unsigned int s1 = rotateRight(words[i - 2], 17) ^ rotateRight(words[i - 2], 19) ^ (words[i - 2] >> 10);
+        words[i] = words[i - 16] + s0 + words[i - 7] + s1;
+    }
+
+    unsigned int a = state[0], b = state[1], c = state[2], d = state[3];
+    unsigned int e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+        unsigned int s1 = rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25);
+        unsigned int choice = (e & f) ^ (~e & g);
+        unsigned int temp1 = h + s1 + choice + roundConstants[i] + words[i];
+        unsigned int s0 = rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22);
+        unsigned int majority = (a & b) ^ (a & c) ^ (b & c);
+        unsigned int temp2 = s0 + majority;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + temp1;
+        d = c;
+        c = b;
+        b = a;
+        a = temp1 + temp2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+void sha256_init(Sha256* sha) {
+    /* First 32 bits of the fractional parts of the square roots of the first 8 primes */
+    sha->state[0] = 0x6A09E667;
+    sha->state[1] = 0xBB67AE85;
+    sha->state[2] = 0x3C6EF372;
+    sha->state[3] = 0xA54FF53A;
+    sha->state[4] = 0x510E527F;
+    sha->state[5] = 0x9B05688C;
+    sha->state[6] = 0x1F83D9AB;
+    sha->state[7] = 0x5BE0CD19;
+    sha->length = 0;
+}
+
+void sha256_update(Sha256* sha, const char* data, unsigned long long length) {
+    const unsigned char* bytes = (const unsigned char*) data;
+    unsigned int buffered = (unsigned int) (sha->length % 64);
+    sha->length += length;
+
+    /* Completing the chunk started by the previous data */
+    if (buffered > 0) {
+        unsigned int missing = 64 - buffered;
+        if (length < missing) {
+            memcpy(sha->chunk + buffered, bytes, length);
+            return;
+        }
+        memcpy(sha->chunk + buffered, bytes, missing);
+        compressChunk(sha->state, sha->chunk);
+        bytes += missing;
+        length -= missing;
+    }
+
+    /* Whole chunks are hashed in place */
+    while (length >= 64) {
+        compressChunk(sha->state, bytes);
+        bytes += 64;
+        length -= 64;
+    }
+    memcpy(sha->chunk, bytes, length);
+}
+
+void sha256_final(Sha256* sha, unsigned char* digest) {
+    unsigned long long bitLength = sha->length * 8;
+
+    /* A 1 bit, zeros up to 8 bytes before the end of a chunk, then the length in bits */
+    unsigned char padding[72] = {0x80};
+    unsigned int buffered = (unsigned int) (sha->length % 64);
+    unsigned int paddingLength = (buffered < 56 ? 56 : 120) - buffered;
+    for (int i = 0; i < 8; i++) {
+        padding[paddingLength + i] = (unsigned char) (bitLength >> (56 - 8 * i));
+    }
+    sha256_update(sha, (const char*) padding, paddingLength + 8);
+
+    for (int i = 0; i < 8; i++) {
+        digest[4 * i] = (unsigned char) (sha->state[i] >> 24);
+        digest[4 * i + 1] = (unsigned char) (sha->state[i] >> 16);
+        digest[4 * i + 2] = (unsigned char) (sha->state[i] >> 8);
+        digest[4 * i + 3] = (unsigned char) sha->state[i];
+    }
+}
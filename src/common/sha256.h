@@ -0,0 +1,57 @@
+/**
+ * \file sha256.h
+ * \brief Computes SHA-256 digests, identifying the blocks of shared files (see hash-tree.h).
+ *
+ * Unlike CRC32C (see crc32c.h), finding data matching a given digest is out of reach, so a digest
+ * can be trusted whoever sent the data. The digest is updated part by part, so data doesn't need to
+ * be contiguous to be hashed.
+ */
+
+#ifndef C_CHAT_SHA256_H
+#define C_CHAT_SHA256_H
+
+/**
+ * \def SHA256_DIGEST_BYTES
+ * \brief Size of a digest (bytes)
+ */
+#define SHA256_DIGEST_BYTES 32
+
+/**
+ * \struct Sha256
+ * \brief State of a digest being computed.
+ */
+typedef struct Sha256 {
+    unsigned int state[8];
+    /** Amount of hashed bytes */
+    unsigned long long length;
+    /** Bytes waiting for a whole chunk of 64 bytes */
+    unsigned char chunk[64];
+} Sha256;
+
+/**
+ * \brief Starts a new digest.
+ *
+ * \param sha The state of the digest to start
+ */
+void sha256_init(Sha256* sha);
+
+/**
+ * \brief Hashes the given data, following the data already hashed.
+ *
+ * \param sha The state of the digest
+ * \param data The following data
+ * \param length The size of the following data
+ */
+void sha256_update(Sha256* sha, const char* data, unsigned long long length);
+
+/**
+ * \brief Completes the digest.
+ *
+ * The digest of "abc" starts with 0xBA7816BF.
+ *
+ * \param sha The state of the digest, which MUST be started again to be used afterwards
+ * \param digest The buffer to store the digest in, SHA256_DIGEST_BYTES long
+ */
+void sha256_final(Sha256* sha, unsigned char* digest);
+
+#endif //C_CHAT_SHA256_H
@@ -0,0 +1,252 @@
+#include "slab.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include "interop.h"
+#include "atomics.h"
+#include "adaptive-lock.h"
+
+/**
+ * \def SLAB_ALIGNMENT
+ * \brief Alignment of the objects, enough for any type of the program
+ */
+#define SLAB_ALIGNMENT 16
+
+#if IS_POSIX
+
+    #include <pthread.h>
+
+    typedef pthread_key_t SlabCacheKey;
+
+#elif IS_WINDOWS
+
+    #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+    #endif
+
+    typedef DWORD SlabCacheKey;
+
+#endif
+
+/**
+ * \brief A free object, linking to the next one
+ */
+struct SlabFreeObject {
+    struct SlabFreeObject* next;
+};
+
+/**
+ * \brief A page of objects, the objects following the header
+ */
+struct SlabPage {
+    struct SlabPage* next;
+    char padding[SLAB_ALIGNMENT - sizeof(struct SlabPage*)];
+};
+
+/**
+ * \brief The free objects kept by a thread for a slab
+ */
+struct SlabCache {
+    struct Slab* slab;
+    unsigned int count;
+    /** Amount of objects taken by the next refill, growing with the use of the cache */
+    unsigned int refillBatch;
+    void* objects[SLAB_CACHE_CAPACITY];
+};
+
+struct Slab {
+    /** Alignment of the objects : a cache line for objects spanning one or more, else SLAB_ALIGNMENT */
+    unsigned int alignment;
+    /** Size of the objects, rounded up to their alignment */
+    unsigned int objectSize;
+    /** Key of the cache of each thread */
+    SlabCacheKey cacheKey;
+
+    /** Protects the fields below */
+    AdaptiveLock lock;
+    /** Free objects not cached by any thread */
+    struct SlabFreeObject* freeObjects;
+    /** Allocated pages */
+    struct SlabPage* pages;
+    unsigned int pageCount;
+
+    /** Amount of allocated objects not released yet, MUST be accessed using atomics */
+    volatile unsigned int live;
+};
+
+/**
+ * \brief Moves objects from the cache to the free list of the slab, keeping the given amount.
+ */
+void slab_drainCache(struct SlabCache* cache, unsigned int kept) {
+    Slab* slab = cache->slab;
+    adaptiveLock_acquire(&slab->lock);
+    while (cache->count > kept) {
+        struct SlabFreeObject* object = cache->objects[--cache->count];
+        object->next = slab->freeObjects;
+        slab->freeObjects = object;
+    }
+    adaptiveLock_release(&slab->lock);
+}
+
+/**
+ * \brief Moves objects from the free list of the slab to the empty cache, allocating a page if needed.
+ *
+ * A thread allocating a single object only takes one : many connection threads allocate once.
+ * Threads allocating again take twice as many objects each time, up to half a cache.
+ */
+void slab_refillCache(struct SlabCache* cache) {
+    Slab* slab = cache->slab;
+    adaptiveLock_acquire(&slab->lock);
+    if (slab->freeObjects == NULL) {
+        /* The page is carved while holding the lock, it happens once per SLAB_PAGE_OBJECTS allocations */
+        struct SlabPage* page = malloc(sizeof(struct SlabPage) + slab->alignment + (size_t) slab->objectSize * SLAB_PAGE_OBJECTS);
+        page->next = slab->pages;
+        slab->pages = page;
+        slab->pageCount++;
+
+        uintptr_t firstObject = (uintptr_t) (page + 1);
+        char* objects = (char*) ((firstObject + slab->alignment - 1) / slab->alignment * slab->alignment);
+        for (int i = SLAB_PAGE_OBJECTS - 1; i >= 0; i--) {
+            struct SlabFreeObject* object = (struct SlabFreeObject*) (objects + (size_t) slab->objectSize * i);
+            object->next = slab->freeObjects;
+            slab->freeObjects = object;
+        }
+    }
+    while (cache->count < cache->refillBatch && slab->freeObjects != NULL) {
+        cache->objects[cache->count++] = slab->freeObjects;
+        slab->freeObjects = slab->freeObjects->next;
+    }
+    adaptiveLock_release(&slab->lock);
+
+    if (cache->refillBatch < SLAB_CACHE_CAPACITY / 2) {
+        cache->refillBatch *= 2;
+    }
+}
+
+/**
+ * \brief Hands the cache of an exiting thread back to its slab.
+ */
+void slab_releaseCache(void* data) {
+    struct SlabCache* cache = data;
+    if (cache != NULL) {
+        slab_drainCache(cache, 0);
+        free(cache);
+    }
+}
+
+#if IS_POSIX
+
+    void slab_createCacheKey(Slab* slab) {
+        pthread_key_create(&slab->cacheKey, slab_releaseCache);
+    }
+
+    void slab_deleteCacheKey(Slab* slab) {
+        pthread_key_delete(slab->cacheKey);
+    }
+
+    struct SlabCache* slab_getCache(Slab* slab) {
+        return pthread_getspecific(slab->cacheKey);
+    }
+
+    void slab_setCache(Slab* slab, struct SlabCache* cache) {
+        pthread_setspecific(slab->cacheKey, cache);
+    }
+
+#elif IS_WINDOWS
+
+    /**
+     * \brief Fiber local storage callback, run when a thread exits.
+     */
+    void NTAPI slab_releaseFiberCache(PVOID data) {
+        slab_releaseCache(data);
+    }
+
+    void slab_createCacheKey(Slab* slab) {
+        slab->cacheKey = FlsAlloc(slab_releaseFiberCache);
+    }
+
+    void slab_deleteCacheKey(Slab* slab) {
+        FlsFree(slab->cacheKey);
+    }
+
+    struct SlabCache* slab_getCache(Slab* slab) {
+        return FlsGetValue(slab->cacheKey);
+    }
+
+    void slab_setCache(Slab* slab, struct SlabCache* cache) {
+        FlsSetValue(slab->cacheKey, cache);
+    }
+
+#endif
+
+/**
+ * \brief Retrieves the cache of the calling thread, creating it on first use.
+ */
+struct SlabCache* slab_threadCache(Slab* slab) {
+    struct SlabCache* cache = slab_getCache(slab);
+    if (cache == NULL) {
+        cache = malloc(sizeof(struct SlabCache));
+        cache->slab = slab;
+        cache->count = 0;
+        cache->refillBatch = 1;
+        slab_setCache(slab, cache);
+    }
+    return cache;
+}
+
+Slab* slab_create(unsigned int objectSize) {
+    Slab* slab = malloc(sizeof(Slab));
+    if (objectSize < sizeof(struct SlabFreeObject)) {
+        objectSize = sizeof(struct SlabFreeObject);
+    }
+    /* Large objects don't straddle cache lines more than needed, so the fields they start with share a line */
+    slab->alignment = objectSize >= ATOMICS_CACHE_LINE ? ATOMICS_CACHE_LINE : SLAB_ALIGNMENT;
+    slab->objectSize = (objectSize + slab->alignment - 1) / slab->alignment * slab->alignment;
+    slab_createCacheKey(slab);
+    adaptiveLock_init(&slab->lock);
+    slab->freeObjects = NULL;
+    slab->pages = NULL;
+    slab->pageCount = 0;
+    slab->live = 0;
+    return slab;
+}
+
+void slab_destroy(Slab* slab) {
+    /* Caches of running threads are lost, their objects belong to the released pages */
+    slab_deleteCacheKey(slab);
+    while (slab->pages != NULL) {
+        struct SlabPage* page = slab->pages;
+        slab->pages = page->next;
+        free(page);
+    }
+    free(slab);
+}
+
+void* slab_alloc(Slab* slab) {
+    struct SlabCache* cache = slab_threadCache(slab);
+    if (cache->count == 0) {
+        slab_refillCache(cache);
+    }
+    atomics_fetchAdd(&slab->live, 1);
+    return cache->objects[--cache->count];
+}
+
+void slab_free(Slab* slab, void* object) {
+    struct SlabCache* cache = slab_threadCache(slab);
+    if (cache->count == SLAB_CACHE_CAPACITY) {
+        slab_drainCache(cache, SLAB_CACHE_CAPACITY / 2);
+    }
+    cache->objects[cache->count++] = object;
+    atomics_fetchAdd(&slab->live, (unsigned int) -1);
+}
+
+void slab_stats(Slab* slab, SlabStats* stats) {
+    adaptiveLock_acquire(&slab->lock);
+    stats->pages = slab->pageCount;
+    adaptiveLock_release(&slab->lock);
+
+    /* Pages may have been allocated since they were counted */
+    stats->live = atomics_load(&slab->live);
+    unsigned int total = stats->pages * SLAB_PAGE_OBJECTS;
+    stats->free = total > stats->live ? total - stats->live : 0;
+}
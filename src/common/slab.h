@@ -0,0 +1,92 @@
+/**
+ * \file slab.h
+ * \brief Allocators of fixed-size objects, recycling released objects instead of returning them to the heap.
+ *
+ * A slab carves objects of a single size out of pages of SLAB_PAGE_OBJECTS objects. Pages are
+ * never released until the slab is destroyed : released objects are kept for the next allocations,
+ * so connection churn reuses the same memory instead of growing and fragmenting the heap.
+ *
+ * Each thread allocates from and releases to its own cache of up to SLAB_CACHE_CAPACITY objects,
+ * without any lock. Only when its cache is empty, or full, does a thread take the lock of the slab
+ * to move a batch of objects from, or half a cache to, the shared free list. Objects can be
+ * released by another thread than the one which allocated them. The cache of a thread is handed
+ * back to the slab when the thread exits.
+ */
+
+#ifndef C_CHAT_SLAB_H
+#define C_CHAT_SLAB_H
+
+/**
+ * \def SLAB_PAGE_OBJECTS
+ * \brief Amount of objects allocated at once when a slab runs out of free objects
+ */
+#define SLAB_PAGE_OBJECTS 64
+
+/**
+ * \def SLAB_CACHE_CAPACITY
+ * \brief Maximum amount of free objects kept by a thread for a slab
+ */
+#define SLAB_CACHE_CAPACITY 32
+
+/**
+ * \class Slab
+ * \brief An allocator of objects of a single type
+ */
+typedef struct Slab Slab;
+
+/**
+ * \class SlabStats
+ * \brief Usage of a slab
+ */
+typedef struct SlabStats {
+    /** Amount of allocated objects which weren't released yet */
+    unsigned int live;
+    /** Amount of objects available for allocations, in the free list and in thread caches */
+    unsigned int free;
+    /** Amount of pages allocated from the heap */
+    unsigned int pages;
+} SlabStats;
+
+/**
+ * \brief Creates a slab.
+ *
+ * Objects of at least ATOMICS_CACHE_LINE bytes start on a cache line, so fields at the front of
+ * an object share one.
+ *
+ * \param objectSize The size of the objects, usually sizeof(Type)
+ * \return the created slab
+ */
+Slab* slab_create(unsigned int objectSize);
+
+/**
+ * \brief Releases the pages of the given slab. Its objects MUST NOT be used anymore.
+ *
+ * \param slab The slab to destroy
+ */
+void slab_destroy(Slab* slab);
+
+/**
+ * \brief Allocates an uninitialized object.
+ *
+ * \param slab The slab to allocate from
+ * \return the object
+ */
+void* slab_alloc(Slab* slab);
+
+/**
+ * \brief Releases an object, which MUST have been allocated by the given slab.
+ *
+ * \param slab The slab the object was allocated by
+ * \param object The object to release
+ */
+void slab_free(Slab* slab, void* object);
+
+/**
+ * \brief Retrieves the usage of the given slab, as other threads may allocate meanwhile it's approximative.
+ *
+ * \param slab The slab
+ * \param stats The structure receiving the usage
+ */
+void slab_stats(Slab* slab, SlabStats* stats);
+
+#endif //C_CHAT_SLAB_H
@@ -18,6 +18,13 @@
 #endif
 
 #define CLIENTS_BACKLOG 5
+
+/**
+ * \def SOCKETS_POLL_STACK_COUNT
+ * \brief Amount of sockets waitForData waits for without allocating
+ */
+#define SOCKETS_POLL_STACK_COUNT 16
+
 #if IS_POSIX
 
     #include <sys/socket.h>
@@ -25,10 +32,8 @@
     #include <arpa/inet.h>
     #include <unistd.h>
     #include <inttypes.h>
-
-    struct UnixSocket {
-        int socket;
-    };
+    #include <poll.h>
+    #include <errno.h>
 
     Socket createClientSocket(const char* ipAddress, const char* port) {
         int s = socket(PF_INET, SOCK_STREAM, 0);
@@ -48,11 +53,8 @@
             exit(EXIT_FAILURE);
         }
 
-        struct UnixSocket *socketInfo = malloc(sizeof(struct UnixSocket));
-        socketInfo->socket = s;
-
         Socket ret;
-        ret.info = socketInfo;
+        ret.handle = s;
 
         return ret;
     }
@@ -83,70 +85,115 @@
             exit(EXIT_FAILURE);
         }
 
-        struct UnixSocket* socketInfo = malloc(sizeof(struct UnixSocket));
-        socketInfo->socket = s;
-
         Socket ret;
-        ret.info = socketInfo;
+        ret.handle = s;
 
         return ret;
     }
 
     Socket acceptClient(Socket serverSocket) {
-        struct UnixSocket *socketInfo = serverSocket.info;
-
         struct sockaddr_in adClient;
         socklen_t lgA = sizeof(struct sockaddr_in);
-        int clientSocket = accept(socketInfo->socket, (struct sockaddr*)&adClient, &lgA);
+        int clientSocket = accept((int) serverSocket.handle, (struct sockaddr*)&adClient, &lgA);
         if (clientSocket == -1) {
             printf("Unable to accept client connection.\n");
-            close(socketInfo->socket);
+            close((int) serverSocket.handle);
             exit(EXIT_FAILURE);
         }
 
-        struct UnixSocket *clientInfo = malloc(sizeof(struct UnixSocket));
-        clientInfo->socket = clientSocket;
-
         Socket ret;
-        ret.info = clientInfo;
+        ret.handle = clientSocket;
 
         return ret;
     }
 
     int receiveFrom(Socket clientSocket, char* buffer, unsigned int bufferSize) {
-        struct UnixSocket *socketInfo = clientSocket.info;
-
-        int callSuccess = recv(socketInfo->socket, buffer, bufferSize, 0);
+        /* The socket is left open on failure : copies of the handle may still be in use, it's closed by closeSocket */
+        int callSuccess = recv((int) clientSocket.handle, buffer, bufferSize, 0);
         if (callSuccess == 0) {
             DEBUG_CALL(printf("Connection closed.\n"));
         } else if(callSuccess < 0) {
             DEBUG_CALL(printf("Unable to received data.\n"));
-            close(socketInfo->socket);
         }
 
         return callSuccess;
     }
 
+    int receiveAvailable(Socket clientSocket, char* buffer, unsigned int bufferSize) {
+        int callSuccess = recv((int) clientSocket.handle, buffer, bufferSize, MSG_DONTWAIT);
+        if (callSuccess < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return SOCKET_WOULD_BLOCK;
+        }
+
+        return callSuccess;
+    }
+
+    int peekFrom(Socket clientSocket, char* buffer, unsigned int bufferSize) {
+        return recv((int) clientSocket.handle, buffer, bufferSize, MSG_PEEK);
+    }
+
     int sendTo(Socket clientSocket, const char* buffer, unsigned int bufferSize) {
-        struct UnixSocket *socketInfo = clientSocket.info;
+        /* A blocking send can still write only a part of the buffer, sending the rest */
+        unsigned int sent = 0;
+        while (sent < bufferSize) {
+            int callSuccess = send((int) clientSocket.handle, buffer + sent, bufferSize - sent, 0);
+            if (callSuccess == 0) {
+                DEBUG_CALL(printf("Connection closed.\n"));
+                return callSuccess;
+            } else if (callSuccess < 0) {
+                DEBUG_CALL(printf("Unable to send data through socket.\n"));
+                return callSuccess;
+            }
+            sent += callSuccess;
+        }
 
-        int callSuccess = send(socketInfo->socket, buffer, bufferSize, 0);
-        if (callSuccess == 0) {
-            DEBUG_CALL(printf("Connection closed.\n"));
-        } else if (callSuccess < 0) {
-            DEBUG_CALL(printf("Unable to send data through socket.\n"));
-            close(socketInfo->socket);
+        return (int) sent;
+    }
+
+    int sendAvailable(Socket clientSocket, const char* buffer, unsigned int bufferSize) {
+        int callSuccess = send((int) clientSocket.handle, buffer, bufferSize, MSG_DONTWAIT);
+        if (callSuccess < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return SOCKET_WOULD_BLOCK;
         }
 
         return callSuccess;
     }
 
+    int waitForData(const Socket* sockets, unsigned int count, char* ready, int timeoutMillis) {
+        struct pollfd stackDescriptors[SOCKETS_POLL_STACK_COUNT];
+        struct pollfd* descriptors = count <= SOCKETS_POLL_STACK_COUNT ? stackDescriptors : malloc(sizeof(struct pollfd) * count);
+        for (unsigned int i = 0; i < count; i++) {
+            /* Negative descriptors are ignored by poll */
+            descriptors[i].fd = (int) sockets[i].handle;
+            descriptors[i].events = POLLIN;
+            descriptors[i].revents = 0;
+        }
+
+        int callSuccess = poll(descriptors, count, timeoutMillis);
+        if (callSuccess < 0) {
+            DEBUG_CALL(printf("Unable to wait for data.\n"));
+        } else if (ready != NULL) {
+            for (unsigned int i = 0; i < count; i++) {
+                ready[i] = descriptors[i].revents != 0;
+            }
+        }
+
+        if (descriptors != stackDescriptors) {
+            free(descriptors);
+        }
+        return callSuccess;
+    }
+
+    void shutdownSocket(Socket socket) {
+        if (socket.handle != SOCKET_INVALID_HANDLE) {
+            shutdown((int) socket.handle, SHUT_RDWR);
+        }
+    }
+
     void closeSocket(Socket* socket) {
-        struct UnixSocket *socketInfo = socket->info;
-        if (socketInfo != NULL) {
-            close(socketInfo->socket);
-            free(socketInfo);
-            socket->info = NULL;
+        if (socket->handle != SOCKET_INVALID_HANDLE) {
+            close((int) socket->handle);
+            socket->handle = SOCKET_INVALID_HANDLE;
         }
     }
 
@@ -172,10 +219,6 @@
 
     static int winLibInitialized = 0;
 
-    struct WinSocket {
-        SOCKET socket;
-    };
-
     void initialize() {
         WSADATA wsaData;
 
@@ -224,11 +267,8 @@
             exit(EXIT_FAILURE);
         }
 
-        struct WinSocket* info = malloc(sizeof(struct WinSocket));
-        info->socket = ConnectSocket;
-
         Socket ret;
-        ret.info = info;
+        ret.handle = (intptr_t) ConnectSocket;
 
         return ret;
     }
@@ -277,67 +317,112 @@
             exit(EXIT_FAILURE);
         }
 
-        struct WinSocket* info = malloc(sizeof(struct WinSocket));
-        info->socket = ListenSocket;
-
         Socket ret;
-        ret.info = info;
+        ret.handle = (intptr_t) ListenSocket;
 
         return ret;
     }
 
     Socket acceptClient(Socket info) {
-        struct WinSocket *socketInfo = info.info;
-
-        SOCKET ClientSocket = accept(socketInfo->socket, NULL, NULL);
+        SOCKET ClientSocket = accept((SOCKET) info.handle, NULL, NULL);
         if (ClientSocket == INVALID_SOCKET) {
             printf("Unable to accept client connection. Error code : %d\n", WSAGetLastError());
-            closesocket(socketInfo->socket);
+            closesocket((SOCKET) info.handle);
             WSACleanup();
             exit(EXIT_FAILURE);
         }
 
-        struct WinSocket *clientInfo = malloc(sizeof(struct WinSocket));
-        clientInfo->socket = ClientSocket;
-
         Socket ret;
-        ret.info = clientInfo;
+        ret.handle = (intptr_t) ClientSocket;
         return ret;
     }
 
     int receiveFrom(Socket clientSocket, char* buffer, unsigned int bufferSize) {
-        struct WinSocket *socketInfo = clientSocket.info;
-
-        int callSuccess = recv(socketInfo->socket, buffer, bufferSize, 0);
+        /* The socket is left open on failure : copies of the handle may still be in use, it's closed by closeSocket */
+        int callSuccess = recv((SOCKET) clientSocket.handle, buffer, bufferSize, 0);
         if (callSuccess == 0) {
             DEBUG_CALL(printf("Connection closed.\n"));
         } else if(callSuccess < 0) {
             DEBUG_CALL(printf("Unable to received data. Error code : %d\n", WSAGetLastError()));
-            closesocket(socketInfo->socket);
         }
 
         return callSuccess;
     }
 
+    int receiveAvailable(Socket clientSocket, char* buffer, unsigned int bufferSize) {
+        /* recv has no non-blocking flag : it's only called once data is known to be available */
+        u_long available;
+        if (ioctlsocket((SOCKET) clientSocket.handle, FIONREAD, &available) == SOCKET_ERROR) {
+            return -1;
+        }
+        if (available == 0) {
+            /* A closed connection has nothing available either, the next blocking receive tells */
+            return SOCKET_WOULD_BLOCK;
+        }
+
+        return receiveFrom(clientSocket, buffer, bufferSize);
+    }
+
+    int peekFrom(Socket clientSocket, char* buffer, unsigned int bufferSize) {
+        return recv((SOCKET) clientSocket.handle, buffer, bufferSize, MSG_PEEK);
+    }
+
     int sendTo(Socket clientSocket, const char* buffer, unsigned int bufferSize) {
-        struct WinSocket *socketInfo = clientSocket.info;
+        /* A blocking send can still write only a part of the buffer, sending the rest */
+        unsigned int sent = 0;
+        while (sent < bufferSize) {
+            int callSuccess = send((SOCKET) clientSocket.handle, buffer + sent, bufferSize - sent, 0);
+            if (callSuccess == SOCKET_ERROR) {
+                DEBUG_CALL(printf("Unable to send data through socket. Error code : %d\n", WSAGetLastError()));
+                return callSuccess;
+            }
+            sent += callSuccess;
+        }
+
+        return (int) sent;
+    }
+
+    int sendAvailable(Socket clientSocket, const char* buffer, unsigned int bufferSize) {
+        /* send has no non-blocking flag, and a non-blocking socket would make receives non-blocking too */
+        return sendTo(clientSocket, buffer, bufferSize);
+    }
+
+    int waitForData(const Socket* sockets, unsigned int count, char* ready, int timeoutMillis) {
+        WSAPOLLFD stackDescriptors[SOCKETS_POLL_STACK_COUNT];
+        WSAPOLLFD* descriptors = count <= SOCKETS_POLL_STACK_COUNT ? stackDescriptors : malloc(sizeof(WSAPOLLFD) * count);
+        for (unsigned int i = 0; i < count; i++) {
+            /* Unlike poll, WSAPoll doesn't ignore invalid sockets : they're given no event to wait for */
+            descriptors[i].fd = (SOCKET) sockets[i].handle;
+            descriptors[i].events = sockets[i].handle == SOCKET_INVALID_HANDLE ? 0 : POLLRDNORM;
+            descriptors[i].revents = 0;
+        }
 
-        int callSuccess = send(socketInfo->socket, buffer, bufferSize, 0);
+        int callSuccess = WSAPoll(descriptors, count, timeoutMillis);
         if (callSuccess == SOCKET_ERROR) {
-            DEBUG_CALL(printf("Unable to send data through socket. Error code : %d\n", WSAGetLastError()));
-            closesocket(socketInfo->socket);
+            DEBUG_CALL(printf("Unable to wait for data. Error code : %d\n", WSAGetLastError()));
+        } else if (ready != NULL) {
+            for (unsigned int i = 0; i < count; i++) {
+                ready[i] = descriptors[i].revents != 0;
+            }
         }
 
+        if (descriptors != stackDescriptors) {
+            free(descriptors);
+        }
         return callSuccess;
     }
 
+    void shutdownSocket(Socket socket) {
+        if (socket.handle != SOCKET_INVALID_HANDLE) {
+            shutdown((SOCKET) socket.handle, SD_BOTH);
+        }
+    }
+
     void closeSocket(Socket* socket) {
-        struct WinSocket *socketInfo = socket->info;
-        if (socketInfo != NULL) {
-            shutdown(socketInfo->socket, SD_BOTH);
-            closesocket(socketInfo->socket);
-            free(socketInfo);
-            socket->info = NULL;
+        if (socket->handle != SOCKET_INVALID_HANDLE) {
+            shutdown((SOCKET) socket->handle, SD_BOTH);
+            closesocket((SOCKET) socket->handle);
+            socket->handle = SOCKET_INVALID_HANDLE;
         }
     }
 
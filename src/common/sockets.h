@@ -9,15 +9,30 @@
 #ifndef C_CHAT_SOCKETS_H
 #define C_CHAT_SOCKETS_H
 
+#include <stdint.h>
+
+/**
+ * \def SOCKET_INVALID_HANDLE
+ * \brief Handle of a closed socket
+ */
+#define SOCKET_INVALID_HANDLE ((intptr_t) -1)
+
+/**
+ * \def SOCKET_WOULD_BLOCK
+ * \brief Returned by non-blocking calls when nothing can be transferred right away
+ */
+#define SOCKET_WOULD_BLOCK (-2)
+
 /**
  * \struct Socket
  * \brief Information of a socket.
  * 
- * To store information of a socket.
+ * The OS handle is stored inline : a file descriptor under Unix, a SOCKET under Windows. Copies
+ * of a socket refer to the same connection, only one of them must be closed.
  * 
  */
 typedef struct Socket {
-    void* info;
+    intptr_t handle;
 } Socket;
 
 /**
@@ -55,9 +70,31 @@ Socket acceptClient(Socket serverSocket);
 */
 int receiveFrom(Socket clientSocket, char* buffer, unsigned int bufferSize);
 
+/**
+ * \brief Receives the data already available on the given socket, without waiting for more.
+ *
+ * \param clientSocket The socket to receive data from
+ * \param buffer A buffer to store received data in
+ * \param bufferSize The maximum size of data to receive
+ * \return the number of bytes received, SOCKET_WOULD_BLOCK if no data is available or -1 if an error occurred
+*/
+int receiveAvailable(Socket clientSocket, char* buffer, unsigned int bufferSize);
+
+/**
+ * \brief Copies available data of the given socket without consuming it.
+ *
+ * \param clientSocket The socket to look at data of
+ * \param buffer A buffer to store the data in
+ * \param bufferSize The maximum size of data to copy
+ * \return the number of bytes copied or -1 if an error occurred
+*/
+int peekFrom(Socket clientSocket, char* buffer, unsigned int bufferSize);
+
 /**
  * \brief Sends data through the given socket.
  * 
+ * This is a blocking call, it returns once all the data is sent.
+ * 
  * \param clientSocket The socket to send a message through
  * \param buffer A buffer containing to data to send
  * \param bufferSize The size of the data to send
@@ -65,6 +102,42 @@ int receiveFrom(Socket clientSocket, char* buffer, unsigned int bufferSize);
 */
 int sendTo(Socket clientSocket, const char* buffer, unsigned int bufferSize);
 
+/**
+ * \brief Sends as much of the given data as the socket accepts right away, without waiting for the peer.
+ *
+ * Under Windows, sending can't be made non-blocking for a single call : the data is sent as sendTo does.
+ *
+ * \param clientSocket The socket to send data through
+ * \param buffer A buffer containing the data to send
+ * \param bufferSize The size of the data to send
+ * \return the number of bytes sent, possibly less than bufferSize, SOCKET_WOULD_BLOCK if nothing could be sent or -1 if an error occurred
+*/
+int sendAvailable(Socket clientSocket, const char* buffer, unsigned int bufferSize);
+
+/**
+ * \brief Waits for data to be available on any of the given sockets.
+ *
+ * A closed connection or an error also counts as available data : the next receive reports it.
+ * Sockets which handle is SOCKET_INVALID_HANDLE are ignored.
+ *
+ * \param sockets The sockets to wait for
+ * \param count The amount of sockets
+ * \param ready An array of count flags, set to 1 for each socket with available data. Can be NULL
+ * \param timeoutMillis The maximum time to wait (milliseconds), 0 to return at once or -1 to wait forever
+ * \return the amount of sockets with available data, 0 if the delay expired or -1 if an error occurred
+*/
+int waitForData(const Socket* sockets, unsigned int count, char* ready, int timeoutMillis);
+
+/**
+ * \brief Shuts down both directions of the given socket without releasing it.
+ *
+ * Any thread blocked receiving on this socket is woken up and sees the connection as closed.
+ * The socket MUST still be closed using closeSocket afterwards.
+ *
+ * \param socket The socket to shut down
+*/
+void shutdownSocket(Socket socket);
+
 /**
  * \brief Closes the given socket.
  * 
@@ -0,0 +1,66 @@
+#include "spsc-queue.h"
+#include <stdlib.h>
+
+/**
+ * \brief Rounds the given number up to a power of 2.
+ */
+unsigned int spsc_roundCapacity(unsigned int capacity) {
+    unsigned int rounded = 2;
+    while (rounded < capacity) {
+        rounded <<= 1;
+    }
+    return rounded;
+}
+
+SpscQueue* spsc_create(unsigned int capacity) {
+    capacity = spsc_roundCapacity(capacity);
+
+    SpscQueue* queue = malloc(sizeof(SpscQueue));
+    queue->slots = malloc(sizeof(void*) * capacity);
+    queue->mask = capacity - 1;
+    queue->head = 0;
+    queue->cachedTail = 0;
+    queue->tail = 0;
+    queue->cachedHead = 0;
+
+    return queue;
+}
+
+void spsc_destroy(SpscQueue* queue) {
+    free(queue->slots);
+    free(queue);
+}
+
+int spsc_push(SpscQueue* queue, void* item) {
+    unsigned int tail = queue->tail;
+    if (tail - queue->cachedHead > queue->mask) {
+        queue->cachedHead = atomics_load(&queue->head);
+        if (tail - queue->cachedHead > queue->mask) {
+            return 0;
+        }
+    }
+
+    queue->slots[tail & queue->mask] = item;
+    /* Publishes the item to the consumer */
+    atomics_store(&queue->tail, tail + 1);
+    return 1;
+}
+
+void* spsc_pop(SpscQueue* queue) {
+    unsigned int head = queue->head;
+    if (head == queue->cachedTail) {
+        queue->cachedTail = atomics_load(&queue->tail);
+        if (head == queue->cachedTail) {
+            return NULL;
+        }
+    }
+
+    void* item = queue->slots[head & queue->mask];
+    /* Gives the slot back to the producer */
+    atomics_store(&queue->head, head + 1);
+    return item;
+}
+
+int spsc_isEmpty(SpscQueue* queue) {
+    return queue->head == atomics_load(&queue->tail);
+}
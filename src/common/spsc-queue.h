@@ -0,0 +1,81 @@
+/**
+ * \file spsc-queue.h
+ * \brief A bounded lock-free queue for a single producer thread and a single consumer thread.
+ *
+ * Items are pointers stored in a ring buffer. Pushing and popping never block and never take
+ * a lock : when the queue is full, pushing fails and the producer decides what to do.
+ * The producer and the consumer work on different cache lines, each keeping a copy of the
+ * other index to read the shared one only when the ring looks full or empty.
+ *
+ * Pair it with a Notifier (see notifier.h) to let the consumer sleep while the queue is empty.
+ */
+
+#ifndef C_CHAT_SPSC_QUEUE_H
+#define C_CHAT_SPSC_QUEUE_H
+
+#include "atomics.h"
+
+/**
+ * \class SpscQueue
+ * \brief A bounded single-producer single-consumer queue
+ */
+typedef struct SpscQueue {
+    void** slots;
+    /** Capacity - 1, the capacity being a power of 2 */
+    unsigned int mask;
+    char padding0[ATOMICS_CACHE_LINE];
+
+    /** Index of the next slot to pop, written by the consumer */
+    volatile unsigned int head;
+    /** Last tail read by the consumer */
+    unsigned int cachedTail;
+    char padding1[ATOMICS_CACHE_LINE];
+
+    /** Index of the next slot to push, written by the producer */
+    volatile unsigned int tail;
+    /** Last head read by the producer */
+    unsigned int cachedHead;
+    char padding2[ATOMICS_CACHE_LINE];
+} SpscQueue;
+
+/**
+ * \brief Creates a queue.
+ *
+ * \param capacity The minimum amount of items the queue can hold, rounded up to a power of 2
+ * \return a heap-allocated queue, to be destroyed using spsc_destroy
+ */
+SpscQueue* spsc_create(unsigned int capacity);
+
+/**
+ * \brief Destroys the given queue. Items still queued are NOT freed.
+ *
+ * \param queue The queue to destroy
+ */
+void spsc_destroy(SpscQueue* queue);
+
+/**
+ * \brief Pushes an item at the end of the queue. Called by the producer only.
+ *
+ * \param queue The queue to push to
+ * \param item The item to push
+ * \return 1 if the item was pushed, 0 if the queue is full
+ */
+int spsc_push(SpscQueue* queue, void* item);
+
+/**
+ * \brief Pops the item at the front of the queue. Called by the consumer only.
+ *
+ * \param queue The queue to pop from
+ * \return the popped item or NULL if the queue is empty
+ */
+void* spsc_pop(SpscQueue* queue);
+
+/**
+ * \brief Checks whether the queue is empty. Called by the consumer only.
+ *
+ * \param queue The queue to check
+ * \return 1 if the queue is empty, else 0
+ */
+int spsc_isEmpty(SpscQueue* queue);
+
+#endif //C_CHAT_SPSC_QUEUE_H
@@ -2,85 +2,162 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "interop.h"
+#include "adaptive-lock.h"
+
+/**
+ * \brief State of a read/write lock
+ *
+ * Adaptive locks are used as critical sections are short, and as the write lock is released by
+ * the last reader, which may not be the thread which acquired it.
+ */
+struct ReadWriteLockState {
+    AdaptiveLock writeLock;
+    AdaptiveLock readLock;
+    int readCount;
+};
 
 ReadWriteLock createReadWriteLock() {
+    struct ReadWriteLockState* state = malloc(sizeof(struct ReadWriteLockState));
+    adaptiveLock_init(&(state->writeLock));
+    adaptiveLock_init(&(state->readLock));
+    state->readCount = 0;
+
     ReadWriteLock lock;
-    lock.readCount = malloc(sizeof(int));
-    *(lock.readCount) = 0;
-    lock.readLock = createMutex();
-    lock.writeLock = createMutex();
+    lock.info = state;
 
     return lock;
 }
 
 void acquireRead(ReadWriteLock lock) {
-    acquireMutex(lock.readLock);
-    (*(lock.readCount))++;
+    struct ReadWriteLockState* state = lock.info;
+    adaptiveLock_acquire(&(state->readLock));
+    state->readCount++;
 
-    if (*(lock.readCount) == 1) {
-        acquireMutex(lock.writeLock);
+    if (state->readCount == 1) {
+        adaptiveLock_acquire(&(state->writeLock));
     }
 
-    releaseMutex(lock.readLock);
+    adaptiveLock_release(&(state->readLock));
 }
 
 void releaseRead(ReadWriteLock lock) {
-    acquireMutex(lock.readLock);
-    (*(lock.readCount))--;
+    struct ReadWriteLockState* state = lock.info;
+    adaptiveLock_acquire(&(state->readLock));
+    state->readCount--;
 
-    if (*(lock.readCount) == 0) {
-        releaseMutex(lock.writeLock);
+    if (state->readCount == 0) {
+        adaptiveLock_release(&(state->writeLock));
     }
 
-    releaseMutex(lock.readLock);
+    adaptiveLock_release(&(state->readLock));
 }
 
 void acquireWrite(ReadWriteLock lock) {
-    acquireMutex(lock.writeLock);
+    struct ReadWriteLockState* state = lock.info;
+    adaptiveLock_acquire(&(state->writeLock));
 }
 
 void releaseWrite(ReadWriteLock lock) {
-    releaseMutex(lock.writeLock);
+    struct ReadWriteLockState* state = lock.info;
+    adaptiveLock_release(&(state->writeLock));
 }
 
 void destroyReadWriteLock(ReadWriteLock lock) {
-    destroyMutex(lock.readLock);
-    destroyMutex(lock.writeLock);
-    free(lock.readCount);
+    free(lock.info);
 }
 
 #if IS_POSIX
 
     #include <pthread.h>
+    #include <time.h>
+    #include <errno.h>
+
+    void initMutex(Mutex* mutex) {
+        pthread_mutex_init(&(mutex->lock), NULL);
+    }
+
+    void acquireMutex(Mutex* mutex) {
+        pthread_mutex_lock(&(mutex->lock));
+    }
+
+    int tryAcquireMutex(Mutex* mutex) {
+        return pthread_mutex_trylock(&(mutex->lock)) == 0;
+    }
 
-    struct UnixMutex {
+    void releaseMutex(Mutex* mutex) {
+        pthread_mutex_unlock(&(mutex->lock));
+    }
+
+    void destroyMutex(Mutex* mutex) {
+        pthread_mutex_destroy(&(mutex->lock));
+    }
+
+    struct UnixEvent {
         pthread_mutex_t mutex;
+        pthread_cond_t condition;
+        int signaled;
     };
 
-    Mutex createMutex() {
-        struct UnixMutex* unixMutex = malloc(sizeof(struct UnixMutex));
-        pthread_mutex_init(&(unixMutex->mutex), NULL);
+    Event createEvent() {
+        struct UnixEvent* unixEvent = malloc(sizeof(struct UnixEvent));
+        pthread_mutex_init(&(unixEvent->mutex), NULL);
+        pthread_cond_init(&(unixEvent->condition), NULL);
+        unixEvent->signaled = 0;
 
-        Mutex m;
-        m.info = unixMutex;
+        Event e;
+        e.info = unixEvent;
 
-        return m;
+        return e;
     }
 
-    void acquireMutex(Mutex mutex) {
-        struct UnixMutex* unixMutex = mutex.info;
-        pthread_mutex_lock(&(unixMutex->mutex));
+    void signalEvent(Event event) {
+        struct UnixEvent* unixEvent = event.info;
+        pthread_mutex_lock(&(unixEvent->mutex));
+        unixEvent->signaled = 1;
+        pthread_cond_signal(&(unixEvent->condition));
+        pthread_mutex_unlock(&(unixEvent->mutex));
     }
 
-    void releaseMutex(Mutex mutex) {
-        struct UnixMutex* unixMutex = mutex.info;
-        pthread_mutex_unlock(&(unixMutex->mutex));
+    void waitEvent(Event event) {
+        struct UnixEvent* unixEvent = event.info;
+        pthread_mutex_lock(&(unixEvent->mutex));
+        while (!unixEvent->signaled) {
+            pthread_cond_wait(&(unixEvent->condition), &(unixEvent->mutex));
+        }
+        unixEvent->signaled = 0;
+        pthread_mutex_unlock(&(unixEvent->mutex));
     }
 
-    void destroyMutex(Mutex mutex) {
-        struct UnixMutex* unixMutex = mutex.info;
-        pthread_mutex_destroy(&(unixMutex->mutex));
-        free(unixMutex);
+    int waitEventFor(Event event, unsigned int milliseconds) {
+        struct UnixEvent* unixEvent = event.info;
+
+        /* Condition variables wait until a time of the realtime clock */
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += milliseconds / 1000;
+        deadline.tv_nsec += (long) (milliseconds % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        pthread_mutex_lock(&(unixEvent->mutex));
+        while (!unixEvent->signaled) {
+            if (pthread_cond_timedwait(&(unixEvent->condition), &(unixEvent->mutex), &deadline) == ETIMEDOUT) {
+                break;
+            }
+        }
+        int signaled = unixEvent->signaled;
+        unixEvent->signaled = 0;
+        pthread_mutex_unlock(&(unixEvent->mutex));
+        return signaled;
+    }
+
+    void destroyEvent(Event event) {
+        struct UnixEvent* unixEvent = event.info;
+        pthread_cond_destroy(&(unixEvent->condition));
+        pthread_mutex_destroy(&(unixEvent->mutex));
+        free(unixEvent);
     }
 
 
@@ -91,40 +168,66 @@ void destroyReadWriteLock(ReadWriteLock lock) {
     #include <windows.h>
     #endif
 
-    struct WinMutex {
+    /* Slim reader/writer locks, unlike mutex objects, live in process memory and need no release */
+
+    void initMutex(Mutex* mutex) {
+        InitializeSRWLock(&(mutex->lock));
+    }
+
+    void acquireMutex(Mutex* mutex) {
+        AcquireSRWLockExclusive(&(mutex->lock));
+    }
+
+    int tryAcquireMutex(Mutex* mutex) {
+        return TryAcquireSRWLockExclusive(&(mutex->lock)) != 0;
+    }
+
+    void releaseMutex(Mutex* mutex) {
+        ReleaseSRWLockExclusive(&(mutex->lock));
+    }
+
+    void destroyMutex(Mutex* mutex) {}
+
+    struct WinEvent {
         HANDLE handle;
     };
 
-    Mutex createMutex() {
-        HANDLE mutex = CreateMutex(NULL, FALSE, NULL);
-        if (mutex == NULL) {
-            printf("Unable to create mutex. Error code : %ld\n", GetLastError());
+    Event createEvent() {
+        /* An auto-reset event wakes up a single thread and resets itself */
+        HANDLE event = CreateEvent(NULL, FALSE, FALSE, NULL);
+        if (event == NULL) {
+            printf("Unable to create event. Error code : %ld\n", GetLastError());
             exit(EXIT_FAILURE);
         }
 
-        struct WinMutex* winMutex = malloc(sizeof(struct WinMutex));
-        winMutex->handle = mutex;
+        struct WinEvent* winEvent = malloc(sizeof(struct WinEvent));
+        winEvent->handle = event;
+
+        Event e;
+        e.info = winEvent;
 
-        Mutex m;
-        m.info = winMutex;
+        return e;
+    }
 
-        return m;
+    void signalEvent(Event event) {
+        struct WinEvent* winEvent = event.info;
+        SetEvent(winEvent->handle);
     }
 
-    void acquireMutex(Mutex mutex) {
-        struct WinMutex* winMutex = mutex.info;
-        WaitForSingleObject(winMutex->handle, INFINITE);
+    void waitEvent(Event event) {
+        struct WinEvent* winEvent = event.info;
+        WaitForSingleObject(winEvent->handle, INFINITE);
     }
 
-    void releaseMutex(Mutex mutex) {
-        struct WinMutex* winMutex = mutex.info;
-        ReleaseMutex(winMutex->handle);
+    int waitEventFor(Event event, unsigned int milliseconds) {
+        struct WinEvent* winEvent = event.info;
+        return WaitForSingleObject(winEvent->handle, milliseconds) == WAIT_OBJECT_0;
     }
 
-    void destroyMutex(Mutex mutex) {
-        struct WinMutex* winMutex = mutex.info;
-        CloseHandle(winMutex->handle);
-        free(winMutex);
+    void destroyEvent(Event event) {
+        struct WinEvent* winEvent = event.info;
+        CloseHandle(winEvent->handle);
+        free(winEvent);
     }
 
 #endif
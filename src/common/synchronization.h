@@ -6,12 +6,30 @@
 #ifndef C_CHAT_SYNCHRONIZATION_H
 #define C_CHAT_SYNCHRONIZATION_H
 
+#include "interop.h"
+
+#if IS_POSIX
+#include <pthread.h>
+#elif IS_WINDOWS
+#ifndef WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#define WIN32_LEAN_AND_MEAN
+#endif
+#endif
+
 /**
  * \class Mutex
  * \brief A semaphore allowing mutual exclusion.
+ *
+ * The OS lock is stored inline, so a mutex is meant to be embedded in the structure it protects.
+ * It MUST NOT be copied nor moved in memory once initialized, functions take a pointer to it.
  */
 typedef struct Mutex {
-    void* info;
+#if IS_POSIX
+    pthread_mutex_t lock;
+#elif IS_WINDOWS
+    SRWLOCK lock;
+#endif
 } Mutex;
 
 /**
@@ -19,17 +37,26 @@ typedef struct Mutex {
  * \brief A read/write lock to synchronize resource access.
  */
 typedef struct ReadWriteLock {
-    Mutex writeLock;
-    Mutex readLock;
-    int* readCount;
+    void* info;
 } ReadWriteLock;
 
 /**
- * \brief Creates a mutex.
+ * \class Event
+ * \brief A signal a thread can wait for.
  *
- * \return a ready to use mutex
+ * The event stays signaled until a single waiting thread is woken up, so a signal sent
+ * while no thread is waiting isn't lost.
  */
-Mutex createMutex();
+typedef struct Event {
+    void* info;
+} Event;
+
+/**
+ * \brief Initializes a mutex.
+ *
+ * \param mutex The mutex to initialize
+ */
+void initMutex(Mutex* mutex);
 
 /**
  * \brief Acquires the given mutex.
@@ -40,7 +67,17 @@ Mutex createMutex();
  *
  * \param mutex The mutex to acquire
  */
-void acquireMutex(Mutex mutex);
+void acquireMutex(Mutex* mutex);
+
+/**
+ * \brief Acquires the given mutex if it's available.
+ *
+ * This is a non-blocking call.
+ *
+ * \param mutex The mutex to acquire
+ * \return 1 if the mutex was acquired, else 0
+ */
+int tryAcquireMutex(Mutex* mutex);
 
 /**
  * \brief Releases the given mutex.
@@ -49,7 +86,7 @@ void acquireMutex(Mutex mutex);
  *
  * \param mutex The mutex to release
  */
-void releaseMutex(Mutex mutex);
+void releaseMutex(Mutex* mutex);
 
 /**
  * \brief Destroys the given mutex.
@@ -58,7 +95,53 @@ void releaseMutex(Mutex mutex);
  *
  * \param mutex The mutex to destroy
  */
-void destroyMutex(Mutex mutex);
+void destroyMutex(Mutex* mutex);
+
+/**
+ * \brief Creates an event, initially not signaled.
+ *
+ * \return a ready to use event
+ */
+Event createEvent();
+
+/**
+ * \brief Signals the given event, waking up one waiting thread.
+ *
+ * If no thread is waiting, the next thread calling waitEvent returns immediately.
+ * Signaling an already signaled event has no effect.
+ *
+ * \param event The event to signal
+ */
+void signalEvent(Event event);
+
+/**
+ * \brief Waits for the given event to be signaled, then resets it.
+ *
+ * This is a blocking call.
+ *
+ * \param event The event to wait for
+ */
+void waitEvent(Event event);
+
+/**
+ * \brief Waits for the given event to be signaled during at most the given delay, then resets it.
+ *
+ * This is a blocking call.
+ *
+ * \param event The event to wait for
+ * \param milliseconds The maximum time to wait
+ * \return 1 if the event was signaled, 0 if the delay expired
+ */
+int waitEventFor(Event event, unsigned int milliseconds);
+
+/**
+ * \brief Destroys the given event.
+ *
+ * No thread must be waiting for the event anymore.
+ *
+ * \param event The event to destroy
+ */
+void destroyEvent(Event event);
 
 /**
  * \brief Creates a read/write lock.
@@ -6,39 +6,43 @@
 #if IS_POSIX
 
 #include <pthread.h>
-
-struct PosixThread {
-    pthread_t id;
-};
+#include <time.h>
 
 Thread createThread(THREAD_FUNCTION_POINTER entryPoint, void* data) {
-    pthread_t tId;
-    pthread_create(&tId, 0, entryPoint, data);
-
-    struct PosixThread *posixThread = malloc(sizeof(struct PosixThread));
-    posixThread->id = tId;
-
     Thread t;
-    t.info = posixThread;
+    pthread_create(&t.id, 0, entryPoint, data);
+    t.running = 1;
 
     return t;
 }
 
 void joinThread(Thread* thread) {
-    struct PosixThread *posixThread = thread->info;
-    pthread_join(posixThread->id, 0);
-    destroyThread(thread);
+    pthread_join(thread->id, 0);
+    /* The thread is over, it must not be canceled */
+    thread->running = 0;
 }
 
 void destroyThread(Thread* thread) {
-    struct PosixThread *posixThread = thread->info;
-    if (posixThread != NULL) {
-        pthread_cancel(posixThread->id);
-        free(posixThread);
-        thread->info = NULL;
+    if (thread->running) {
+        pthread_cancel(thread->id);
+        thread->running = 0;
     }
 }
 
+void detachThread(Thread* thread) {
+    if (thread->running) {
+        pthread_detach(thread->id);
+        thread->running = 0;
+    }
+}
+
+void threadSleep(unsigned int milliseconds) {
+    struct timespec duration;
+    duration.tv_sec = milliseconds / 1000;
+    duration.tv_nsec = (long) (milliseconds % 1000) * 1000000L;
+    nanosleep(&duration, NULL);
+}
+
 #elif IS_WINDOWS
 
 #ifndef WIN32_LEAN_AND_MEAN
@@ -49,11 +53,6 @@ void destroyThread(Thread* thread) {
 #define THREAD_RETURN_TYPE DWORD
 #define THREAD_CALL_TYPE WINAPI
 
-struct WinThread {
-    DWORD id;
-    HANDLE handle;
-};
-
 Thread createThread(THREAD_FUNCTION_POINTER entryPoint, void* data) {
     DWORD threadId;
     HANDLE threadHandle = CreateThread(NULL, 0, entryPoint, data, 0, &threadId);
@@ -62,29 +61,32 @@ Thread createThread(THREAD_FUNCTION_POINTER entryPoint, void* data) {
         exit(EXIT_FAILURE);
     }
 
-    struct WinThread *winThread = malloc(sizeof(struct WinThread));
-    winThread->id = threadId;
-    winThread->handle = threadHandle;
-
     struct Thread thread;
-    thread.info = winThread;
+    thread.id = threadId;
+    thread.handle = threadHandle;
 
     return thread;
 }
 
 void destroyThread(Thread* thread) {
-    struct WinThread *t = thread->info;
-    if (t != NULL) {
-        CloseHandle(t->handle);
-        free(t);
-        thread->info = NULL;
+    if (thread->handle != NULL) {
+        CloseHandle(thread->handle);
+        thread->handle = NULL;
     }
 }
 
 void joinThread(Thread* thread) {
-    struct WinThread *t = thread->info;
-    WaitForSingleObject(t->handle, INFINITE);
+    WaitForSingleObject(thread->handle, INFINITE);
+    destroyThread(thread);
+}
+
+void detachThread(Thread* thread) {
+    /* Closing the handle doesn't stop the thread, its resources are released once it finishes */
     destroyThread(thread);
 }
 
+void threadSleep(unsigned int milliseconds) {
+    Sleep(milliseconds);
+}
+
 #endif
\ No newline at end of file
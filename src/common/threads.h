@@ -8,6 +8,8 @@
 
 #if defined(__unix__) || defined(__unix) || defined(unix) || defined(__APPLE__) || defined(__linux__)
 
+#include <pthread.h>
+
 #define THREAD_RETURN_TYPE void*
 #define THREAD_CALL_TYPE
 
@@ -39,11 +41,21 @@ typedef FP_THREAD THREAD_FUNCTION_POINTER;
  * \struct Thread
  * \brief Represents a thread
  *
- * Underlying information are OS-specifics
+ * The OS handle is stored inline : underlying information are OS-specifics
  */
+#if defined(__unix__) || defined(__unix) || defined(unix) || defined(__APPLE__) || defined(__linux__)
+typedef struct Thread {
+    pthread_t id;
+    /** Equal to 1 until the thread is joined or destroyed, else 0 */
+    int running;
+} Thread;
+#elif defined(_WIN32) || defined(_WIN64) || defined(_WINDOWS)
 typedef struct Thread {
-    void* info;
+    /** NULL once the thread is joined or destroyed */
+    HANDLE handle;
+    DWORD id;
 } Thread;
+#endif
 
 /**
  * \brief Creates and starts a thread.
@@ -76,4 +88,20 @@ void destroyThread(Thread* thread);
  */
 void joinThread(Thread* thread);
 
+/**
+ * \brief Lets the given thread release its resources by itself once it finishes.
+ *
+ * The thread can't be joined nor destroyed afterwards. A thread can detach itself.
+ *
+ * \param thread A pointer to the thread to detach
+ */
+void detachThread(Thread* thread);
+
+/**
+ * \brief Suspends the calling thread for the given duration.
+ *
+ * \param milliseconds The minimum duration to sleep for
+ */
+void threadSleep(unsigned int milliseconds);
+
 #endif //C_CHAT_THREADS_H
@@ -0,0 +1,29 @@
+#include "throttle.h"
+#include "threads.h"
+
+void throttle_init(Throttle* throttle, unsigned long long bytesPerSecond, unsigned long long burstBytes) {
+    adaptiveLock_init(&throttle->lock);
+    tokenBucket_init(&throttle->bucket, bytesPerSecond, burstBytes);
+}
+
+void throttle_wait(Throttle* throttle, unsigned long long bytes) {
+    if (throttle->bucket.rate == 0) {
+        return;
+    }
+
+    while (1) {
+        adaptiveLock_acquire(&throttle->lock);
+        unsigned long long delay = tokenBucket_delayFor(&throttle->bucket, bytes);
+        if (delay == 0) {
+            tokenBucket_tryConsume(&throttle->bucket, bytes);
+        }
+        adaptiveLock_release(&throttle->lock);
+
+        if (delay == 0) {
+            return;
+        }
+
+        /* Other threads may take the bytes meanwhile : checking again once awake */
+        threadSleep((unsigned int) delay);
+    }
+}
@@ -0,0 +1,47 @@
+/**
+ * \file throttle.h
+ * \brief Limits the bandwidth of file transfers.
+ *
+ * A throttle is a token bucket of bytes shared by several threads : sending threads wait for
+ * their chunk to be allowed before queuing it. Only threads dedicated to transfers wait, so the
+ * chat path is never slowed down, and the link isn't flooded with file data queued ahead of
+ * chat messages.
+ */
+
+#ifndef C_CHAT_THROTTLE_H
+#define C_CHAT_THROTTLE_H
+
+#include "token-bucket.h"
+#include "adaptive-lock.h"
+
+/**
+ * \class Throttle
+ * \brief A token bucket of bytes, synchronized
+ */
+typedef struct Throttle {
+    /** Protects bucket */
+    AdaptiveLock lock;
+    /** Tokens are bytes, the rate is 0 if unlimited */
+    TokenBucket bucket;
+} Throttle;
+
+/**
+ * \brief Initializes a throttle.
+ *
+ * \param throttle The throttle to initialize
+ * \param bytesPerSecond The sustained bandwidth, 0 not to limit it
+ * \param burstBytes The amount of bytes which can be sent at once, at least a chunk
+ */
+void throttle_init(Throttle* throttle, unsigned long long bytesPerSecond, unsigned long long burstBytes);
+
+/**
+ * \brief Waits until the given amount of bytes can be sent, then consumes them.
+ *
+ * This is a blocking call.
+ *
+ * \param throttle The throttle to consume bytes from
+ * \param bytes The amount of bytes to send (MUST NOT be greater than the burst)
+ */
+void throttle_wait(Throttle* throttle, unsigned long long bytes);
+
+#endif //C_CHAT_THROTTLE_H
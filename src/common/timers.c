@@ -0,0 +1,169 @@
+#include "timers.h"
+#include <stdlib.h>
+#include "interop.h"
+#include "threads.h"
+
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+
+#if IS_POSIX
+
+#include <time.h>
+
+unsigned long long timers_now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long) now.tv_sec * 1000ULL + (unsigned long long) now.tv_nsec / 1000000ULL;
+}
+
+unsigned long long timers_nowMicros() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long) now.tv_sec * 1000000ULL + (unsigned long long) now.tv_nsec / 1000ULL;
+}
+
+#elif IS_WINDOWS
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+unsigned long long timers_now() {
+    return (unsigned long long) GetTickCount64();
+}
+
+unsigned long long timers_nowMicros() {
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (unsigned long long) (counter.QuadPart / frequency.QuadPart) * 1000000ULL
+        + (unsigned long long) (counter.QuadPart % frequency.QuadPart) * 1000000ULL / frequency.QuadPart;
+}
+
+#endif
+
+TimerWheel* timers_createWheel(unsigned int tickMillis) {
+    TimerWheel* wheel = malloc(sizeof(TimerWheel));
+    for (int i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+        wheel->slots[i] = NULL;
+    }
+    wheel->tickMillis = tickMillis;
+    wheel->currentTick = timers_now() / tickMillis;
+    wheel->running = NULL;
+    adaptiveLock_init(&wheel->lock);
+    return wheel;
+}
+
+void timers_destroyWheel(TimerWheel* wheel) {
+    free(wheel);
+}
+
+void timers_init(Timer* timer, TIMER_CALLBACK callback, void* data) {
+    timer->callback = callback;
+    timer->data = data;
+    timer->expirationTick = 0;
+    timer->next = NULL;
+    timer->prev = NULL;
+    timer->armed = 0;
+}
+
+/**
+ * \brief Removes the given timer from its slot. The wheel lock MUST be held.
+ */
+void timers_unlink(TimerWheel* wheel, Timer* timer) {
+    if (timer->prev != NULL) {
+        timer->prev->next = timer->next;
+    } else {
+        wheel->slots[timer->expirationTick & TIMER_WHEEL_MASK] = timer->next;
+    }
+    if (timer->next != NULL) {
+        timer->next->prev = timer->prev;
+    }
+    timer->next = NULL;
+    timer->prev = NULL;
+    timer->armed = 0;
+}
+
+void timers_arm(TimerWheel* wheel, Timer* timer, unsigned long long delayMillis) {
+    unsigned long long expirationTick = (timers_now() + delayMillis + wheel->tickMillis - 1) / wheel->tickMillis;
+
+    adaptiveLock_acquire(&wheel->lock);
+    if (timer->armed) {
+        timers_unlink(wheel, timer);
+    }
+
+    /* Never hash a timer in a slot already processed for this turn */
+    if (expirationTick <= wheel->currentTick) {
+        expirationTick = wheel->currentTick + 1;
+    }
+
+    Timer** slot = &wheel->slots[expirationTick & TIMER_WHEEL_MASK];
+    timer->expirationTick = expirationTick;
+    timer->prev = NULL;
+    timer->next = *slot;
+    if (*slot != NULL) {
+        (*slot)->prev = timer;
+    }
+    *slot = timer;
+    timer->armed = 1;
+    adaptiveLock_release(&wheel->lock);
+}
+
+int timers_cancel(TimerWheel* wheel, Timer* timer) {
+    adaptiveLock_acquire(&wheel->lock);
+    int wasArmed = timer->armed;
+
+    /* Wait for the callback to return if it's being run */
+    while (wheel->running == timer) {
+        adaptiveLock_release(&wheel->lock);
+        threadSleep(1);
+        adaptiveLock_acquire(&wheel->lock);
+    }
+
+    /* The callback may have re-armed the timer */
+    if (timer->armed) {
+        timers_unlink(wheel, timer);
+    }
+    adaptiveLock_release(&wheel->lock);
+
+    return wasArmed;
+}
+
+void timers_advance(TimerWheel* wheel, unsigned long long nowMillis) {
+    unsigned long long targetTick = nowMillis / wheel->tickMillis;
+
+    adaptiveLock_acquire(&wheel->lock);
+
+    /* After a long pause, visiting each slot once is enough to find all expired timers */
+    if (targetTick > wheel->currentTick + TIMER_WHEEL_SLOTS) {
+        wheel->currentTick = targetTick - TIMER_WHEEL_SLOTS;
+    }
+
+    while (wheel->currentTick < targetTick) {
+        wheel->currentTick++;
+        unsigned int slot = wheel->currentTick & TIMER_WHEEL_MASK;
+
+        Timer* timer = wheel->slots[slot];
+        while (timer != NULL) {
+            if (timer->expirationTick > wheel->currentTick) {
+                /* Expires in a later turn of the wheel */
+                timer = timer->next;
+                continue;
+            }
+
+            timers_unlink(wheel, timer);
+            wheel->running = timer;
+            adaptiveLock_release(&wheel->lock);
+
+            timer->callback(timer, timer->data);
+
+            adaptiveLock_acquire(&wheel->lock);
+            wheel->running = NULL;
+
+            /* The slot may have been modified while the lock was released */
+            timer = wheel->slots[slot];
+        }
+    }
+
+    adaptiveLock_release(&wheel->lock);
+}
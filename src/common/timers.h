@@ -0,0 +1,146 @@
+/**
+ * \file timers.h
+ * \brief A hashed timer wheel to run callbacks once a delay expired.
+ *
+ * Timers are hashed into the slots of a wheel according to their expiration tick.
+ * Arming and canceling a timer are O(1) operations, and advancing the wheel only visits
+ * the slots matching the elapsed ticks. A timer which expires more than a full turn of
+ * the wheel ahead simply stays in its slot until the right turn comes.
+ *
+ * A wheel can be shared between threads : timers can be armed and canceled from any thread,
+ * and callbacks are run by the thread calling timers_advance.
+ */
+
+#ifndef C_CHAT_TIMERS_H
+#define C_CHAT_TIMERS_H
+
+#include "adaptive-lock.h"
+
+/**
+ * \def TIMER_WHEEL_SLOTS
+ * \brief The number of slots of a timer wheel (MUST be a power of 2)
+ */
+#define TIMER_WHEEL_SLOTS 512
+
+struct Timer;
+
+/**
+ * \brief The type of a function called when a timer expires.
+ *
+ * The timer is no longer armed when its callback is called, it can be re-armed
+ * from the callback to run a periodic task.
+ */
+typedef void (*TIMER_CALLBACK)(struct Timer* timer, void* data);
+
+/**
+ * \class Timer
+ * \brief A timer that can be armed in a timer wheel.
+ *
+ * The memory of a timer is owned by the caller (it's usually embedded in another structure).
+ */
+typedef struct Timer {
+    /** The function to call on expiration */
+    TIMER_CALLBACK callback;
+    /** The pointer passed to the callback */
+    void* data;
+    /** The wheel tick this timer expires on */
+    unsigned long long expirationTick;
+    /** Links in the slot list. prev is NULL for the head of the list */
+    struct Timer* next;
+    struct Timer* prev;
+    /** Equal to 1 if the timer is currently in a wheel slot, else 0 */
+    short armed;
+} Timer;
+
+/**
+ * \class TimerWheel
+ * \brief A wheel of timers.
+ */
+typedef struct TimerWheel {
+    Timer* slots[TIMER_WHEEL_SLOTS];
+    /** Duration of a tick in milliseconds */
+    unsigned int tickMillis;
+    /** The last tick processed by timers_advance */
+    unsigned long long currentTick;
+    /** The timer which callback is being run, NULL if none */
+    Timer* running;
+    AdaptiveLock lock;
+} TimerWheel;
+
+/**
+ * \brief Retrieves the current time of a monotonic clock.
+ *
+ * \return a number of milliseconds elapsed since an unspecified point in the past
+ */
+unsigned long long timers_now();
+
+/**
+ * \brief Retrieves the current time of a monotonic clock with a microsecond resolution.
+ *
+ * \return a number of microseconds elapsed since an unspecified point in the past
+ */
+unsigned long long timers_nowMicros();
+
+/**
+ * \brief Creates a timer wheel.
+ *
+ * \param tickMillis The resolution of the wheel in milliseconds
+ * \return a heap-allocated timer wheel, to be destroyed using timers_destroyWheel
+ */
+TimerWheel* timers_createWheel(unsigned int tickMillis);
+
+/**
+ * \brief Destroys the given timer wheel.
+ *
+ * Timers still armed in the wheel are NOT called.
+ *
+ * \param wheel The wheel to destroy
+ */
+void timers_destroyWheel(TimerWheel* wheel);
+
+/**
+ * \brief Initializes a timer. MUST be called before any other operation on the timer.
+ *
+ * \param timer The timer to initialize
+ * \param callback The function to call on expiration
+ * \param data The pointer to pass to the callback
+ */
+void timers_init(Timer* timer, TIMER_CALLBACK callback, void* data);
+
+/**
+ * \brief Arms the given timer to expire after the given delay.
+ *
+ * If the timer is already armed, its expiration is moved.
+ *
+ * \param wheel The wheel to arm the timer in
+ * \param timer The timer to arm
+ * \param delayMillis The delay before expiration, rounded up to the wheel resolution
+ */
+void timers_arm(TimerWheel* wheel, Timer* timer, unsigned long long delayMillis);
+
+/**
+ * \brief Cancels the given timer.
+ *
+ * If the callback of the timer is being run, this call waits for it to return. Once this
+ * function returns, the callback won't be called anymore (unless the timer is re-armed), so
+ * the memory it uses can be released.
+ *
+ * WARNING : This function MUST NOT be called from the callback of the timer itself.
+ *
+ * \param wheel The wheel the timer was armed in
+ * \param timer The timer to cancel
+ * \return 1 if the timer was armed, else 0
+ */
+int timers_cancel(TimerWheel* wheel, Timer* timer);
+
+/**
+ * \brief Runs callbacks of all timers that expired at the given time.
+ *
+ * Callbacks are run on the calling thread, without holding the wheel lock.
+ *
+ * \param wheel The wheel to advance
+ * \param nowMillis The current time, as returned by timers_now
+ */
+void timers_advance(TimerWheel* wheel, unsigned long long nowMillis);
+
+#endif //C_CHAT_TIMERS_H
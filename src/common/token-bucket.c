@@ -0,0 +1,45 @@
+#include "token-bucket.h"
+#include "timers.h"
+
+void tokenBucket_init(TokenBucket* bucket, unsigned long long rate, unsigned long long capacity) {
+    bucket->rate = rate;
+    bucket->capacity = capacity;
+    bucket->milliTokens = capacity * 1000;
+    bucket->lastRefill = timers_now();
+}
+
+/**
+ * \brief Adds the tokens earned since the last refill.
+ */
+void tokenBucket_refill(TokenBucket* bucket) {
+    unsigned long long now = timers_now();
+    unsigned long long elapsed = now - bucket->lastRefill;
+    if (elapsed == 0) {
+        return;
+    }
+
+    /* A second is 1000 milliseconds, and a token 1000 milli-tokens */
+    bucket->milliTokens += elapsed * bucket->rate;
+    if (bucket->milliTokens > bucket->capacity * 1000) {
+        bucket->milliTokens = bucket->capacity * 1000;
+    }
+    bucket->lastRefill = now;
+}
+
+int tokenBucket_tryConsume(TokenBucket* bucket, unsigned long long amount) {
+    tokenBucket_refill(bucket);
+    if (bucket->milliTokens < amount * 1000) {
+        return 0;
+    }
+    bucket->milliTokens -= amount * 1000;
+    return 1;
+}
+
+unsigned long long tokenBucket_delayFor(TokenBucket* bucket, unsigned long long amount) {
+    tokenBucket_refill(bucket);
+    if (bucket->milliTokens >= amount * 1000) {
+        return 0;
+    }
+    unsigned long long missing = amount * 1000 - bucket->milliTokens;
+    return (missing + bucket->rate - 1) / bucket->rate;
+}
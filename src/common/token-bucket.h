@@ -0,0 +1,56 @@
+/**
+ * \file token-bucket.h
+ * \brief A token bucket to limit the rate of an operation.
+ *
+ * Tokens are added to the bucket at a constant rate, up to its capacity. Each operation consumes
+ * tokens, so the capacity defines the allowed burst and the rate defines the sustained throughput.
+ *
+ * A token bucket is not synchronized : it's meant to be used by a single thread.
+ */
+
+#ifndef C_CHAT_TOKEN_BUCKET_H
+#define C_CHAT_TOKEN_BUCKET_H
+
+/**
+ * \class TokenBucket
+ * \brief State of a token bucket
+ */
+typedef struct TokenBucket {
+    /** Tokens added each second */
+    unsigned long long rate;
+    /** Maximum amount of tokens in the bucket */
+    unsigned long long capacity;
+    /** Available tokens, in thousandths of token to keep the precision of millisecond refills */
+    unsigned long long milliTokens;
+    /** Time of the last refill (see timers_now) */
+    unsigned long long lastRefill;
+} TokenBucket;
+
+/**
+ * \brief Initializes a full token bucket.
+ *
+ * \param bucket The bucket to initialize
+ * \param rate The amount of tokens added each second
+ * \param capacity The maximum amount of tokens in the bucket
+ */
+void tokenBucket_init(TokenBucket* bucket, unsigned long long rate, unsigned long long capacity);
+
+/**
+ * \brief Consumes the given amount of tokens if they're available.
+ *
+ * \param bucket The bucket to consume tokens from
+ * \param amount The amount of tokens to consume
+ * \return 1 if the tokens were consumed, else 0
+ */
+int tokenBucket_tryConsume(TokenBucket* bucket, unsigned long long amount);
+
+/**
+ * \brief Computes the time to wait before the given amount of tokens is available.
+ *
+ * \param bucket The bucket to get tokens from
+ * \param amount The amount of tokens wanted (MUST NOT be greater than the bucket capacity)
+ * \return a number of milliseconds, 0 if the tokens are already available
+ */
+unsigned long long tokenBucket_delayFor(TokenBucket* bucket, unsigned long long amount);
+
+#endif //C_CHAT_TOKEN_BUCKET_H
@@ -28,23 +28,14 @@ void handleUsernameChange(Client* client, struct PacketDefineUsername* packet) {
         setClientUsername(client, packet->username);
         getClientUsername(client, changedUsernamePacket.asUsernameChangedPacket.newUsername);
 
-        acquireRead(clientsLock);
-        Room* clientRoom = client->room;
-        if (clientRoom != NULL) {
-            acquireRead(clientRoom->lock);
-            releaseRead(clientsLock);
-
-            broadcastRoom(&changedUsernamePacket, clientRoom);
-
-            releaseRead(clientRoom->lock);
-        } else {
-            releaseRead(clientsLock);
-            sendPacket(client->socket, &changedUsernamePacket);
+        /* Outside of a room, only the client itself is told */
+        if (broadcastClientRoom(client, &changedUsernamePacket) != 1) {
+            sendToClient(client, &changedUsernamePacket);
         }
 
     } else {
         Packet serverErrorPacket = NewPacketServerErrorMessage;
         memcpy(serverErrorPacket.asServerErrorMessagePacket.message, "Invalid username", 17);
-        sendPacket(client->socket, &serverErrorPacket);
+        sendToClient(client, &serverErrorPacket);
     }
 }
\ No newline at end of file
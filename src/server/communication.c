@@ -1,29 +1,104 @@
 #include "communication.h"
 #include "client-info.h"
+#include "room-loop.h"
+#include "spectator.h"
 #include <stdlib.h>
 #include <string.h>
 
+int sendToClient(Client* client, Packet* packet) {
+    return outbound_send(&client->outbound, packet, OUTBOUND_PRIORITY_CONTROL);
+}
+
 void broadcast(Packet* packet) {
     SYNC_CLIENT_READ(
-        for (int i = 0; i < NUMBER_CLIENT_MAX; i++) {
+        for (int i = bitmap_next(clientSlots, NUMBER_CLIENT_MAX, 0); i != -1; i = bitmap_next(clientSlots, NUMBER_CLIENT_MAX, i + 1)) {
             Client *c = clients[i];
-            if (c != NULL && c->joined) {
-                sendPacket(c->socket, packet);
+            if (c != NULL && atomics_load(&c->joined)) {
+                sendToClient(c, packet);
             }
         }
     )
 }
 
+/**
+ * \brief Outbound paths and spectators a packet is sent to by another loop than the loop of the room
+ */
+struct FanOutBatch {
+    unsigned int count;
+    unsigned int spectatorCount;
+    /** Spectators of the lane, stored after the outbound paths */
+    Spectator** spectators;
+    Outbound* outbounds[];
+};
+
+/**
+ * \brief Sends the packet of the task to the outbound paths and spectators of the batch of the task. Run by the loop of the lane.
+ *
+ * The outbound paths and spectators are still valid : clients and spectators are only released
+ * once all loops were flushed after they left their room.
+ */
+void fanOut(RoomTask* task) {
+    struct FanOutBatch* batch = task->data;
+    outbound_sendToAll(batch->outbounds, batch->count, &task->packet);
+    spectator_sendToAll(batch->spectators, batch->spectatorCount, &task->packet);
+}
+
 void broadcastRoom(Packet* packet, Room* room) {
-    for (int i = 0; i < MAX_USERS_PER_ROOM; i++) {
-        if (room->clients[i] != NULL) {
-            sendPacket(room->clients[i]->socket, packet);
+    /* Other lanes are handed over to other loops, a copy of their members is taken as they may change meanwhile */
+    for (unsigned int i = 1; i < ROOM_LOOP_THREADS; i++) {
+        RoomLane* lane = &room->lanes[i];
+        if (lane->count + lane->spectatorCount == 0) {
+            continue;
         }
+
+        struct FanOutBatch* batch = malloc(sizeof(struct FanOutBatch)
+            + sizeof(Outbound*) * lane->count + sizeof(Spectator*) * lane->spectatorCount);
+        batch->count = lane->count;
+        batch->spectatorCount = lane->spectatorCount;
+        batch->spectators = (Spectator**) (batch->outbounds + lane->count);
+        memcpy(batch->outbounds, lane->outbounds, sizeof(Outbound*) * lane->count);
+        memcpy(batch->spectators, lane->spectators, sizeof(Spectator*) * lane->spectatorCount);
+
+        RoomTask* task = roomLoops_newTask(fanOut, NULL, NULL);
+        task->data = batch;
+        memcpy(&task->packet, packet, sizeof(Packet));
+        if (!roomLoops_postToLoop(room->loop + i, task)) {
+            /* That loop is overwhelmed, sending from this one instead even if packets may overtake each other */
+            outbound_sendToAll(lane->outbounds, lane->count, packet);
+            /* Only the loop of the lane writes to its spectators : they'd miss the packet, they're disconnected instead */
+            for (unsigned int j = 0; j < lane->spectatorCount; j++) {
+                shutdownSocket(lane->spectators[j]->socket);
+            }
+        }
+    }
+
+    outbound_sendToAll(room->lanes[0].outbounds, room->lanes[0].count, packet);
+    spectator_sendToAll(room->lanes[0].spectators, room->lanes[0].spectatorCount, packet);
+}
+
+/**
+ * \brief Relays the packet of the task to the members of the room of the task. Run by the room loop.
+ */
+void relayToRoom(RoomTask* task) {
+    if (!task->room->closed) {
+        broadcastRoom(&task->packet, task->room);
     }
 }
 
-void syncBroadcastRoom(Packet* packet, Room* room) {
-    SYNC_ROOM_READ(room, broadcastRoom(packet, room));
+int broadcastClientRoom(Client* client, Packet* packet) {
+    acquireRead(clientsLock);
+    Room* room = client->room;
+    if (room == NULL) {
+        releaseRead(clientsLock);
+        return 0;
+    }
+
+    RoomTask* task = roomLoops_newTask(relayToRoom, room, client);
+    memcpy(&task->packet, packet, sizeof(Packet));
+    int posted = roomLoops_post(task);
+    releaseRead(clientsLock);
+
+    return posted ? 1 : -1;
 }
 
 void handleTextMessageRelay(Client* client, struct PacketText* packet) {
@@ -32,26 +107,19 @@ void handleTextMessageRelay(Client* client, struct PacketText* packet) {
     if (messageLength > 0 && messageLength <= MSG_MAX_LENGTH) {
         getClientUsername(client, packet->username);
 
-        // Allow to be sure client's room don't change between NULL check and room-lock acquire
-        acquireRead(clientsLock);
-
-        Room* room = client->room;
-        if (room == NULL) {
-            releaseRead(clientsLock);
+        int relayed = broadcastClientRoom(client, (Packet*) packet);
+        if (relayed == 0) {
             Packet errorPacket = NewPacketServerErrorMessage;
             memcpy(errorPacket.asServerErrorMessagePacket.message, "First join a room using /room join <name>.", 43);
-            sendPacket(client->socket, &errorPacket);
-            return;
+            sendToClient(client, &errorPacket);
+        } else if (relayed == -1) {
+            Packet errorPacket = NewPacketServerErrorMessage;
+            memcpy(errorPacket.asServerErrorMessagePacket.message, "The server is busy. Try again.", 31);
+            sendToClient(client, &errorPacket);
         }
-
-        acquireRead(room->lock);
-        releaseRead(clientsLock);
-
-        broadcastRoom( (Packet*) packet, room);
-        releaseRead(room->lock);
     } else {
         Packet serverErrorPacket = NewPacketServerErrorMessage;
         memcpy(serverErrorPacket.asServerErrorMessagePacket.message, "Invalid message.", 17);
-        sendPacket(client->socket, &serverErrorPacket);
+        sendToClient(client, &serverErrorPacket);
     }
 }
\ No newline at end of file
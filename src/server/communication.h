@@ -10,7 +10,23 @@
 #include "server.h"
 
 /**
- * \brief Broadcast a packet to all clients of the given room
+ * \brief Sends a packet to the given client with control priority
+ *
+ * The packet can still be queued when this function returns, but it's sent ahead of any queued
+ * file data (see outbound.h).
+ *
+ * \param client The client to send the packet to
+ * \param packet The packet to send
+ * \return 1 if the packet was accepted, -1 if the connection with the client failed
+ */
+int sendToClient(Client* client, Packet* packet);
+
+/**
+ * \brief Broadcast a packet to all clients and spectators of the given room
+ *
+ * It MUST be called by the loop of the room (see room-loop.h). The members of a large room and
+ * the spectators of any room are split into lanes, each lane being sent the packet by its own
+ * loop so the broadcast is spread across threads.
  *
  * \param packet The packet to broadcast
  * \param room The room
@@ -18,12 +34,15 @@
 void broadcastRoom(Packet* packet, Room* room);
 
 /**
- * \brief Broadcast a packet to all clients of the given room with room-lock acquirement
+ * \brief Broadcast a packet to all clients of the room the given client is in
  *
- * \param packet The packet to broadcast
- * \param room The room
+ * The packet is relayed by the loop of the room, this function doesn't wait for it.
+ *
+ * \param client The client whose room to broadcast the packet to
+ * \param packet The packet to broadcast (copied)
+ * \return 1 if the packet is being relayed, 0 if the client isn't in a room, -1 if the room loop is overloaded
  */
-void syncBroadcastRoom(Packet* packet, Room* room);
+int broadcastClientRoom(Client* client, Packet* packet);
 
 /**
  * \brief Processes a received PacketText
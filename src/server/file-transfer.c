@@ -5,278 +5,743 @@
 #include "communication.h"
 #include "string.h"
 #include "../common/synchronization.h"
-
-static unsigned int nextFileId = 1;
-static Mutex fileIdMutex;
-
-void fileTransfer_init() {
-    fileIdMutex = createMutex();
+#include "../common/atomics.h"
+#include "timeouts.h"
+#include "transfer-scheduler.h"
+#include "upload-resume.h"
+#include "../common/crc32c.h"
+#include "../common/hash-tree.h"
+
+static volatile unsigned int nextFileId = 1;
+/** Bandwidth shared by the downloads of all clients */
+static Throttle totalDownloadThrottle;
+/** Held while the hash tree of a file is read or stored, so a tree built by a download never replaces a newer one */
+static Mutex treeLock;
+
+void initFileTransfers() {
+    throttle_init(&totalDownloadThrottle, DOWNLOAD_TOTAL_BYTES_PER_SECOND, DOWNLOAD_BURST_BYTES);
+    initMutex(&treeLock);
 }
 
-void fileTransfer_cleanUp() {
-    destroyMutex(fileIdMutex);
+unsigned int generateNewFileId() {
+    return atomics_fetchAdd(&nextFileId, 1);
 }
 
-// Simple implementation
-unsigned int generateNewFileId() {
-    unsigned int id;
-    acquireMutex(fileIdMutex);
-    id = nextFileId++;
-    releaseMutex(fileIdMutex);
-    return id;
+ClientTransfers* getClientTransfers(Client* client) {
+    if (client->transfers == NULL) {
+        ClientTransfers* transfers = malloc(sizeof(ClientTransfers));
+        initMutex(&transfers->transferLock);
+        initMutex(&transfers->proofLock);
+        bitmap_clearAll(transfers->uploadSlots, MAX_CONCURRENT_FILE_TRANSFER);
+        bitmap_clearAll((BitmapWord*) transfers->downloadSlots, MAX_DOWNLOAD_STREAMS);
+        for (int i = 0; i < MAX_CONCURRENT_FILE_TRANSFER; i++) {
+            transfers->uploadData[i].fileId = 0;
+            transfers->uploadData[i].fileContent = NULL;
+            transfers->uploadData[i].fileSize = 0;
+            transfers->uploadData[i].received = 0;
+        }
+        for (int i = 0; i < MAX_DOWNLOAD_STREAMS; i++) {
+            transfers->downloadData[i].downloadedFileId = 0;
+            transfers->downloadData[i].ackEvent = createEvent();
+        }
+        transfers->closing = 0;
+        transfers->pendingCount = 0;
+        transfers->startingUploads = 0;
+        throttle_init(&transfers->downloadThrottle, DOWNLOAD_CLIENT_BYTES_PER_SECOND, DOWNLOAD_BURST_BYTES);
+
+        client->transfers = transfers;
+        timeouts_watchTransfers(client);
+    }
+
+    return client->transfers;
 }
 
-int findAvailableUploadSlot(Client* client) {
-    int i = 0;
-    while (i < MAX_CONCURRENT_FILE_TRANSFER && client->uploadData[i].fileId != 0) {
-        i++;
+void freeClientTransfers(Client* client) {
+    ClientTransfers* transfers = client->transfers;
+    if (transfers == NULL) {
+        return;
     }
-    return i == MAX_CONCURRENT_FILE_TRANSFER ? -1 : i;
+
+    for (int i = 0; i < MAX_CONCURRENT_FILE_TRANSFER; i++) {
+        if (transfers->uploadData[i].fileContent != NULL) {
+            free(transfers->uploadData[i].fileContent);
+            transferScheduler_finished(TRANSFER_UPLOAD, transfers->uploadData[i].fileSize);
+        }
+    }
+
+    /* Threads sending downloads may still be running, they stop once the client is gone */
+    atomics_store(&transfers->closing, 1);
+    for (int i = 0; i < MAX_DOWNLOAD_STREAMS; i++) {
+        signalEvent(transfers->downloadData[i].ackEvent);
+    }
+    while (bitmap_next((BitmapWord*) transfers->downloadSlots, MAX_DOWNLOAD_STREAMS, 0) != -1) {
+        threadSleep(1);
+    }
+    for (int i = 0; i < MAX_DOWNLOAD_STREAMS; i++) {
+        destroyEvent(transfers->downloadData[i].ackEvent);
+    }
+    destroyMutex(&transfers->transferLock);
+    destroyMutex(&transfers->proofLock);
+    free(transfers);
+    client->transfers = NULL;
 }
 
-void handleUploadRequest(Client* client, struct PacketFileUploadRequest* packet) {
-    SYNC_CLIENT_READ(int mustJoinRoom = client->room == NULL);
-    if (mustJoinRoom) {
-        Packet errorPacket = NewPacketServerErrorMessage;
-        memcpy(errorPacket.asServerErrorMessagePacket.message, "First join a room using /room join <name>.", 43);
-        sendPacket(client->socket, &errorPacket);
+void parkUploads(Client* client) {
+    ClientTransfers* transfers = client->transfers;
+    if (transfers == NULL) {
         return;
     }
 
-    int uploadId = findAvailableUploadSlot(client);
-    int fileTooLarge = packet->fileSize <= 0 || packet->fileSize > MAX_FILE_SIZE_UPLOAD;
-    if (uploadId == -1 || fileTooLarge) {
-        /* The client is already uploading a file or file is too large. Refusing file upload */
+    for (int i = 0; i < MAX_CONCURRENT_FILE_TRANSFER; i++) {
+        acquireMutex(&transfers->transferLock);
+        char* content = transfers->uploadData[i].fileContent;
+        unsigned int fileId = transfers->uploadData[i].fileId;
+        long long fileSize = transfers->uploadData[i].fileSize;
+        long long received = transfers->uploadData[i].received;
+        if (content != NULL) {
+            transfers->uploadData[i].fileContent = NULL;
+            transfers->uploadData[i].fileId = 0;
+            transfers->uploadData[i].received = 0;
+            bitmap_release(transfers->uploadSlots, i);
+        }
+        releaseMutex(&transfers->transferLock);
+
+        if (content != NULL) {
+            uploadResume_park(transfers->uploadData[i].token, fileId, fileSize, content, received);
+            free(content);
+            transferScheduler_finished(TRANSFER_UPLOAD, fileSize);
+        }
+    }
+}
+
+/**
+ * \brief Formats the name of the file keeping the hash tree of the given file, next to it.
+ */
+void formatTreeName(unsigned int fileId, char* buffer) {
+    sprintf(buffer, "%u.tree", fileId);
+}
 
-        /* Create refuse packet */
-        Packet response = NewPacketFileUploadValidation;
-        struct PacketFileUploadValidation* validationPacket = &response.asFileUploadValidationPacket;
+/**
+ * \brief Writes the given file under a temporary name, then renames it : readers see either none of it or all of it.
+ *
+ * \return 1 if the file was written, else 0
+ */
+int writeFileAtomically(const char* filename, const char* content, unsigned long size) {
+    char temporaryFilename[32];
+    sprintf(temporaryFilename, "%s.tmp", filename);
+    if (files_writeFile(temporaryFilename, content, size) != size || files_renameFile(temporaryFilename, filename) != 0) {
+        files_deleteFile(temporaryFilename);
+        return 0;
+    }
 
-        /* Set packet attributes */
-        validationPacket->accepted = 0;
-        validationPacket->id = 0;
+    return 1;
+}
 
-        /* Send packet to client */
-        sendPacket(client->socket, &response);
+/**
+ * \brief Stores the hash tree of the given file, after the size of the file it was built from.
+ *
+ * \param replace 1 to replace a stored tree, 0 to keep it : a tree built by a download only replaces a malformed one
+ */
+void storeFileTree(unsigned int fileId, long long fileSize, const TreeHash* nodes, unsigned long treeSize, int replace) {
+    char* stored = malloc(sizeof(long long) + treeSize);
+    memcpy(stored, &fileSize, sizeof(long long));
+    memcpy(stored + sizeof(long long), nodes, treeSize);
+
+    char treeFilename[17];
+    formatTreeName(fileId, treeFilename);
+    acquireMutex(&treeLock);
+    if (replace || !files_getInfo(treeFilename).exists) {
+        writeFileAtomically(treeFilename, stored, sizeof(long long) + treeSize);
+    }
+    releaseMutex(&treeLock);
+    free(stored);
+}
+
+/**
+ * \brief Hashes the given uploaded file by blocks and writes its tree.
+ */
+void writeFileTree(unsigned int fileId, const char* content, long long fileSize) {
+    unsigned int blockCount = hashTree_blockCount(fileSize);
+    unsigned int nodeCount = hashTree_nodeCount(blockCount);
+    TreeHash* nodes = malloc(sizeof(TreeHash) * nodeCount);
+    for (unsigned int i = 0; i < blockCount; i++) {
+        long long blockOffset = (long long) i * HASH_TREE_BLOCK_BYTES;
+        long long remaining = fileSize - blockOffset;
+        nodes[i] = hashTree_hashBlock(content + blockOffset, remaining > HASH_TREE_BLOCK_BYTES ? HASH_TREE_BLOCK_BYTES : (remaining > 0 ? remaining : 0));
+    }
+    hashTree_build(nodes, blockCount);
 
-        /* Tell the client the reason the upload is refused */
+    /* File ids restart with the server, the tree of an older file with the same id is replaced */
+    storeFileTree(fileId, fileSize, nodes, sizeof(TreeHash) * nodeCount, 1);
+    free(nodes);
+}
 
-        /* Create packet */
-        response = NewPacketServerErrorMessage;
+/**
+ * \brief Reads the hash tree of the given file.
+ *
+ * The tree is built by reading the file if it wasn't uploaded by a client, and kept for the next downloads.
+ * It's built without holding treeLock : concurrent first downloads of a file each build the same tree.
+ * A tree stored for another size of the file is never rebuilt : the file isn't the one it was built from.
+ * A malformed tree is rebuilt and replaced.
+ *
+ * \return the nodes of the tree, to free, or NULL if the file can't be read or doesn't match its tree
+ */
+TreeHash* loadFileTree(unsigned int fileId, long long fileSize) {
+    unsigned int blockCount = hashTree_blockCount(fileSize);
+    unsigned long treeSize = sizeof(TreeHash) * hashTree_nodeCount(blockCount);
+    unsigned long storedSize = sizeof(long long) + treeSize;
+    char* stored = malloc(storedSize);
+    char treeFilename[17];
+    formatTreeName(fileId, treeFilename);
+
+    /* Size of the file the stored tree was built from, -1 if no well-formed tree is stored */
+    long long builtSize = -1;
+    acquireMutex(&treeLock);
+    FileInfo treeInfo = files_getInfo(treeFilename);
+    if (treeInfo.exists && files_readFileAt(treeFilename, 0, (char*) &builtSize, sizeof(long long)) == sizeof(long long)
+        && treeInfo.size != (long long) (sizeof(long long) + sizeof(TreeHash) * hashTree_nodeCount(hashTree_blockCount(builtSize)))) {
+        /* Written by an older server or damaged, it's replaced */
+        builtSize = -1;
+    }
+    int loaded = builtSize == fileSize && files_readFile(treeFilename, stored, storedSize) == storedSize;
+    releaseMutex(&treeLock);
+
+    TreeHash* nodes = malloc(treeSize);
+    if (loaded) {
+        memcpy(nodes, stored + sizeof(long long), treeSize);
+    } else if (builtSize != -1) {
+        free(nodes);
+        nodes = NULL;
+    } else {
+        char filename[12];
+        sprintf(filename, "%u", fileId);
+        char* block = malloc(HASH_TREE_BLOCK_BYTES);
+        for (unsigned int i = 0; nodes != NULL && i < blockCount; i++) {
+            long long blockOffset = (long long) i * HASH_TREE_BLOCK_BYTES;
+            long long remaining = fileSize - blockOffset;
+            unsigned long blockSize = remaining > HASH_TREE_BLOCK_BYTES ? HASH_TREE_BLOCK_BYTES : (remaining > 0 ? remaining : 0);
+            if (blockSize > 0 && files_readFileAt(filename, blockOffset, block, blockSize) != blockSize) {
+                free(nodes);
+                nodes = NULL;
+            } else {
+                nodes[i] = hashTree_hashBlock(block, blockSize);
+            }
+        }
+        free(block);
 
-        /* Set error message */
-        if (uploadId == -1) {
-            memcpy(response.asServerErrorMessagePacket.message, "Already uploading.", 19);
+        /* Only a file which kept its size while being hashed is trusted to match its tree */
+        if (nodes != NULL && files_getInfo(filename).size == fileSize) {
+            hashTree_build(nodes, blockCount);
+            storeFileTree(fileId, fileSize, nodes, treeSize, treeInfo.exists);
         } else {
-            memcpy(response.asServerErrorMessagePacket.message, "File too large.", 16);
+            free(nodes);
+            nodes = NULL;
         }
+    }
+    free(stored);
+
+    return nodes;
+}
 
-        /* Send packet to client */
-        sendPacket(client->socket, &response);
+int findAvailableUploadSlot(ClientTransfers* transfers) {
+    return bitmap_acquire(transfers->uploadSlots, MAX_CONCURRENT_FILE_TRANSFER);
+}
+
+/**
+ * \brief Refuses an upload request of the given client, telling it the reason.
+ */
+void refuseUpload(Client* client, const char* reason) {
+    /* Create refuse packet */
+    Packet response = NewPacketFileUploadValidation;
+    struct PacketFileUploadValidation* validationPacket = &response.asFileUploadValidationPacket;
+
+    /* Set packet attributes */
+    validationPacket->accepted = 0;
+    validationPacket->id = 0;
+
+    /* Send packet to client */
+    sendToClient(client, &response);
+
+    /* Tell the client the reason the upload is refused */
+    response = NewPacketServerErrorMessage;
+    strcpy(response.asServerErrorMessagePacket.message, reason);
+    sendToClient(client, &response);
+}
+
+void startUpload(Client* client, int uploadId, const TransferRequest* request) {
+    ClientTransfers* transfers = client->transfers;
+    char* fileContent = malloc(sizeof(char) * request->fileSize);
+    unsigned int fileId;
+    unsigned long long token;
+    long long received;
+
+    if (request->resumeToken != 0
+        && uploadResume_claim(request->resumeToken, request->fileSize, &fileId, fileContent, &received)) {
+        token = request->resumeToken;
     } else {
         /* The file can be uploaded. Generating a file ID */
-        unsigned int fileId = generateNewFileId();
+        fileId = generateNewFileId();
+        token = uploadResume_newToken();
+        received = 0;
+    }
 
-        /* Create the packet */
-        Packet response = NewPacketFileUploadValidation;
-        struct PacketFileUploadValidation* validationPacket = &response.asFileUploadValidationPacket;
+    /* Set client upload state */
+    acquireMutex(&transfers->transferLock);
+    transfers->uploadData[uploadId].fileId = fileId;
+    transfers->uploadData[uploadId].token = token;
+    transfers->uploadData[uploadId].fileContent = fileContent;
+    transfers->uploadData[uploadId].fileSize = request->fileSize;
+    transfers->uploadData[uploadId].received = received;
+    transfers->uploadData[uploadId].receivedChecksum = crc32c_update(0, fileContent, received);
+    transfers->uploadData[uploadId].acknowledged = received;
+    timeouts_watchUpload(client, uploadId);
+    releaseMutex(&transfers->transferLock);
+
+    /* Create the packet */
+    Packet response = NewPacketFileUploadValidation;
+    struct PacketFileUploadValidation* validationPacket = &response.asFileUploadValidationPacket;
+
+    /* Set packet attributes */
+    validationPacket->accepted = 1;
+    validationPacket->id = fileId;
+    validationPacket->token = token;
+    validationPacket->offset = received;
+
+    /* Send packet to client */
+    sendToClient(client, &response);
+}
 
-        /* Set packet attributes */
-        validationPacket->accepted = 1;
-        validationPacket->id = fileId;
+void handleUploadRequest(Client* client, struct PacketFileUploadRequest* packet) {
+    SYNC_CLIENT_READ(int mustJoinRoom = client->room == NULL);
+    if (mustJoinRoom) {
+        Packet errorPacket = NewPacketServerErrorMessage;
+        memcpy(errorPacket.asServerErrorMessagePacket.message, "First join a room using /room join <name>.", 43);
+        sendToClient(client, &errorPacket);
+        return;
+    }
 
-        /* Send packet to client */
-        sendPacket(client->socket, &response);
+    /* A file larger than the upload budget would never be started */
+    if (packet->fileSize <= 0 || packet->fileSize > MAX_FILE_SIZE_UPLOAD || packet->fileSize > UPLOAD_MEMORY_BUDGET) {
+        refuseUpload(client, "File too large.");
+        return;
+    }
 
-        /* Set client upload state */
-        client->uploadData[uploadId].fileId = fileId;
-        client->uploadData[uploadId].fileContent = malloc(sizeof(char) * packet->fileSize);
-        client->uploadData[uploadId].fileSize = packet->fileSize;
-        client->uploadData[uploadId].received = 0;
+    getClientTransfers(client);
+    TransferRequest request;
+    request.kind = TRANSFER_UPLOAD;
+    request.fileId = 0;
+    request.fileSize = packet->fileSize;
+    request.resumeToken = packet->resumeToken;
+    request.offset = 0;
+    request.length = 0;
+    if (!transferScheduler_submit(client, &request)) {
+        refuseUpload(client, "Too many transfers queued.");
     }
 }
 
-int findUploadIdForFile(Client* client, unsigned fileId) {
-    int i = 0;
-    while (i < MAX_CONCURRENT_FILE_TRANSFER && client->uploadData[i].fileId != fileId) {
-        i++;
+int findUploadIdForFile(ClientTransfers* transfers, unsigned fileId) {
+    int i = bitmap_next(transfers->uploadSlots, MAX_CONCURRENT_FILE_TRANSFER, 0);
+    while (i != -1 && transfers->uploadData[i].fileId != fileId) {
+        i = bitmap_next(transfers->uploadSlots, MAX_CONCURRENT_FILE_TRANSFER, i + 1);
     }
 
-    return i == MAX_CONCURRENT_FILE_TRANSFER ? -1 : i;
+    return i;
 }
 
 void handleFileDataUpload(Client* client, struct PacketFileDataTransfer* packet) {
-    int uploadId = findUploadIdForFile(client, packet->id);
+    ClientTransfers* transfers = client->transfers;
+    if (transfers == NULL) {
+        /* The client never asked to upload a file, just ignoring the packet */
+        return;
+    }
+
+    acquireMutex(&transfers->transferLock);
+    int uploadId = findUploadIdForFile(transfers, packet->id);
     if (packet->id > 0 && uploadId != -1) {
         /* The client is uploading and the packet data refers to the current upload file */
+        transfers->uploadData[uploadId].lastChunkTime = atomics_load64(&client->lastActivity);
 
         /* Calculating expected data chunk size */
-        unsigned remainingToDownload = client->uploadData[uploadId].fileSize - client->uploadData[uploadId].received;
+        unsigned remainingToDownload = transfers->uploadData[uploadId].fileSize - transfers->uploadData[uploadId].received;
         unsigned int nextChunkSize = remainingToDownload > FILE_TRANSFER_CHUNK_SIZE ? FILE_TRANSFER_CHUNK_SIZE : remainingToDownload;
 
         /* Appending data to file content */
-        memcpy(client->uploadData[uploadId].fileContent + client->uploadData[uploadId].received, packet->data, nextChunkSize);
-        client->uploadData[uploadId].received += nextChunkSize;
-
-        if (client->uploadData[uploadId].received >= client->uploadData[uploadId].fileSize) {
-            /* We received all file content */
-
-            /* Writing file to disk */
-            char filename[12];
-            sprintf(filename, "%d", client->uploadData[uploadId].fileId);
-            files_writeFile(filename, client->uploadData[uploadId].fileContent, client->uploadData[uploadId].fileSize);
-
-            /* Telling clients a new file is available */
-            Packet uploadSuccessPacket = NewPacketServerSuccess; // TODO: Create a ServerInformation packet
-            sprintf(
-                uploadSuccessPacket.asServerErrorMessagePacket.message,
-                "%s uploaded file %d",
-                client->username,
-                client->uploadData[uploadId].fileId
-            );
-
-            acquireRead(clientsLock);
-            Room* room = client->room;
-            if (room != NULL) {
-                acquireRead(room->lock);
-                releaseRead(clientsLock);
-
-                broadcastRoom(&uploadSuccessPacket, room);
-
-                releaseRead(room->lock);
-            } else {
-                releaseRead(clientsLock);
-            }
-
-            /* Set client upload state */
-            free(client->uploadData[uploadId].fileContent);
-            client->uploadData[uploadId].fileId = 0;
-            client->uploadData[uploadId].received = 0;
-            client->uploadData[uploadId].fileContent = NULL;
+        memcpy(transfers->uploadData[uploadId].fileContent + transfers->uploadData[uploadId].received, packet->data, nextChunkSize);
+        transfers->uploadData[uploadId].received += nextChunkSize;
+        transfers->uploadData[uploadId].receivedChecksum = crc32c_update(
+            transfers->uploadData[uploadId].receivedChecksum, packet->data, nextChunkSize
+        );
+
+        long long received = transfers->uploadData[uploadId].received;
+        if (received < transfers->uploadData[uploadId].fileSize
+            && received - transfers->uploadData[uploadId].acknowledged >= FILE_TRANSFER_ACK_BYTES) {
+            /* Letting the client send more data */
+            Packet ackPacket = NewPacketFileDataAck;
+            ackPacket.asFileDataAckPacket.id = packet->id;
+            ackPacket.asFileDataAckPacket.offset = received;
+            sendToClient(client, &ackPacket);
+            transfers->uploadData[uploadId].acknowledged = received;
         }
     } // Just ignoring packet if id does not match
+    releaseMutex(&transfers->transferLock);
+}
+
+void handleFileUploadDigest(Client* client, struct PacketFileUploadDigest* packet) {
+    ClientTransfers* transfers = client->transfers;
+    if (transfers == NULL) {
+        return;
+    }
+
+    char* fileContent = NULL;
+    unsigned int fileId = 0;
+    long long fileSize = 0;
+    int intact = 0;
+    acquireMutex(&transfers->transferLock);
+    int uploadId = findUploadIdForFile(transfers, packet->id);
+    if (packet->id > 0 && uploadId != -1) {
+        /* The digest follows the data of the file, a missing byte is a corruption as well */
+        intact = transfers->uploadData[uploadId].received == transfers->uploadData[uploadId].fileSize
+            && transfers->uploadData[uploadId].receivedChecksum == packet->checksum;
+
+        /* The content is taken from the slot : the file is written without holding the lock, which the timers thread takes */
+        fileContent = transfers->uploadData[uploadId].fileContent;
+        fileId = transfers->uploadData[uploadId].fileId;
+        fileSize = transfers->uploadData[uploadId].fileSize;
+        transfers->uploadData[uploadId].fileId = 0;
+        transfers->uploadData[uploadId].received = 0;
+        transfers->uploadData[uploadId].fileContent = NULL;
+        bitmap_release(transfers->uploadSlots, uploadId);
+    }
+    releaseMutex(&transfers->transferLock);
+
+    if (fileContent == NULL) {
+        // Just ignoring packet if id does not match
+        return;
+    }
+
+    if (intact) {
+        /* Both are renamed into place, the tree first : a download finding the file finds all of it and its tree */
+        writeFileTree(fileId, fileContent, fileSize);
+        char filename[12];
+        sprintf(filename, "%d", fileId);
+        writeFileAtomically(filename, fileContent, fileSize);
+
+        /* Telling clients a new file is available */
+        Packet uploadSuccessPacket = NewPacketServerSuccess; // TODO: Create a ServerInformation packet
+        sprintf(
+            uploadSuccessPacket.asServerErrorMessagePacket.message,
+            "%s uploaded file %d",
+            client->username,
+            fileId
+        );
+
+        broadcastClientRoom(client, &uploadSuccessPacket);
+    } else {
+        Packet errorPacket = NewPacketServerErrorMessage;
+        memcpy(errorPacket.asServerErrorMessagePacket.message, "File upload corrupted. Canceled.", 33);
+        sendToClient(client, &errorPacket);
+    }
+
+    free(fileContent);
+    transferScheduler_finished(TRANSFER_UPLOAD, fileSize);
 }
 
-int findAvailableDownloadSlot(Client* client) {
-    int i = 0;
-    while(i < MAX_CONCURRENT_FILE_TRANSFER && client->downloadData[i].downloadedFileId != 0) {
-        i++;
+int findAvailableDownloadSlot(ClientTransfers* transfers) {
+    return bitmap_acquireShared(transfers->downloadSlots, MAX_DOWNLOAD_STREAMS);
+}
+
+/**
+ * \brief Sends the proof of the given block of a downloaded file, split over as many packets as needed.
+ *
+ * The packets of a proof are queued one after the other, even when other ranges are sent meanwhile.
+ *
+ * \return 1 if the proof was queued, -1 if the client is gone
+ */
+int sendBlockProof(Client* client, unsigned int fileId, const TreeHash* nodes, unsigned int blockCount, unsigned int block) {
+    TreeHash siblings[HASH_TREE_MAX_DEPTH];
+    unsigned int proofLength = hashTree_proof(nodes, blockCount, block, siblings);
+
+    Packet proofPacket = NewPacketFileBlockProof;
+    struct PacketFileBlockProof* proof = &proofPacket.asFileBlockProofPacket;
+    proof->fileId = fileId;
+    proof->block = block;
+    proof->hash = nodes[block];
+    proof->proofLength = (unsigned char) proofLength;
+
+    int result = 1;
+    acquireMutex(&client->transfers->proofLock);
+    /* A single block has an empty proof, still sent for its hash */
+    unsigned int first = 0;
+    do {
+        unsigned int count = proofLength - first > HASH_TREE_PROOF_HASHES ? HASH_TREE_PROOF_HASHES : proofLength - first;
+        proof->first = (unsigned char) first;
+        memcpy(proof->siblings, siblings + first, sizeof(TreeHash) * count);
+        if (outbound_send(&client->outbound, &proofPacket, OUTBOUND_PRIORITY_BULK) == -1) {
+            result = -1;
+        }
+        first += count;
+    } while (result == 1 && first < proofLength);
+    releaseMutex(&client->transfers->proofLock);
+
+    return result;
+}
+
+/**
+ * \brief Data passed to the thread uploading a file to a client
+ */
+struct UploadWorkerData {
+    Client* client;
+    int downloadId;
+};
+
+/**
+ * \brief Waits until the client acknowledged enough data of the given download to send the given position.
+ *
+ * \return 1 once the position can be sent, 0 if the client stopped acknowledging data, -1 if the client is gone or canceled the download
+ */
+int waitForDownloadWindow(ClientTransfers* transfers, int downloadId, long long position) {
+    while (position - (long long) atomics_load64(&transfers->downloadData[downloadId].acked) >= FILE_TRANSFER_WINDOW_BYTES) {
+        if (atomics_load(&transfers->closing) || atomics_load(&transfers->downloadData[downloadId].canceled)) {
+            return -1;
+        }
+        if (!waitEventFor(transfers->downloadData[downloadId].ackEvent, FILE_TRANSFER_ACK_TIMEOUT_MILLIS)) {
+            return 0;
+        }
     }
 
-    return i == MAX_CONCURRENT_FILE_TRANSFER ? -1 : i;
+    return atomics_load(&transfers->closing) || atomics_load(&transfers->downloadData[downloadId].canceled) ? -1 : 1;
 }
 
 THREAD_ENTRY_POINT uploadFileToClient(void* data) {
-    Client* client = *((Client**)data);
-    int downloadId = *((int*)data + sizeof(Client*));
+    Client* client = ((struct UploadWorkerData*)data)->client;
+    int downloadId = ((struct UploadWorkerData*)data)->downloadId;
+    ClientTransfers* transfers = client->transfers;
+    free(data);
 
     char filename[12];
-    sprintf(filename, "%d", client->downloadData[downloadId].downloadedFileId);
+    sprintf(filename, "%d", transfers->downloadData[downloadId].downloadedFileId);
     FileInfo info = files_getInfo(filename);
 
-    if (info.exists && !info.isDirectory) {
-        char* fileContent = malloc(sizeof(char) * info.size);
-        if (files_readFile(filename, fileContent, info.size) != -1) {
+    /* The download is canceled if the file can't be read or the client stops acknowledging data */
+    int canceled = 1;
+    long long offset = transfers->downloadData[downloadId].offset;
+    long long length = transfers->downloadData[downloadId].length;
+    TreeHash* nodes = NULL;
+    if (info.exists && !info.isDirectory && offset + length <= info.size) {
+        nodes = loadFileTree(transfers->downloadData[downloadId].downloadedFileId, info.size);
+    }
+    if (nodes != NULL) {
+        unsigned int blockCount = hashTree_blockCount(info.size);
+
+        /* The range is read by buffers, so a stream holds a bounded amount of memory whatever its length */
+        char* buffer = malloc(DOWNLOAD_READ_BYTES);
+        long long bufferStart = 0;
+        long long bufferLength = length > DOWNLOAD_READ_BYTES ? DOWNLOAD_READ_BYTES : length;
+        if (files_readFileAt(filename, offset, buffer, bufferLength) == (unsigned long) bufferLength) {
+            /* Accepted once the root of the tree is known, it's sent before any data */
+            Packet acceptDownloadPacket = NewPacketFileDownloadValidation;
+            struct PacketFileDownloadValidation* validationPacket = &acceptDownloadPacket.asFileDownloadValidationPacket;
+            validationPacket->accepted = 1;
+            validationPacket->fileId = transfers->downloadData[downloadId].downloadedFileId;
+            validationPacket->fileSize = info.size;
+            validationPacket->offset = offset;
+            validationPacket->length = length;
+            validationPacket->rootHash = hashTree_root(nodes, blockCount);
+            sendToClient(client, &acceptDownloadPacket);
+
             Packet dataPacket = NewPacketFileDataTransfer;
-            dataPacket.asFileDataTransferPacket.id = client->downloadData[downloadId].downloadedFileId;
+            dataPacket.asFileDataTransferPacket.id = transfers->downloadData[downloadId].downloadedFileId;
             long long sent = 0;
-            while (sent < info.size) {
-                long long remaining = info.size - sent;
+            unsigned int nextProof = (unsigned int) (offset / HASH_TREE_BLOCK_BYTES);
+            int window = 1;
+            while (window == 1 && sent < length) {
+                if (sent == bufferStart + bufferLength) {
+                    bufferStart = sent;
+                    bufferLength = length - sent > DOWNLOAD_READ_BYTES ? DOWNLOAD_READ_BYTES : length - sent;
+                    if (files_readFileAt(filename, offset + sent, buffer, bufferLength) != (unsigned long) bufferLength) {
+                        /* The client is told the download is canceled */
+                        window = 0;
+                        break;
+                    }
+                }
+                long long remaining = length - sent;
                 long long toSend = remaining > FILE_TRANSFER_CHUNK_SIZE ? FILE_TRANSFER_CHUNK_SIZE : remaining;
-                memcpy(dataPacket.asFileDataTransferPacket.data, fileContent + sent, toSend);
-                if (sendPacket(client->socket, &dataPacket) == -1) {
-                    free(fileContent);
-                    client->downloadData[downloadId].downloadedFileId = 0;
-                    destroyThread(&client->downloadData[downloadId].downloadThread);
-                    return 0;
+                dataPacket.asFileDataTransferPacket.offset = offset + sent;
+                memcpy(dataPacket.asFileDataTransferPacket.data, buffer + (sent - bufferStart), toSend);
+
+                /* Only a window of data is ahead of the client, so its other packets don't wait behind file data */
+                long long position = offset + sent;
+                window = waitForDownloadWindow(transfers, downloadId, position);
+                /* The proof of a block precedes its data, so the client checks the block as soon as it's received */
+                while (window == 1 && nextProof <= (position + toSend - 1) / HASH_TREE_BLOCK_BYTES) {
+                    window = sendBlockProof(client, dataPacket.asFileDataTransferPacket.id, nodes, blockCount, nextProof);
+                    nextProof++;
+                }
+                if (window == 1) {
+                    /* Waiting for the bandwidth of the client first, so it doesn't hold shared bandwidth while waiting */
+                    throttle_wait(&transfers->downloadThrottle, toSend);
+                    throttle_wait(&totalDownloadThrottle, toSend);
+                    if (outbound_send(&client->outbound, &dataPacket, OUTBOUND_PRIORITY_BULK) == -1) {
+                        window = -1;
+                    } else {
+                        sent += toSend;
+                    }
                 }
-                sent += toSend;
             }
-        } else {
-            Packet cancelPacket = NewPacketFileTransferCancel;
-            cancelPacket.asFileTransferCancelPacket.id = client->downloadData[downloadId].downloadedFileId;
-            sendPacket(client->socket, &cancelPacket);
+
+            /* Nobody to tell if the client is gone or canceled the download */
+            canceled = window == 0;
         }
 
-        free(fileContent);
-    } else {
+        free(buffer);
+        free(nodes);
+    }
+
+    if (canceled) {
         Packet cancelPacket = NewPacketFileTransferCancel;
-        cancelPacket.asFileTransferCancelPacket.id = client->downloadData[downloadId].downloadedFileId;
-        sendPacket(client->socket, &cancelPacket);
+        cancelPacket.asFileTransferCancelPacket.id = transfers->downloadData[downloadId].downloadedFileId;
+        sendToClient(client, &cancelPacket);
     }
 
-    client->downloadData[downloadId].downloadedFileId = 0;
-    destroyThread(&client->downloadData[downloadId].downloadThread);
+    acquireMutex(&transfers->transferLock);
+    transfers->downloadData[downloadId].downloadedFileId = 0;
+    releaseMutex(&transfers->transferLock);
+    bitmap_releaseShared(transfers->downloadSlots, downloadId);
+    transferScheduler_finished(TRANSFER_DOWNLOAD, 0);
     return 0;
 }
 
-void handleDownloadRequest(Client* client, struct PacketFileDownloadRequest* packet) {
-    // TODO: Cancel download when client leaves room
-    if (client->room == NULL) {
-        Packet errorPacket = NewPacketServerErrorMessage;
-        memcpy(errorPacket.asServerErrorMessagePacket.message, "First join a room using /room join <name>.", 43);
-        sendPacket(client->socket, &errorPacket);
-        return;
-    }
-
-    int downloadId = findAvailableDownloadSlot(client);
-    if (downloadId == -1) {
-        /* Client is already downloading a file. Refusing download request */
+/**
+ * \brief Tells the given client its download request is refused.
+ */
+void refuseDownload(Client* client, unsigned int fileId) {
+    /* Create the packet */
+    Packet refuseDownloadPacket = NewPacketFileDownloadValidation;
+    struct PacketFileDownloadValidation* validationPacket = &refuseDownloadPacket.asFileDownloadValidationPacket;
 
-        /* Create packet */
-        Packet refuseDownloadPacket = NewPacketFileDownloadValidation;
-        struct PacketFileDownloadValidation* validationPacket = &refuseDownloadPacket.asFileDownloadValidationPacket;
+    /* Set packet attributes */
+    validationPacket->accepted = 0;
+    validationPacket->fileId = fileId;
 
-        /* Set packet attributes */
-        validationPacket->accepted = 0;
-        validationPacket->fileId = packet->fileId;
+    /* Send packet to client */
+    sendToClient(client, &refuseDownloadPacket);
+}
 
-        /* Send packet to client */
-        sendPacket(client->socket, &refuseDownloadPacket);
-    } else {
-        /* Client is not downloading, checking if the requested file is downloadable */
+/**
+ * \brief Starts sending the file to the given client, which is told its download is accepted once the file is read.
+ */
+void startDownload(Client* client, int downloadId, const TransferRequest* request) {
+    ClientTransfers* transfers = client->transfers;
+
+    /* Allocating thread data */
+    struct UploadWorkerData* threadData = malloc(sizeof(struct UploadWorkerData)); // Free-ed in uploadFileToClient function
+    threadData->client = client;
+    threadData->downloadId = downloadId;
+
+    /* Define client download state and start upload worker, acknowledgements of the range may arrive right away */
+    acquireMutex(&transfers->transferLock);
+    transfers->downloadData[downloadId].downloadedFileId = request->fileId;
+    transfers->downloadData[downloadId].offset = request->offset;
+    transfers->downloadData[downloadId].length = request->length;
+    atomics_store64(&transfers->downloadData[downloadId].acked, request->offset);
+    atomics_store(&transfers->downloadData[downloadId].canceled, 0);
+    releaseMutex(&transfers->transferLock);
+    Thread thread = createThread(uploadFileToClient, threadData); // Start sending data
+    /* Nobody joins the thread, which may start the next transfer once done : it must not cancel itself */
+    detachThread(&thread);
+}
 
-        /* Get file information */
-        char filename[12];
-        sprintf(filename, "%d", packet->fileId);
-        FileInfo fileInfo = files_getInfo(filename);
+int startTransfer(Client* client, const TransferRequest* request) {
+    ClientTransfers* transfers = client->transfers;
+    if (request->kind == TRANSFER_UPLOAD) {
+        acquireMutex(&transfers->transferLock);
+        int uploadId = findAvailableUploadSlot(transfers);
+        releaseMutex(&transfers->transferLock);
+        return uploadId;
+    }
 
-        if (fileInfo.exists && !fileInfo.isDirectory) {
-            /* The requested file can be downloaded */
+    int downloadId = findAvailableDownloadSlot(transfers);
+    if (downloadId != -1) {
+        startDownload(client, downloadId, request);
+    }
 
-            /* Create the packet */
-            Packet acceptDownloadPacket = NewPacketFileDownloadValidation;
-            struct PacketFileDownloadValidation* validationPacket = &acceptDownloadPacket.asFileDownloadValidationPacket;
+    return downloadId;
+}
 
-            /* Set packet attributes */
-            validationPacket->accepted = 1;
-            validationPacket->fileId = packet->fileId;
-            validationPacket->fileSize = fileInfo.size;
+void handleDownloadRequest(Client* client, struct PacketFileDownloadRequest* packet) {
+    // TODO: Cancel download when client leaves room
+    if (client->room == NULL) {
+        Packet errorPacket = NewPacketServerErrorMessage;
+        memcpy(errorPacket.asServerErrorMessagePacket.message, "First join a room using /room join <name>.", 43);
+        sendToClient(client, &errorPacket);
+        return;
+    }
 
-            /* Send packet to client */
-            sendPacket(client->socket, &acceptDownloadPacket);
+    /* Get file information */
+    char filename[12];
+    sprintf(filename, "%d", packet->fileId);
+    FileInfo fileInfo = files_getInfo(filename);
+
+    /* A range is within the file, and not empty unless the file is */
+    if (!fileInfo.exists || fileInfo.isDirectory || packet->offset < 0 || packet->length < 0
+        || (packet->offset > 0 && packet->offset >= fileInfo.size)) {
+        /* The requested file can't be downloaded */
+        refuseDownload(client, packet->fileId);
+        return;
+    }
 
-            /* Allocating thread data */
-            void* threadData = malloc(sizeof(Client*) + sizeof(int));
-            *((Client**)threadData) = client;
-            *((int*)threadData + sizeof(Client*)) = downloadId;
+    getClientTransfers(client);
+    TransferRequest request;
+    request.kind = TRANSFER_DOWNLOAD;
+    request.fileId = packet->fileId;
+    request.fileSize = fileInfo.size;
+    request.resumeToken = 0;
+    request.offset = packet->offset;
+    request.length = fileInfo.size - packet->offset;
+    if (packet->length > 0 && packet->length < request.length) {
+        request.length = packet->length;
+    }
+    if (!transferScheduler_submit(client, &request)) {
+        /* Too many transfers queued. Refusing download request */
+        refuseDownload(client, packet->fileId);
+    }
+}
 
-            /* Define client download state and start upload worker */
-            client->downloadData[downloadId].downloadedFileId = packet->fileId;
-            client->downloadData[downloadId].downloadThread = createThread(uploadFileToClient, threadData); // Start sending data
-        } else {
-            /* The requested file can't be downloaded */
+void handleFileDataAck(Client* client, struct PacketFileDataAck* packet) {
+    ClientTransfers* transfers = client->transfers;
+    if (transfers == NULL) {
+        return;
+    }
 
-            /* Create the packet */
-            Packet refuseDownloadPacket = NewPacketFileDownloadValidation;
-            struct PacketFileDownloadValidation* validationPacket = &refuseDownloadPacket.asFileDownloadValidationPacket;
+    /* Ranges of a file are sent at once, the acknowledged offset tells which one it is about */
+    acquireMutex(&transfers->transferLock);
+    for (int i = 0; i < MAX_DOWNLOAD_STREAMS; i++) {
+        long long offset = transfers->downloadData[i].offset;
+        if (transfers->downloadData[i].downloadedFileId == packet->id && packet->offset > offset
+            && packet->offset <= offset + transfers->downloadData[i].length) {
+            if ((unsigned long long) packet->offset > atomics_load64(&transfers->downloadData[i].acked)) {
+                atomics_store64(&transfers->downloadData[i].acked, packet->offset);
+            }
+            signalEvent(transfers->downloadData[i].ackEvent);
+        }
+    }
+    releaseMutex(&transfers->transferLock);
+}
 
-            /* Set packet attributes */
-            validationPacket->accepted = 0;
-            validationPacket->fileId = packet->fileId;
+void handleDownloadCancel(Client* client, struct PacketFileTransferCancel* packet) {
+    if (client->transfers != NULL) {
+        transferScheduler_cancelDownloads(client, packet->id);
+    }
+}
 
-            /* Send packet to client */
-            sendPacket(client->socket, &refuseDownloadPacket);
+void stopDownloadStreams(Client* client, unsigned int fileId) {
+    ClientTransfers* transfers = client->transfers;
+    acquireMutex(&transfers->transferLock);
+    for (int i = 0; i < MAX_DOWNLOAD_STREAMS; i++) {
+        if (transfers->downloadData[i].downloadedFileId == fileId) {
+            atomics_store(&transfers->downloadData[i].canceled, 1);
+            signalEvent(transfers->downloadData[i].ackEvent);
         }
     }
-}
\ No newline at end of file
+    releaseMutex(&transfers->transferLock);
+}
@@ -4,6 +4,39 @@
 #include "server.h"
 #include "../common/packets.h"
 
+/**
+ * \brief Initializes the state shared by the file transfers of all clients.
+ */
+void initFileTransfers();
+
+/**
+ * \brief Retrieves the file transfers of the given client, allocating them on first use.
+ *
+ * It MUST only be called by the client thread.
+ *
+ * \param client The client to retrieve the transfers of
+ * \return the transfers of the client
+ */
+ClientTransfers* getClientTransfers(Client* client);
+
+/**
+ * \brief Frees the file transfers of the given client, if it has any.
+ *
+ * The client MUST NOT be supervised anymore (see timeouts_unwatchClient).
+ *
+ * \param client The client to free the transfers of
+ */
+void freeClientTransfers(Client* client);
+
+/**
+ * \brief Keeps the running uploads of the given client, so they can be resumed once it reconnects.
+ *
+ * The client MUST NOT be supervised anymore (see timeouts_unwatchClient).
+ *
+ * \param client The disconnected client
+ */
+void parkUploads(Client* client);
+
 /**
  * \brief Processes a received PacketFileUploadRequest
  *
@@ -12,6 +45,30 @@
  */
 void handleUploadRequest(Client* client, struct PacketFileUploadRequest* packet);
 
+/**
+ * \brief Starts a transfer chosen by the transfer scheduler, if the client has a free slot for it.
+ *
+ * A thread starts sending the file to the client right away for downloads. Uploads are only given
+ * their slot : setting them up allocates the file and may read an interrupted upload back, so the
+ * scheduler calls startUpload once it released its lock.
+ *
+ * \param client The client requesting the transfer
+ * \param request The transfer to start
+ * \return the slot of the transfer, or -1 if the client already runs as many transfers of this kind as it can
+ */
+int startTransfer(Client* client, const TransferRequest* request);
+
+/**
+ * \brief Sets the upload state of the given slot up and tells the client it can send the file.
+ *
+ * An interrupted upload is resumed if the request has its token, else a new upload starts.
+ *
+ * \param client The client uploading the file
+ * \param uploadId The slot given to the upload by startTransfer
+ * \param request The upload to start
+ */
+void startUpload(Client* client, int uploadId, const TransferRequest* request);
+
 /**
  * \brief Generates an unique file id for a new file upload
  *
@@ -27,6 +84,14 @@ unsigned int generateNewFileId();
  */
 void handleFileDataUpload(Client* client, struct PacketFileDataTransfer* packet);
 
+/**
+ * \brief Processes a received PacketFileUploadDigest, ending the upload : the file is kept if its checksum matches
+ *
+ * \param client The client who sent the packet
+ * \param packet The received packet
+ */
+void handleFileUploadDigest(Client* client, struct PacketFileUploadDigest* packet);
+
 /**
  * \brief Processes a received PacketFileDownloadRequest
  *
@@ -36,13 +101,29 @@ void handleFileDataUpload(Client* client, struct PacketFileDataTransfer* packet)
 void handleDownloadRequest(Client* client, struct PacketFileDownloadRequest* packet);
 
 /**
- * \brief Initializes required memory for file transfer system to work
+ * \brief Processes a received PacketFileDataAck, letting a download of the client send more data
+ *
+ * \param client The client who sent the packet
+ * \param packet The received packet
  */
-void fileTransfer_init();
+void handleFileDataAck(Client* client, struct PacketFileDataAck* packet);
 
 /**
- * \brief Cleans up the memory allocated for file transfer system
+ * \brief Processes a received PacketFileTransferCancel, stopping the download of the file by the client
+ *
+ * \param client The client who sent the packet
+ * \param packet The received packet
+ */
+void handleDownloadCancel(Client* client, struct PacketFileTransferCancel* packet);
+
+/**
+ * \brief Stops the ranges of the given file being sent to the given client
+ *
+ * Called by the transfer scheduler, holding its lock : no range of the file starts meanwhile.
+ *
+ * \param client The client downloading the file
+ * \param fileId The file the client doesn't want anymore
  */
-void fileTransfer_cleanUp();
+void stopDownloadStreams(Client* client, unsigned int fileId);
 
 #endif //C_CHAT_FILE_TRANSFER_H
@@ -4,31 +4,58 @@
 #include "communication.h"
 #include "string.h"
 #include "room.h"
+#include "timeouts.h"
+#include "room-loop.h"
+#include "file-transfer.h"
+#include "transfer-scheduler.h"
 
-int scanForFreeSocketSlot() {
-    int i = 0;
-    while(i < NUMBER_CLIENT_MAX && clients[i] != NULL) {
-        i++;
-    }
-    return i == NUMBER_CLIENT_MAX ? -1 : i;
+/**
+ * \def HANDSHAKE_MAX_LENGTH
+ * \brief Maximum length of the first message of a connection : a username or a spectate request
+ */
+#define HANDSHAKE_MAX_LENGTH (sizeof(SPECTATE_HANDSHAKE_PREFIX) - 1 + ROOM_NAME_MAX_LENGTH)
+
+/**
+ * \brief Checks whether the room a spectator asked to watch exists.
+ */
+int spectatedRoomExists(const char* roomName) {
+    SYNC_ROOMS_READ(int exists = findRoomByName(roomName) != NULL);
+    return exists;
 }
 
-int initClientConnection(Client* client) {
+int initClientConnection(Client* client, char* spectatedRoom) {
     /* Message sent when receiving empty username */
     const char* emptyUsername = "Error. Username can't be empty.";
+    const char* unknownRoom = "Error. This room does not exist.";
     const char* okUsername = "Ok";
+    const unsigned int prefixLength = sizeof(SPECTATE_HANDSHAKE_PREFIX) - 1;
 
     Socket socket = client->socket;
+    char greeting[HANDSHAKE_MAX_LENGTH + 1];
+    spectatedRoom[0] = '\0';
 
     short validUsername = 0;
     int bytesReceived;
     do {
         /* Receiving client username */
-        bytesReceived = receiveFrom(socket, client->username, USERNAME_MAX_LENGTH);
+        bytesReceived = receiveFrom(socket, greeting, HANDSHAKE_MAX_LENGTH);
 
         /* If we received data */
-        if (bytesReceived >= 0) {
-            client->username[bytesReceived] = '\0';
+        if (bytesReceived > 0) {
+            greeting[bytesReceived] = '\0';
+
+            if (strncmp(greeting, SPECTATE_HANDSHAKE_PREFIX, prefixLength) == 0) {
+                /* The spectator is told it's accepted once it's handed over (see spectator.h) */
+                if (spectatedRoomExists(greeting + prefixLength)) {
+                    memcpy(spectatedRoom, greeting + prefixLength, strlen(greeting + prefixLength) + 1);
+                    return EXIT_SUCCESS;
+                }
+                sendTo(socket, unknownRoom, strlen(unknownRoom));
+                continue;
+            }
+
+            memcpy(client->username, greeting, USERNAME_MAX_LENGTH);
+            client->username[USERNAME_MAX_LENGTH] = '\0';
 
             /* We don't allow empty username */
             if (strlen(client->username) == 0) {
@@ -38,36 +65,71 @@ int initClientConnection(Client* client) {
                 validUsername = 1;
             }
         }
-    } while(!validUsername && bytesReceived >= 0); // Keep iterating while we receive data and username is invalid
+    } while(!validUsername && bytesReceived > 0); // Keep iterating while we receive data and username is invalid
 
     if (validUsername) {
         /* Telling client its username is valid */
         sendTo(client->socket, "Ok", strlen(okUsername));
-        SYNC_CLIENT_WRITE(client->joined = 1);
+        atomics_store(&client->joined, 1);
         printf("A client connected with username: %s\n", client->username);
     }
     return validUsername ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
-void disconnectClient(int id) {
+/**
+ * \brief Removes the client of the given slot from the clients and stops its timers.
+ *
+ * \return the removed client
+ */
+Client* unregisterClient(int id) {
     SYNC_CLIENT_WRITE(
             Client* client = clients[id];
             clients[id] = NULL;
+            bitmap_release(clientSlots, id);
     )
 
-    /* Simulate room leave request */
-    handleRoomLeaveRequest(client);
+    /* No upload may be started for the client nor timer use it once it's released */
+    transferScheduler_forget(client);
+    timeouts_unwatchClient(client);
+    return client;
+}
+
+/**
+ * \brief Frees heap-allocated memory for the given client, once its connection is closed or handed over.
+ */
+void freeClient(Client* client) {
+    freeClientTransfers(client);
+    destroyEvent(client->roomTaskDone);
+    slab_free(clientSlab, client);
+}
+
+void disconnectClient(int id) {
+    Client* client = unregisterClient(id);
+
+    /* The client can't stay a member of its room once freed */
+    leaveRoomOnDisconnect(client);
+
+    /* Room loops may still run tasks referencing the client, posted before it left */
+    roomLoops_flush(client->roomTaskDone);
 
-    /* Closing connection with client */
+    /* Closing connection with client, its writer gives up on packets still queued */
+    shutdownSocket(client->socket);
+    outbound_destroy(&client->outbound);
     closeSocket(&(client->socket));
 
     printf("Client disconnected : %s\n", client->username);
 
-    /* Free heap-allocated memory for client */
-    for (int i = 0; i < MAX_CONCURRENT_FILE_TRANSFER; i++) {
-        if (client->uploadData[i].fileContent != NULL) {
-            free(client->uploadData[i].fileContent);
-        }
-    }
-    free(client);
+    parkUploads(client);
+    freeClient(client);
+}
+
+Socket handOverConnection(int id) {
+    Client* client = unregisterClient(id);
+
+    /* Nothing was queued yet : the client never joined a room nor received a packet */
+    outbound_destroy(&client->outbound);
+    Socket socket = client->socket;
+
+    freeClient(client);
+    return socket;
 }
@@ -3,24 +3,19 @@
 
 #include "server.h"
 
-/**
- * \brief Scan clients slots for an available slot.
- *
- * Iterates over clients slots to find an empty slot.
- *
- * \return -1 if no empty slot was found, else an available slot id
- */
-int scanForFreeSocketSlot();
-
 /**
  * \brief Initialize a client connection to be ready to discuss.
  *
  * Receives the client username and performs checks to ensure its validity.
+ * A spectator sends SPECTATE_HANDSHAKE_PREFIX followed by the name of an existing room instead :
+ * it isn't told it's accepted yet, its connection is meant to be handed over (see handOverConnection).
  *
  * \param client A pointer to an integer which contains the slot id of the client to initialize
+ * \param spectatedRoom A buffer of ROOM_NAME_MAX_LENGTH + 1 bytes, receiving the room to watch for a
+ * spectator, else an empty string
  * \return EXIT_SUCCESS if client initialized correctly, else EXIT_FAILURE
  */
-int initClientConnection(Client* client);
+int initClientConnection(Client* client, char* spectatedRoom);
 
 /**
  * \brief Disconnects the client and free allocated memory
@@ -29,4 +24,14 @@ int initClientConnection(Client* client);
  */
 void disconnectClient(int id);
 
+/**
+ * \brief Releases the client but keeps its connection open, to serve it otherwise (see spectator.h)
+ *
+ * The client MUST NOT have joined a room.
+ *
+ * \param id The client slot id
+ * \return the socket of the connection with the client
+ */
+Socket handOverConnection(int id);
+
 #endif //C_CHAT_HANDSHAKE_H
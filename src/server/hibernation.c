@@ -0,0 +1,179 @@
+#include "hibernation.h"
+#include <stdlib.h>
+#include "file-transfer.h"
+#include "timeouts.h"
+#include "transfer-scheduler.h"
+#include "../common/adaptive-lock.h"
+#include "../common/packets.h"
+
+/**
+ * \brief A hibernated client, waiting for data
+ */
+struct HibernatedClient {
+    Client* client;
+    int id;
+};
+
+/** Hibernated clients, packed at the front of the array. Protected by hibernatedLock */
+static struct HibernatedClient hibernatedClients[NUMBER_CLIENT_MAX];
+static volatile unsigned int hibernatedCount = 0;
+static AdaptiveLock hibernatedLock = ADAPTIVE_LOCK_INITIALIZER;
+static Thread hibernationThread;
+
+/**
+ * \brief Releases the transfers of the given client if none is running.
+ *
+ * \return 1 if the client can hibernate, else 0
+ */
+int releaseColdState(Client* client) {
+    ClientTransfers* transfers = client->transfers;
+    if (transfers == NULL) {
+        return 1;
+    }
+
+    /* The client thread is the only one queuing requests, they can only start meanwhile, taking a slot */
+    if (transferScheduler_hasPending(client)) {
+        return 0;
+    }
+
+    acquireMutex(&transfers->transferLock);
+    int busy = bitmap_next(transfers->uploadSlots, MAX_CONCURRENT_FILE_TRANSFER, 0) != -1
+        || bitmap_next((BitmapWord*) transfers->downloadSlots, MAX_DOWNLOAD_STREAMS, 0) != -1;
+    releaseMutex(&transfers->transferLock);
+    if (busy) {
+        return 0;
+    }
+
+    /* Stall timers of finished uploads may still be armed */
+    timeouts_unwatchTransfers(client);
+    freeClientTransfers(client);
+    return 1;
+}
+
+int hibernation_waitForData(Client* client) {
+    unsigned long long timeout = CLIENT_HIBERNATION_DELAY_MILLIS;
+    while (1) {
+        unsigned long long quiet = timers_now() - atomics_load64(&client->lastActivity);
+        if (quiet < CLIENT_HIBERNATION_DELAY_MILLIS) {
+            timeout = CLIENT_HIBERNATION_DELAY_MILLIS - quiet;
+        }
+
+        /* Data, a closed connection or an error : the next receive deals with it */
+        if (waitForData(&client->socket, 1, NULL, (int) timeout) != 0) {
+            return 0;
+        }
+
+        quiet = timers_now() - atomics_load64(&client->lastActivity);
+        if (quiet >= CLIENT_HIBERNATION_DELAY_MILLIS) {
+            if (releaseColdState(client)) {
+                return 1;
+            }
+            /* A transfer is running, checking again later */
+            timeout = CLIENT_HIBERNATION_DELAY_MILLIS;
+        }
+    }
+}
+
+void hibernation_suspend(Client* client, int id) {
+    atomics_store(&client->hibernated, 1);
+    /* Nobody joins the ending thread, its resources are released once it ends */
+    SYNC_CLIENT_WRITE(detachThread(&client->thread));
+
+    adaptiveLock_acquire(&hibernatedLock);
+    hibernatedClients[hibernatedCount].client = client;
+    hibernatedClients[hibernatedCount].id = id;
+    atomics_store(&hibernatedCount, hibernatedCount + 1);
+    adaptiveLock_release(&hibernatedLock);
+}
+
+unsigned int hibernation_count() {
+    return atomics_load(&hibernatedCount);
+}
+
+THREAD_ENTRY_POINT resumedClientThread(void* data) {
+    struct HibernatedClient* hibernated = data;
+    Client* client = hibernated->client;
+    int id = hibernated->id;
+    free(data);
+
+    atomics_store(&client->hibernated, 0);
+    serveClient(client, id);
+    return 0;
+}
+
+/**
+ * \brief Starts a new thread for the given hibernated client.
+ */
+void resume(struct HibernatedClient* hibernated) {
+    struct HibernatedClient* data = malloc(sizeof(struct HibernatedClient)); // Free-ed in resumedClientThread function
+    *data = *hibernated;
+    /* The thread handle is written while holding the lock, as the thread reads it to hibernate again */
+    SYNC_CLIENT_WRITE(hibernated->client->thread = createThread(resumedClientThread, data));
+}
+
+/**
+ * \brief Processes the next packet of the given hibernated client if it's a pong, without resuming it.
+ *
+ * Other packets are left to the client thread, as well as partial pongs which would keep the socket ready.
+ * Pongs queued behind are processed on the next rounds, so a flooding client can't stall the others.
+ *
+ * \return 1 if a pong was processed, 0 if the client must be resumed
+ */
+int absorbPong(Client* client) {
+    Packet packet;
+    int pongSize = sizeof(struct PacketPong);
+    if (peekFrom(client->socket, &packet.type, pongSize) != pongSize || packet.type != PONG_MESSAGE_TYPE) {
+        return 0;
+    }
+
+    receiveNextPacket(client->socket, &packet);
+    handlePong(client, &packet.asPongPacket);
+    return 1;
+}
+
+THREAD_ENTRY_POINT hibernationWorker(void* data) {
+    static Socket sockets[NUMBER_CLIENT_MAX];
+    static char ready[NUMBER_CLIENT_MAX];
+    (void) data;
+
+    while (1) {
+        adaptiveLock_acquire(&hibernatedLock);
+        unsigned int count = hibernatedCount;
+        for (unsigned int i = 0; i < count; i++) {
+            sockets[i] = hibernatedClients[i].client->socket;
+        }
+        adaptiveLock_release(&hibernatedLock);
+
+        if (count == 0) {
+            threadSleep(HIBERNATION_POLL_MILLIS);
+            continue;
+        }
+
+        /* Clients hibernating meanwhile are watched from the next round */
+        if (waitForData(sockets, count, ready, HIBERNATION_POLL_MILLIS) <= 0) {
+            continue;
+        }
+
+        /* Only this thread removes clients : walking backwards, the ones moved by removals were already checked */
+        for (int i = (int) count - 1; i >= 0; i--) {
+            /* Answering a heartbeat isn't worth a thread, only other packets resume the client */
+            if (ready[i] && !absorbPong(hibernatedClients[i].client)) {
+                adaptiveLock_acquire(&hibernatedLock);
+                struct HibernatedClient hibernated = hibernatedClients[i];
+                hibernatedClients[i] = hibernatedClients[hibernatedCount - 1];
+                atomics_store(&hibernatedCount, hibernatedCount - 1);
+                adaptiveLock_release(&hibernatedLock);
+
+                resume(&hibernated);
+            }
+        }
+    }
+}
+
+void hibernation_init() {
+    hibernationThread = createThread(hibernationWorker, NULL);
+}
+
+void hibernation_cleanUp() {
+    destroyThread(&hibernationThread);
+}
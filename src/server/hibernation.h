@@ -0,0 +1,57 @@
+/**
+ * \file hibernation.h
+ * \brief Releases the resources of idle clients until they send data again.
+ *
+ * A client which didn't send anything for CLIENT_HIBERNATION_DELAY_MILLIS hibernates : its thread
+ * ends, releasing its stack and receive buffer, and its transfers are released. Its socket is
+ * watched by a single hibernation thread, which starts a new thread for the client once data is
+ * available. The outbound path of an idle client goes dormant by itself (see outbound.h), so only
+ * the Client structure is left.
+ *
+ * Pongs of hibernated clients are processed by the hibernation thread, so answering pings doesn't
+ * resume them. Hibernated clients are pinged every HIBERNATED_HEARTBEAT_INTERVAL_MILLIS only.
+ */
+
+#ifndef C_CHAT_HIBERNATION_H
+#define C_CHAT_HIBERNATION_H
+
+#include "server.h"
+
+/**
+ * \brief Starts the hibernation thread.
+ */
+void hibernation_init();
+
+/**
+ * \brief Stops the hibernation thread.
+ */
+void hibernation_cleanUp();
+
+/**
+ * \brief Waits for the given client to send data, unless it was quiet for long enough to hibernate.
+ *
+ * Called by the client thread once no packet is available, so busy clients aren't polled. Once it
+ * returns 1, the transfers of the client are released and the thread MUST call hibernation_suspend
+ * then end.
+ *
+ * \param client The client to wait data from
+ * \return 0 if data is available, 1 if the client must hibernate
+ */
+int hibernation_waitForData(Client* client);
+
+/**
+ * \brief Hands the given client over to the hibernation thread. Called by the client thread, which then ends.
+ *
+ * \param client The hibernating client
+ * \param id The slot of the client
+ */
+void hibernation_suspend(Client* client, int id);
+
+/**
+ * \brief Retrieves the amount of hibernated clients.
+ *
+ * \return the amount of hibernated clients
+ */
+unsigned int hibernation_count();
+
+#endif //C_CHAT_HIBERNATION_H
@@ -0,0 +1,69 @@
+#include "rate-limit.h"
+#include "communication.h"
+#include <string.h>
+
+void rateLimit_initClient(Client* client) {
+    tokenBucket_init(&client->rateLimits[RATE_LIMIT_TEXT], RATE_LIMIT_TEXT_PER_SECOND, RATE_LIMIT_TEXT_BURST);
+    tokenBucket_init(&client->rateLimits[RATE_LIMIT_COMMAND], RATE_LIMIT_COMMAND_PER_SECOND, RATE_LIMIT_COMMAND_BURST);
+    tokenBucket_init(&client->rateLimits[RATE_LIMIT_FILE_DATA], RATE_LIMIT_FILE_DATA_PER_SECOND, RATE_LIMIT_FILE_DATA_BURST);
+    for (int i = 0; i < RATE_LIMIT_CLASSES; i++) {
+        client->rateLimited[i] = 0;
+    }
+}
+
+/**
+ * \brief Retrieves the rate limit class of the given packet type
+ *
+ * \return the rate limit class or -1 if the packet isn't limited
+ */
+int rateLimitClassOf(char packetType) {
+    switch (packetType) {
+        case TEXT_MESSAGE_TYPE:
+            return RATE_LIMIT_TEXT;
+        case DEFINE_USERNAME_MESSAGE_TYPE:
+        case FILE_UPLOAD_REQUEST_MESSAGE_TYPE:
+        case FILE_DOWNLOAD_REQUEST_MESSAGE_TYPE:
+        case CREATE_ROOM_MESSAGE_TYPE:
+        case JOIN_ROOM_MESSAGE_TYPE:
+        case LEAVE_ROOM_MESSAGE_TYPE:
+        case LIST_ROOMS_MESSAGE_TYPE:
+        case STATS_REQUEST_MESSAGE_TYPE:
+            return RATE_LIMIT_COMMAND;
+        case FILE_DATA_TRANSFER_MESSAGE_TYPE:
+            return RATE_LIMIT_FILE_DATA;
+        default:
+            return -1;
+    }
+}
+
+int rateLimit_admit(Client* client, char packetType) {
+    int limitClass = rateLimitClassOf(packetType);
+    if (limitClass == -1) {
+        return 1;
+    }
+
+    TokenBucket* bucket = &client->rateLimits[limitClass];
+
+    if (limitClass == RATE_LIMIT_FILE_DATA) {
+        unsigned long long delay = tokenBucket_delayFor(bucket, 1);
+        if (delay > 0) {
+            threadSleep(delay);
+        }
+        tokenBucket_tryConsume(bucket, 1);
+        return 1;
+    }
+
+    if (tokenBucket_tryConsume(bucket, 1)) {
+        client->rateLimited[limitClass] = 0;
+        return 1;
+    }
+
+    if (!client->rateLimited[limitClass]) {
+        /* Only telling once, answering each dropped packet would amplify the flood */
+        client->rateLimited[limitClass] = 1;
+        Packet errorPacket = NewPacketServerErrorMessage;
+        memcpy(errorPacket.asServerErrorMessagePacket.message, "You're sending too fast. Slow down.", 36);
+        sendToClient(client, &errorPacket);
+    }
+    return 0;
+}
@@ -0,0 +1,33 @@
+/**
+ * \file rate-limit.h
+ * \brief Limits the rate of packets each client can send
+ */
+
+#ifndef C_CHAT_RATE_LIMIT_H
+#define C_CHAT_RATE_LIMIT_H
+
+#include "server.h"
+
+/**
+ * \brief Initializes the rate limits of the given client
+ *
+ * \param client The client to initialize rate limits of
+ */
+void rateLimit_initClient(Client* client);
+
+/**
+ * \brief Checks whether the given client is allowed to send the given packet now.
+ *
+ * Text messages and commands exceeding the limits are dropped, the client is told once
+ * when it starts being limited.
+ * File data exceeding the limits is delayed : this call blocks the client thread until the
+ * chunk is allowed, which in turn slows the client down through TCP flow control.
+ * Other packets (quit, pong, ...) are never limited.
+ *
+ * \param client The client who sent the packet
+ * \param packetType The type of the received packet
+ * \return 1 if the packet must be processed, 0 if it must be dropped
+ */
+int rateLimit_admit(Client* client, char packetType);
+
+#endif //C_CHAT_RATE_LIMIT_H
@@ -0,0 +1,160 @@
+#include "room-loop.h"
+#include <stdlib.h>
+#include "../common/atomics.h"
+#include "../common/mpsc-queue.h"
+#include "../common/notifier.h"
+#include "room.h"
+
+/**
+ * \brief State of a room loop
+ */
+struct RoomLoop {
+    MpscQueue* inbox;
+    /** Wakes the loop up when tasks are posted */
+    Notifier notifier;
+    /** Closed rooms waiting to be released, only used by the loop thread */
+    Room* closedRooms;
+    /** Equal to 1 once the loop must stop, else 0 */
+    volatile unsigned int stopping;
+    Thread thread;
+};
+
+struct RoomLoop loops[ROOM_LOOP_THREADS];
+
+/** Loop the next room is pinned to */
+volatile unsigned int nextLoop = 0;
+
+/**
+ * \brief Releases rooms closed by the given loop. No task referencing them must be left in the inbox.
+ */
+void roomLoops_releaseClosedRooms(struct RoomLoop* loop) {
+    while (loop->closedRooms != NULL) {
+        Room* room = loop->closedRooms;
+        loop->closedRooms = room->nextClosed;
+        destroyRoom(room);
+    }
+}
+
+/**
+ * \brief Entry point of a room loop thread.
+ *
+ * \param data The loop state
+ */
+THREAD_ENTRY_POINT roomLoops_run(void* data) {
+    struct RoomLoop* loop = data;
+
+    while (!atomics_load(&loop->stopping)) {
+        RoomTask* task = mpsc_pop(loop->inbox);
+        if (task != NULL) {
+            task->run(task);
+            if (task->done != NULL) {
+                signalEvent(*task->done);
+            }
+            free(task->data);
+            free(task);
+            continue;
+        }
+
+        /* Tasks referencing closed rooms were all posted before they were closed, they're all run */
+        roomLoops_releaseClosedRooms(loop);
+
+        notifier_prepareWait(&loop->notifier);
+        if (mpsc_isEmpty(loop->inbox) && !atomics_load(&loop->stopping)) {
+            notifier_wait(&loop->notifier);
+        } else {
+            notifier_cancelWait(&loop->notifier);
+        }
+    }
+
+    return 0;
+}
+
+void roomLoops_init() {
+    for (int i = 0; i < ROOM_LOOP_THREADS; i++) {
+        loops[i].inbox = mpsc_create(ROOM_LOOP_INBOX_CAPACITY);
+        notifier_init(&loops[i].notifier);
+        loops[i].closedRooms = NULL;
+        loops[i].stopping = 0;
+        loops[i].thread = createThread(roomLoops_run, &loops[i]);
+    }
+}
+
+void roomLoops_cleanUp() {
+    for (int i = 0; i < ROOM_LOOP_THREADS; i++) {
+        atomics_store(&loops[i].stopping, 1);
+        notifier_notify(&loops[i].notifier);
+        joinThread(&loops[i].thread);
+
+        RoomTask* task;
+        while ((task = mpsc_pop(loops[i].inbox)) != NULL) {
+            free(task->data);
+            free(task);
+        }
+        roomLoops_releaseClosedRooms(&loops[i]);
+        mpsc_destroy(loops[i].inbox);
+        notifier_destroy(&loops[i].notifier);
+    }
+}
+
+unsigned int roomLoops_assign() {
+    return atomics_fetchAdd(&nextLoop, 1) % ROOM_LOOP_THREADS;
+}
+
+RoomTask* roomLoops_newTask(ROOM_TASK_FUNCTION run, Room* room, Client* client) {
+    RoomTask* task = malloc(sizeof(RoomTask));
+    task->run = run;
+    task->room = room;
+    task->client = client;
+    task->spectator = NULL;
+    task->data = NULL;
+    task->done = NULL;
+    return task;
+}
+
+/**
+ * \brief Posts the given task to the given loop.
+ */
+int roomLoops_postTo(struct RoomLoop* loop, RoomTask* task) {
+    if (!mpsc_push(loop->inbox, task)) {
+        free(task->data);
+        free(task);
+        return 0;
+    }
+    notifier_notify(&loop->notifier);
+    return 1;
+}
+
+int roomLoops_post(RoomTask* task) {
+    return roomLoops_postTo(&loops[task->room->loop], task);
+}
+
+int roomLoops_postToLoop(unsigned int loop, RoomTask* task) {
+    return roomLoops_postTo(&loops[loop % ROOM_LOOP_THREADS], task);
+}
+
+/**
+ * \brief A task doing nothing, used to know when the tasks posted before it were run.
+ */
+void roomLoops_barrier(RoomTask* task) {
+    (void) task;
+}
+
+void roomLoops_flush(Event done) {
+    for (int i = 0; i < ROOM_LOOP_THREADS; i++) {
+        RoomTask* task = roomLoops_newTask(roomLoops_barrier, NULL, NULL);
+        task->done = &done;
+        while (!roomLoops_postTo(&loops[i], task)) {
+            /* The inbox is full, waiting for the loop to catch up */
+            threadSleep(1);
+            task = roomLoops_newTask(roomLoops_barrier, NULL, NULL);
+            task->done = &done;
+        }
+        waitEvent(done);
+    }
+}
+
+void roomLoops_closeRoom(Room* room) {
+    room->closed = 1;
+    room->nextClosed = loops[room->loop].closedRooms;
+    loops[room->loop].closedRooms = room;
+}
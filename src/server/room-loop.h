@@ -0,0 +1,117 @@
+/**
+ * \file room-loop.h
+ * \brief Event loops owning rooms : every room operation is run by the loop the room is pinned to.
+ *
+ * ROOM_LOOP_THREADS loops are started, each one with an inbox (see mpsc-queue.h). A room is
+ * pinned to one loop when it's created, rooms being spread across loops in turn. Operations on
+ * a room (joining, leaving, relaying a packet, ...) are posted as tasks to the inbox of its loop,
+ * so the members of a room are only ever accessed by a single thread, without any lock, and
+ * rooms are processed in parallel.
+ *
+ * Tasks of a loop are run in the order they were posted. A task referencing a room MUST be posted
+ * while holding the lock the room was found through (clientsLock for client->room, roomsLock for
+ * the rooms array) : a room is closed under these locks and released once its loop has run all
+ * the tasks posted before, so tasks never reference a released room. They still have to check
+ * whether the room is closed.
+ */
+
+#ifndef C_CHAT_ROOM_LOOP_H
+#define C_CHAT_ROOM_LOOP_H
+
+#include "server.h"
+
+struct RoomTask;
+
+/**
+ * \brief The type of a function run by a room loop.
+ */
+typedef void (*ROOM_TASK_FUNCTION)(struct RoomTask* task);
+
+/**
+ * \class RoomTask
+ * \brief An operation to run on a room
+ */
+typedef struct RoomTask {
+    /** The function to run */
+    ROOM_TASK_FUNCTION run;
+    /** The room to run the operation on */
+    Room* room;
+    /** The client who asked for the operation, can be NULL */
+    Client* client;
+    /** The spectator who asked for the operation, can be NULL */
+    Spectator* spectator;
+    /** A packet to relay, depending on the operation */
+    Packet packet;
+    /** Heap-allocated data of the operation, can be NULL. Released with the task */
+    void* data;
+    /** Signaled once the task was run, can be NULL */
+    Event* done;
+} RoomTask;
+
+/**
+ * \brief Starts the room loops.
+ */
+void roomLoops_init();
+
+/**
+ * \brief Stops the room loops. Tasks still posted are dropped.
+ */
+void roomLoops_cleanUp();
+
+/**
+ * \brief Picks the loop a new room is pinned to.
+ *
+ * \return a loop index, to store in room->loop
+ */
+unsigned int roomLoops_assign();
+
+/**
+ * \brief Creates a task, to be posted using roomLoops_post.
+ *
+ * \param run The function to run
+ * \param room The room to run the function on
+ * \param client The client who asked for the operation, can be NULL
+ * \return a heap-allocated task, released once run
+ */
+RoomTask* roomLoops_newTask(ROOM_TASK_FUNCTION run, Room* room, Client* client);
+
+/**
+ * \brief Posts the given task to the loop of its room. Never blocks.
+ *
+ * To wait for the task to be run, set its done field and wait for the event once the lock
+ * the room was found through is released.
+ *
+ * \param task The task to post
+ * \return 1 if the task was posted, 0 if the inbox of the loop is full (the task is released)
+ */
+int roomLoops_post(RoomTask* task);
+
+/**
+ * \brief Posts the given task to the given loop, whatever its room. Never blocks.
+ *
+ * It's meant for tasks which don't reference a room, such as sending packets on behalf of a loop.
+ *
+ * \param loop The loop index, taken modulo ROOM_LOOP_THREADS
+ * \param task The task to post
+ * \return 1 if the task was posted, 0 if the inbox of the loop is full (the task is released)
+ */
+int roomLoops_postToLoop(unsigned int loop, RoomTask* task);
+
+/**
+ * \brief Waits for all loops to run the tasks posted before this call.
+ *
+ * \param done An event to wait for
+ */
+void roomLoops_flush(Event done);
+
+/**
+ * \brief Closes the given room. It MUST be called by the loop of the room, holding clientsLock and roomsLock.
+ *
+ * Once closed, the room can't be found anymore. It's released when its loop has run the tasks
+ * posted until now.
+ *
+ * \param room The room to close
+ */
+void roomLoops_closeRoom(Room* room);
+
+#endif //C_CHAT_ROOM_LOOP_H
@@ -4,31 +4,98 @@
 #include "communication.h"
 #include <stdio.h>
 #include "client-info.h"
+#include "room-loop.h"
 
 int findFirstFreeRoomSlot() {
-    int i = 0;
-    while (i < NUMBER_ROOM_MAX && rooms[i] != NULL) {
-        i++;
+    return bitmap_acquire(roomSlots, NUMBER_ROOM_MAX);
+}
+
+/**
+ * \brief Adds the given client to the members of the given room, which MUST NOT be full. Run by the room loop.
+ */
+void addRoomMember(Room *room, Client *client) {
+    /* Filling lanes evenly so broadcasts are evenly spread across loops */
+    unsigned int laneIndex = 0;
+    for (unsigned int i = 1; i < room->laneCount; i++) {
+        if (room->lanes[i].count < room->lanes[laneIndex].count) {
+            laneIndex = i;
+        }
     }
-    return i == NUMBER_ROOM_MAX ? -1 : i;
+
+    RoomLane* lane = &room->lanes[laneIndex];
+    if (lane->count == lane->capacity) {
+        lane->capacity = lane->capacity ? lane->capacity * 2 : ROOM_LANE_INITIAL_CAPACITY;
+        lane->outbounds = realloc(lane->outbounds, sizeof(Outbound*) * lane->capacity);
+        lane->members = realloc(lane->members, sizeof(Client*) * lane->capacity);
+    }
+
+    client->roomLane = laneIndex;
+    client->roomSlot = lane->count;
+    lane->members[lane->count] = client;
+    lane->outbounds[lane->count] = &client->outbound;
+    lane->count++;
+    room->memberCount++;
 }
 
-int findFirstFreeSlotForRoom(Room *room) {
-    int i = 0;
-    while (i < MAX_USERS_PER_ROOM && room->clients[i] != NULL) {
-        i++;
+/**
+ * \brief Removes the given client from the members of the given room. Run by the room loop.
+ */
+void removeRoomMember(Room *room, Client *client) {
+    RoomLane* lane = &room->lanes[client->roomLane];
+
+    /* Moving the last member of the lane to the freed slot keeps members packed */
+    unsigned int slot = client->roomSlot;
+    lane->count--;
+    Client* last = lane->members[lane->count];
+    lane->members[slot] = last;
+    lane->outbounds[slot] = lane->outbounds[lane->count];
+    last->roomSlot = slot;
+    room->memberCount--;
+}
+
+void addRoomSpectator(Room *room, Spectator *spectator) {
+    /* Spectators are spread across all lanes, whatever the kind of room, balancing the packets sent by each loop */
+    unsigned int laneIndex = 0;
+    for (unsigned int i = 1; i < ROOM_LOOP_THREADS; i++) {
+        RoomLane* lane = &room->lanes[i];
+        RoomLane* picked = &room->lanes[laneIndex];
+        if (lane->count + lane->spectatorCount < picked->count + picked->spectatorCount) {
+            laneIndex = i;
+        }
+    }
+
+    RoomLane* lane = &room->lanes[laneIndex];
+    if (lane->spectatorCount == lane->spectatorCapacity) {
+        lane->spectatorCapacity = lane->spectatorCapacity ? lane->spectatorCapacity * 2 : ROOM_LANE_INITIAL_CAPACITY;
+        lane->spectators = realloc(lane->spectators, sizeof(Spectator*) * lane->spectatorCapacity);
     }
 
-    return i == MAX_USERS_PER_ROOM ? -1 : i;
+    spectator->roomLane = laneIndex;
+    spectator->roomSlot = lane->spectatorCount;
+    lane->spectators[lane->spectatorCount] = spectator;
+    lane->spectatorCount++;
+    room->spectatorCount++;
+}
+
+void removeRoomSpectator(Room *room, Spectator *spectator) {
+    RoomLane* lane = &room->lanes[spectator->roomLane];
+
+    unsigned int slot = spectator->roomSlot;
+    lane->spectatorCount--;
+    Spectator* last = lane->spectators[lane->spectatorCount];
+    lane->spectators[slot] = last;
+    last->roomSlot = slot;
+    room->spectatorCount--;
 }
 
 Room *findRoomByName(const char *roomName) {
-    int i = 0;
-    while (i < NUMBER_ROOM_MAX && (rooms[i] == NULL || strcmp(rooms[i]->name, roomName) != 0)) {
-        i++;
+    for (int i = bitmap_next(roomSlots, NUMBER_ROOM_MAX, 0); i != -1; i = bitmap_next(roomSlots, NUMBER_ROOM_MAX, i + 1)) {
+        if (strcmp(rooms[i]->name, roomName) == 0) {
+            return rooms[i];
+        }
     }
 
-    return i == NUMBER_ROOM_MAX ? NULL : rooms[i];
+    return NULL;
 }
 
 int findRoomId(Room *room) {
@@ -48,24 +115,43 @@ int findRoomId(Room *room) {
  * \param owner The owner of the room
  * \param name The name of the room
  * \param description The description of the room
+ * \param large 1 to create a large room, else 0
  * \return the newly created room
  */
-Room *createRoom(Client *owner, const char *name, const char *description) {
-    Room *room = malloc(sizeof(Room));
+Room *createRoom(Client *owner, const char *name, const char *description, short large) {
+    Room *room = slab_alloc(roomSlab);
     memcpy(room->name, name, ROOM_NAME_MAX_LENGTH + 1);
     memcpy(room->description, description, ROOM_DESC_MAX_LENGTH + 1);
     room->owner = owner;
-    room->lock = createReadWriteLock();
-    room->clients[0] = owner;
-    for (int i = 1; i < MAX_USERS_PER_ROOM; i++) {
-        room->clients[i] = NULL;
+    room->loop = roomLoops_assign();
+    room->closed = 0;
+    room->nextClosed = NULL;
+    room->large = large;
+    room->memberCount = 0;
+    room->maxMembers = large ? LARGE_ROOM_MAX_USERS : MAX_USERS_PER_ROOM;
+    room->laneCount = large ? ROOM_LOOP_THREADS : 1;
+    room->spectatorCount = 0;
+    /* Arrays of lanes are allocated when the first member or spectator joins them */
+    for (unsigned int i = 0; i < ROOM_LOOP_THREADS; i++) {
+        room->lanes[i].count = 0;
+        room->lanes[i].capacity = 0;
+        room->lanes[i].outbounds = NULL;
+        room->lanes[i].members = NULL;
+        room->lanes[i].spectatorCount = 0;
+        room->lanes[i].spectatorCapacity = 0;
+        room->lanes[i].spectators = NULL;
     }
+    addRoomMember(room, owner);
     return room;
 }
 
 void destroyRoom(Room *room) {
-    destroyReadWriteLock(room->lock);
-    free(room);
+    for (unsigned int i = 0; i < ROOM_LOOP_THREADS; i++) {
+        free(room->lanes[i].outbounds);
+        free(room->lanes[i].members);
+        free(room->lanes[i].spectators);
+    }
+    slab_free(roomSlab, room);
 }
 
 /**
@@ -99,159 +185,234 @@ void handleRoomCreationRequest(Client *client, struct PacketCreateRoom *packet)
     if (isInRoom) {
         Packet errorPacket = NewPacketServerErrorMessage;
         memcpy(errorPacket.asServerErrorMessagePacket.message, "You're already in a room. First leave the room.", 48);
-        sendPacket(client->socket, &errorPacket);
+        sendToClient(client, &errorPacket);
     } else if (strlen(packet->roomName) == 0) {
         Packet errorPacket = NewPacketServerErrorMessage;
         memcpy(errorPacket.asServerErrorMessagePacket.message, "The room name can't be empty.", 30);
-        sendPacket(client->socket, &errorPacket);
+        sendToClient(client, &errorPacket);
     } else {
-        Room *room = createRoom(client, packet->roomName, packet->roomDesc);
+        Room *room = createRoom(client, packet->roomName, packet->roomDesc, packet->large != 0);
         SYNC_ROOMS_WRITE(int error = tryInsertRoom(room));
         if (error == 1) {
             destroyRoom(room);
             Packet errorPacket = NewPacketServerErrorMessage;
             memcpy(errorPacket.asServerErrorMessagePacket.message, "This room name is already used.", 32);
-            sendPacket(client->socket, &errorPacket);
+            sendToClient(client, &errorPacket);
         } else if (error == 2) {
             destroyRoom(room);
             Packet errorPacket = NewPacketServerErrorMessage;
             memcpy(errorPacket.asServerErrorMessagePacket.message, "The maximum amount of rooms is reached.", 40);
-            sendPacket(client->socket, &errorPacket);
+            sendToClient(client, &errorPacket);
         } else {
-            client->room = room; // SAFE, because we are room owner
+            SYNC_CLIENT_WRITE(client->room = room);
             Packet joinPacket = NewPacketJoin;
             getClientUsername(client, joinPacket.asJoinPacket.username);
-            sendPacket(client->socket, &joinPacket);
+            sendToClient(client, &joinPacket);
         }
     }
 }
 
-void handleRoomJoinRequest(Client *client, struct PacketJoinRoom *packet) {
-    acquireRead(clientsLock);
-    if (client->room != NULL) {
-        releaseRead(clientsLock);
+/**
+ * \brief Sends an error message to the given client
+ */
+void sendRoomError(Client* client, const char* message) {
+    Packet errorPacket = NewPacketServerErrorMessage;
+    memcpy(errorPacket.asServerErrorMessagePacket.message, message, strlen(message) + 1);
+    sendToClient(client, &errorPacket);
+}
 
-        Packet errorPacket = NewPacketServerErrorMessage;
-        memcpy(errorPacket.asServerErrorMessagePacket.message, "You're already in a room. First leave the room.", 48);
-        sendPacket(client->socket, &errorPacket);
+/**
+ * \brief Adds the client of the task to the room of the task. Run by the room loop.
+ */
+void joinRoom(RoomTask* task) {
+    Room* room = task->room;
+    Client* client = task->client;
+
+    if (room->closed) {
+        sendRoomError(client, "This room does not exist.");
         return;
     }
-    releaseRead(clientsLock);
 
-    acquireRead(roomsLock);
-    Room *room = findRoomByName(packet->roomName);
-    if (room == NULL) {
-        releaseRead(roomsLock);
-
-        Packet errorPacket = NewPacketServerErrorMessage;
-        memcpy(errorPacket.asServerErrorMessagePacket.message, "This room does not exist.", 26);
-        sendPacket(client->socket, &errorPacket);
+    if (room->memberCount == room->maxMembers) {
+        sendRoomError(client, "This room is full.");
         return;
     }
 
-    acquireWrite(room->lock);
-    releaseRead(roomsLock);
+    SYNC_CLIENT_WRITE(client->room = room);
+    addRoomMember(room, client);
 
-    int slot = findFirstFreeSlotForRoom(room);
-    if (slot == -1) {
-        releaseWrite(room->lock);
+    Packet joinPacket = NewPacketJoin;
+    getClientUsername(client, joinPacket.asJoinPacket.username);
 
-        Packet errorPacket = NewPacketServerErrorMessage;
-        memcpy(errorPacket.asServerErrorMessagePacket.message, "This room is full.", 19);
-        sendPacket(client->socket, &errorPacket);
+    /* Members of a large room aren't told about each other, so joining doesn't cost a broadcast */
+    if (room->large) {
+        sendToClient(client, &joinPacket);
+    } else {
+        broadcastRoom(&joinPacket, room);
+    }
+}
+
+void handleRoomJoinRequest(Client *client, struct PacketJoinRoom *packet) {
+    SYNC_CLIENT_READ(int isInRoom = client->room != NULL);
+    if (isInRoom) {
+        sendRoomError(client, "You're already in a room. First leave the room.");
         return;
     }
 
-    client->room = room;
-    room->clients[slot] = client;
-    releaseWrite(room->lock);
+    acquireRead(roomsLock);
+    Room *room = findRoomByName(packet->roomName);
+    if (room == NULL) {
+        releaseRead(roomsLock);
+        sendRoomError(client, "This room does not exist.");
+        return;
+    }
 
-    Packet joinPacket = NewPacketJoin;
-    getClientUsername(client, joinPacket.asJoinPacket.username);
+    RoomTask* task = roomLoops_newTask(joinRoom, room, client);
+    task->done = &client->roomTaskDone;
+    int posted = roomLoops_post(task);
+    releaseRead(roomsLock);
 
-    syncBroadcastRoom(&joinPacket, room);
+    if (posted) {
+        waitEvent(client->roomTaskDone);
+    } else {
+        sendRoomError(client, "The server is busy. Try again.");
+    }
 }
 
-void handleRoomLeaveRequest(Client *client) {
+/**
+ * \brief Removes the client of the task from the room of the task, disbanding the room if
+ * the client is the owner. Run by the room loop.
+ */
+void leaveRoom(RoomTask* task) {
+    Room* room = task->room;
+    Client* client = task->client;
+
     acquireWrite(clientsLock);
-    Room *room = client->room;
 
-    if (room == NULL) {
-        releaseRead(clientsLock);
-        Packet errorPacket = NewPacketServerErrorMessage;
-        memcpy(errorPacket.asServerErrorMessagePacket.message, "You're not in a room.", 48);
-        sendPacket(client->socket, &errorPacket);
+    /* The room may have been left or disbanded since the task was posted */
+    if (room->closed || client->room != room) {
+        releaseWrite(clientsLock);
         return;
     }
 
-    acquireWrite(room->lock);
-
     if (client == room->owner) {
         Packet leavePacket = NewPacketLeave;
-        for (int i = 0; i < MAX_USERS_PER_ROOM; i++) {
-            if (room->clients[i] != NULL) {
-                memcpy(leavePacket.asLeavePacket.username, room->clients[i]->username, USERNAME_MAX_LENGTH + 1);
-                broadcastRoom(&leavePacket, room);
-                room->clients[i]->room = NULL;
+        for (unsigned int i = 0; i < room->laneCount; i++) {
+            RoomLane* lane = &room->lanes[i];
+            for (unsigned int j = 0; j < lane->count; j++) {
+                memcpy(leavePacket.asLeavePacket.username, lane->members[j]->username, USERNAME_MAX_LENGTH + 1);
+                if (room->large) {
+                    sendToClient(lane->members[j], &leavePacket);
+                } else {
+                    broadcastRoom(&leavePacket, room);
+                }
+                lane->members[j]->room = NULL;
+            }
+        }
+
+        /* Spectators have nothing left to watch, the spectators thread releases them once disconnected */
+        for (unsigned int i = 0; i < ROOM_LOOP_THREADS; i++) {
+            RoomLane* lane = &room->lanes[i];
+            for (unsigned int j = 0; j < lane->spectatorCount; j++) {
+                lane->spectators[j]->room = NULL;
+                shutdownSocket(lane->spectators[j]->socket);
             }
         }
-        releaseWrite(clientsLock);
 
         SYNC_ROOMS_WRITE(
             int roomId = findRoomId(room);
             rooms[roomId] = NULL;
+            bitmap_release(roomSlots, roomId);
+            roomLoops_closeRoom(room);
         );
-
-        releaseWrite(room->lock);
-        destroyReadWriteLock(room->lock);
-        free(rooms[roomId]);
+        releaseWrite(clientsLock);
     } else {
         client->room = NULL;
         releaseWrite(clientsLock);
 
         Packet leavePacket = NewPacketLeave;
-        memcpy(leavePacket.asLeavePacket.username, client->username, USERNAME_MAX_LENGTH + 1);
-        broadcastRoom(&leavePacket, room);
+        getClientUsername(client, leavePacket.asLeavePacket.username);
+        if (room->large) {
+            sendToClient(client, &leavePacket);
+        } else {
+            broadcastRoom(&leavePacket, room);
+        }
+
+        removeRoomMember(room, client);
+    }
+}
 
-        int slot = 0;
-        while (slot < MAX_USERS_PER_ROOM && room->clients[slot] != client) {
-            slot++;
+/**
+ * \brief Posts a task removing the given client from its room, then waits until it's run.
+ *
+ * \param retry Equal to 1 to wait for the loop to catch up while its inbox is full, else 0
+ * \return 1 if the client left its room, 0 if it isn't in a room, -1 if the inbox of the loop is full
+ */
+int leaveCurrentRoom(Client* client, int retry) {
+    while (1) {
+        acquireRead(clientsLock);
+        Room *room = client->room;
+
+        if (room == NULL) {
+            releaseRead(clientsLock);
+            return 0;
         }
 
-        if (slot < MAX_USERS_PER_ROOM) { // Should always be true
-            room->clients[slot] = NULL;
+        RoomTask* task = roomLoops_newTask(leaveRoom, room, client);
+        task->done = &client->roomTaskDone;
+        int posted = roomLoops_post(task);
+        /* Released before retrying : the loop takes clientsLock for writing to run leave tasks */
+        releaseRead(clientsLock);
+
+        if (posted) {
+            waitEvent(client->roomTaskDone);
+            return 1;
         }
+        if (!retry) {
+            return -1;
+        }
+        threadSleep(1);
+    }
+}
 
-        releaseWrite(room->lock);
+void handleRoomLeaveRequest(Client *client) {
+    int left = leaveCurrentRoom(client, 0);
+    if (left == 0) {
+        sendRoomError(client, "You're not in a room.");
+    } else if (left == -1) {
+        sendRoomError(client, "The server is busy. Try again.");
     }
 }
 
+void leaveRoomOnDisconnect(Client* client) {
+    /* The client is freed afterwards : it MUST NOT stay a member of the room, whatever the load */
+    leaveCurrentRoom(client, 1);
+}
+
 void handleRoomListRequest(Client* client) {
     Packet packet = NewPacketServerSuccess;
     memcpy(packet.asServerSuccessMessagePacket.message, "List of rooms :", 19);
-    sendPacket(client->socket, &packet);
+    sendToClient(client, &packet);
     unsigned int total = 0;
     SYNC_ROOMS_READ(
-            for (int i = 0; i < NUMBER_ROOM_MAX; i++) {
+            for (int i = bitmap_next(roomSlots, NUMBER_ROOM_MAX, 0); i != -1; i = bitmap_next(roomSlots, NUMBER_ROOM_MAX, i + 1)) {
                 Room* room = rooms[i];
-                if (room != NULL) {
-                    unsigned int nameLength = strlen(room->name);
-                    unsigned int descriptionLength = strlen(room->description);
-                    memcpy(packet.asServerSuccessMessagePacket.message, room->name, nameLength);
-                    if (descriptionLength) {
-                        memcpy(packet.asServerSuccessMessagePacket.message + nameLength, " : ", 3);
-                        memcpy(packet.asServerSuccessMessagePacket.message + nameLength + 3, room->description, descriptionLength + 1);
-                    } else {
-                        packet.asServerSuccessMessagePacket.message[nameLength + 3] = '\0';
-                    }
-                    sendPacket(client->socket, &packet);
-                    total++;
+                unsigned int nameLength = strlen(room->name);
+                unsigned int descriptionLength = strlen(room->description);
+                memcpy(packet.asServerSuccessMessagePacket.message, room->name, nameLength);
+                if (descriptionLength) {
+                    memcpy(packet.asServerSuccessMessagePacket.message + nameLength, " : ", 3);
+                    memcpy(packet.asServerSuccessMessagePacket.message + nameLength + 3, room->description, descriptionLength + 1);
+                } else {
+                    packet.asServerSuccessMessagePacket.message[nameLength + 3] = '\0';
                 }
+                sendToClient(client, &packet);
+                total++;
             }
     );
     if (total == 0) {
         packet = NewPacketServerErrorMessage;
         memcpy(packet.asServerErrorMessagePacket.message, "No rooms.", 10);
-        sendPacket(client->socket, &packet);
+        sendToClient(client, &packet);
     }
 }
\ No newline at end of file
@@ -14,6 +14,8 @@ void handleRoomCreationRequest(Client* client, struct PacketCreateRoom* packet);
 /**
  * \brief Processes a received PacketJoinRoom
  *
+ * The client is added to the room by the room loop, this function waits for it.
+ *
  * \param client The client who sent the packet
  * \param packet The received packet
  */
@@ -22,10 +24,23 @@ void handleRoomJoinRequest(Client* client, struct PacketJoinRoom* packet);
 /**
  * \brief Processes a received PacketLeaveRoom
  *
+ * The client is removed from the room by the room loop, this function waits for it.
+ * Once it returns, the room loop doesn't use the client anymore.
+ *
  * \param client The client who sent the packet
  */
 void handleRoomLeaveRequest(Client* client);
 
+/**
+ * \brief Removes the given disconnecting client from its room, if it's in one
+ *
+ * Unlike handleRoomLeaveRequest, it waits for the room loop to catch up if it's busy.
+ * Once it returns, the room loop doesn't use the client anymore.
+ *
+ * \param client The disconnecting client
+ */
+void leaveRoomOnDisconnect(Client* client);
+
 /**
  * \brief Processes a received PacketListRooms
  *
@@ -33,6 +48,30 @@ void handleRoomLeaveRequest(Client* client);
  */
 void handleRoomListRequest(Client* client);
 
+/**
+ * \brief Finds the room with the given name. roomsLock MUST be acquired.
+ *
+ * \param roomName The name of the room
+ * \return the room, NULL if no room has this name
+ */
+Room* findRoomByName(const char* roomName);
+
+/**
+ * \brief Adds the given spectator to the given room. Run by the room loop.
+ *
+ * \param room The room to watch
+ * \param spectator The spectator
+ */
+void addRoomSpectator(Room* room, Spectator* spectator);
+
+/**
+ * \brief Removes the given spectator from the given room. Run by the room loop.
+ *
+ * \param room The watched room
+ * \param spectator The spectator
+ */
+void removeRoomSpectator(Room* room, Spectator* spectator);
+
 /**
  * \brief Destroys allocated resources for the given room
  *
@@ -17,13 +17,40 @@
 #include "client-info.h"
 #include "file-transfer.h"
 #include "room.h"
+#include "timeouts.h"
+#include "stats.h"
+#include "rate-limit.h"
+#include "room-loop.h"
+#include "spectator.h"
+#include "hibernation.h"
+#include "upload-budget.h"
+#include "transfer-scheduler.h"
+#include "../common/crc32c.h"
+#include "../common/interop.h"
 
 ReadWriteLock clientsLock;
 ReadWriteLock roomsLock;
 Client* clients[NUMBER_CLIENT_MAX] = {NULL};
 Room* rooms[NUMBER_ROOM_MAX] = {NULL};
+BitmapWord clientSlots[BITMAP_WORDS(NUMBER_CLIENT_MAX)] = {0};
+BitmapWord roomSlots[BITMAP_WORDS(NUMBER_ROOM_MAX)] = {0};
+Slab* clientSlab;
+Slab* roomSlab;
+Slab* spectatorSlab;
+/** Set by the signal handler, the main thread closes the server once it sees it */
+static volatile sig_atomic_t closeRequested = 0;
 
 void handleServerClose(int signal) {
+    (void) signal;
+    closeRequested = 1;
+}
+
+void closeServer() {
+    spectator_cleanUp();
+    hibernation_cleanUp();
+    transferScheduler_cleanUp();
+    timeouts_cleanUp();
+    roomLoops_cleanUp();
     for (int i = 0; i < NUMBER_CLIENT_MAX; i++) {
         Client* client = clients[i];
         if (client != NULL) {
@@ -31,13 +58,10 @@ void handleServerClose(int signal) {
             closeSocket(&(client->socket));
             destroyThread(&(client->thread));
 
-            for (int j = 0; j < MAX_CONCURRENT_FILE_TRANSFER; j++) {
-                if (client->uploadData[j].fileContent != NULL) {
-                    free(client->uploadData[j].fileContent);
-                }
-            }
+            freeClientTransfers(client);
+            destroyEvent(client->roomTaskDone);
 
-            free(client);
+            slab_free(clientSlab, client);
         }
     }
     for (int i = 0; i < NUMBER_ROOM_MAX; i++) {
@@ -45,20 +69,35 @@ void handleServerClose(int signal) {
             destroyRoom(rooms[i]);
         }
     }
+    slab_destroy(clientSlab);
+    slab_destroy(roomSlab);
+    slab_destroy(spectatorSlab);
     cleanUp();
-    fileTransfer_cleanUp();
     destroyReadWriteLock(clientsLock);
     destroyReadWriteLock(roomsLock);
     printf("Server closed.\n");
     exit(EXIT_SUCCESS);
 }
 
-void handleClientsPackets(Client* client) {
+int handleClientsPackets(Client* client) {
     Packet packet;
     int bytesReceived;
     do {
-        bytesReceived = receiveNextPacket(client->socket, &packet);
+        /* The socket is only polled once it's quiet, a busy client costs no more than its receives */
+        bytesReceived = receiveAvailablePacket(client->socket, &packet);
+        if (bytesReceived == SOCKET_WOULD_BLOCK) {
+            if (CLIENT_HIBERNATION_DELAY_MILLIS > 0 && hibernation_waitForData(client)) {
+                return 1;
+            }
+            bytesReceived = receiveNextPacket(client->socket, &packet);
+        }
         if (bytesReceived > 0) {
+            if (packet.type != PONG_MESSAGE_TYPE) {
+                atomics_store64(&client->lastActivity, timers_now());
+            }
+            if (!rateLimit_admit(client, packet.type)) {
+                continue;
+            }
             switch(packet.type) {
                 case TEXT_MESSAGE_TYPE:
                     handleTextMessageRelay(client, &packet.asTextPacket);
@@ -67,13 +106,16 @@ void handleClientsPackets(Client* client) {
                     handleUsernameChange(client, &packet.asDefineUsernamePacket);
                     break;
                 case QUIT_MESSAGE_TYPE:
-                    return; // Other option is to set bytesReceived to -1, but we want to keep semantic of variable
+                    return 0; // Other option is to set bytesReceived to -1, but we want to keep semantic of variable
                 case FILE_UPLOAD_REQUEST_MESSAGE_TYPE:
                     handleUploadRequest(client, &packet.asFileUploadRequestPacket);
                     break;
                 case FILE_DATA_TRANSFER_MESSAGE_TYPE:
                     handleFileDataUpload(client, &packet.asFileDataTransferPacket);
                     break;
+                case FILE_UPLOAD_DIGEST_MESSAGE_TYPE:
+                    handleFileUploadDigest(client, &packet.asFileUploadDigestPacket);
+                    break;
                 case FILE_DOWNLOAD_REQUEST_MESSAGE_TYPE:
                     handleDownloadRequest(client, &packet.asFileDownloadRequestPacket);
                     break;
@@ -89,12 +131,36 @@ void handleClientsPackets(Client* client) {
                 case LIST_ROOMS_MESSAGE_TYPE:
                     handleRoomListRequest(client);
                     break;
+                case PONG_MESSAGE_TYPE:
+                    handlePong(client, &packet.asPongPacket);
+                    break;
+                case STATS_REQUEST_MESSAGE_TYPE:
+                    handleStatsRequest(client);
+                    break;
+                case FILE_DATA_ACK_MESSAGE_TYPE:
+                    handleFileDataAck(client, &packet.asFileDataAckPacket);
+                    break;
+                case FILE_TRANSFER_CANCEL_MESSAGE_TYPE:
+                    handleDownloadCancel(client, &packet.asFileTransferCancelPacket);
+                    break;
                 default:
                     printf("Received a packet of type %d. Can't handle this type of packet.\n", packet.type);
                     break;
             }
         }
-    } while (bytesReceived >= 0);
+    } while (bytesReceived > 0);
+
+    return 0;
+}
+
+void serveClient(Client* client, int id) {
+    if (handleClientsPackets(client)) {
+        /* The thread ends, the hibernation thread starts a new one once the client sends data */
+        hibernation_suspend(client, id);
+        return;
+    }
+
+    disconnectClient(id);
 }
 
 THREAD_ENTRY_POINT clientThread(void* idPnt) {
@@ -104,14 +170,20 @@ THREAD_ENTRY_POINT clientThread(void* idPnt) {
 
     Client* client = clients[id];
 
-    int success = initClientConnection(client);
+    char spectatedRoom[ROOM_NAME_MAX_LENGTH + 1];
+    int success = initClientConnection(client, spectatedRoom);
     if (success == EXIT_FAILURE) {
         disconnectClient(id);
         return EXIT_FAILURE;
     }
 
-    handleClientsPackets(client);
-    disconnectClient(id);
+    /* A spectator doesn't need a client slot : the spectators thread takes it over once the client is released */
+    if (spectatedRoom[0] != '\0') {
+        spectator_watch(handOverConnection(id), spectatedRoom);
+        return EXIT_SUCCESS;
+    }
+
+    serveClient(client, id);
 
     return EXIT_SUCCESS;
 }
@@ -124,20 +196,37 @@ int main () {
     Socket serverSocket = createServerSocket("27015");
     /* Capture interruption signal to be able to cleanup allocated resources when server stops */
     signal(SIGINT, handleServerClose);
+#if IS_POSIX
+    /* Writing to a connection closed by a timeout must fail instead of killing the server */
+    signal(SIGPIPE, SIG_IGN);
+#endif
 
     /* Initialize systems */
     clientsLock = createReadWriteLock();
     roomsLock = createReadWriteLock();
-    fileTransfer_init();
+    clientSlab = slab_create(sizeof(Client));
+    roomSlab = slab_create(sizeof(Room));
+    spectatorSlab = slab_create(sizeof(Spectator));
+    timeouts_init();
+    crc32c_init();
+    initFileTransfers();
+    uploadBudget_init();
+    transferScheduler_init();
+    roomLoops_init();
+    hibernation_init();
+    spectator_init();
 
     printf("Server ready to accept connections.\n");
 
-    while(1) {
-        /* Waiting for a client to connect */
+    while(!closeRequested) {
+        /* Waiting for a client to connect, checking regularly whether the server closes */
+        if (waitForData(&serverSocket, 1, NULL, ACCEPT_POLL_MILLIS) <= 0) {
+            continue;
+        }
         Socket clientSocket = acceptClient(serverSocket);
 
-        /* Looking for a valid id for connected client */
-        SYNC_CLIENT_READ(int slotId = scanForFreeSocketSlot());
+        /* Taking a slot id for connected client */
+        SYNC_CLIENT_WRITE(int slotId = bitmap_acquire(clientSlots, NUMBER_CLIENT_MAX));
 
         /* If no valid slot id was found, closing connection with client */
         if (slotId == -1) {
@@ -151,25 +240,28 @@ int main () {
         printf("Found slot %d for the new client.\n", slotId);
 
         /* Allocating memory for client */
-        Client *client = malloc(sizeof(Client)); // Free-ed in disconnectClient function
+        Client *client = slab_alloc(clientSlab); // Free-ed in disconnectClient function
         client->socket = clientSocket;
+        outbound_init(&client->outbound, clientSocket);
         client->joined = 0;
         client->room = NULL;
-        for (int i = 0; i < MAX_CONCURRENT_FILE_TRANSFER; i++) {
-            client->uploadData[i].fileId = 0;
-            client->uploadData[i].fileContent = NULL;
-            client->uploadData[i].fileSize = 0;
-            client->uploadData[i].received = 0;
+        client->transfers = NULL;
+        client->hibernated = 0;
+        client->roomTaskDone = createEvent();
+        rateLimit_initClient(client);
 
-            client->downloadData[i].downloadedFileId = 0;
-        }
+        timeouts_watchClient(client);
 
         SYNC_CLIENT_WRITE(clients[slotId] = client);
 
         /* Create thread to initialize connection with client and passing client slot id to this thread */
         int* id = malloc(sizeof(int)); // Free-ed in clientThread function
         *id = slotId;
-        Thread thread = createThread(clientThread, id);
-        client->thread = thread;
+        /* The thread handle is written while holding the lock, as the thread reads it to hibernate */
+        SYNC_CLIENT_WRITE(client->thread = createThread(clientThread, id));
     }
+
+    closeSocket(&serverSocket);
+    closeServer();
+    return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -11,78 +11,536 @@
 #include "../common/threads.h"
 #include "../common/packets.h"
 #include "../common/synchronization.h"
+#include "../common/timers.h"
+#include "../common/token-bucket.h"
+#include "../common/throttle.h"
+#include "../common/outbound.h"
+#include "../common/atomics.h"
+#include "../common/bitmap.h"
+#include "../common/slab.h"
 
+#ifndef NUMBER_CLIENT_MAX
 /**
  * \def NUMBER_CLIENT_MAX
- * \brief Maximum of simultaneous connected clients
+ * \brief Maximum of simultaneous connected clients, to raise for large rooms (see LARGE_ROOM_MAX_USERS)
  */
 #define NUMBER_CLIENT_MAX 10
+#endif
+
+/**
+ * \def TIMER_TICK_MILLIS
+ * \brief Resolution of the server timers (milliseconds)
+ */
+#define TIMER_TICK_MILLIS 100
+
+/**
+ * \def HANDSHAKE_TIMEOUT_MILLIS
+ * \brief Delay given to a connected client to pick its username (milliseconds)
+ */
+#define HANDSHAKE_TIMEOUT_MILLIS 30000
+
+/**
+ * \def ACCEPT_POLL_MILLIS
+ * \brief Delay between checks for the server closing, while waiting for connections (milliseconds)
+ */
+#define ACCEPT_POLL_MILLIS 200
+
+/**
+ * \def FILE_TRANSFER_STALL_TIMEOUT_MILLIS
+ * \brief Delay after which an upload that didn't receive any data is aborted (milliseconds)
+ */
+#define FILE_TRANSFER_STALL_TIMEOUT_MILLIS 30000
+
+#ifndef RESUME_GRACE_MILLIS
+/**
+ * \def RESUME_GRACE_MILLIS
+ * \brief Delay during which an upload interrupted by a disconnection can be resumed (milliseconds, see upload-resume.h)
+ */
+#define RESUME_GRACE_MILLIS (10 * 60 * 1000)
+#endif
+
+/**
+ * \def PARKED_UPLOADS_MAX
+ * \brief Maximum of interrupted uploads kept for resumption, the oldest one is dropped for a new one
+ */
+#define PARKED_UPLOADS_MAX 64
+
+#ifndef UPLOAD_MEMORY_BUDGET
+/**
+ * \def UPLOAD_MEMORY_BUDGET
+ * \brief Maximum of bytes buffered by running uploads of all clients (see upload-budget.h)
+ */
+#define UPLOAD_MEMORY_BUDGET 1073741824LL
+#endif
+
+#ifndef TRANSFER_SLOTS
+/**
+ * \def TRANSFER_SLOTS
+ * \brief Maximum of uploads and downloads running at once across all clients (see transfer-scheduler.h)
+ */
+#define TRANSFER_SLOTS 8
+#endif
+
+#ifndef DOWNLOAD_CLIENT_BYTES_PER_SECOND
+/**
+ * \def DOWNLOAD_CLIENT_BYTES_PER_SECOND
+ * \brief Bandwidth of the downloads of each client (bytes per second), 0 not to limit it (see throttle.h)
+ */
+#define DOWNLOAD_CLIENT_BYTES_PER_SECOND 4000000
+#endif
+
+#ifndef DOWNLOAD_TOTAL_BYTES_PER_SECOND
+/**
+ * \def DOWNLOAD_TOTAL_BYTES_PER_SECOND
+ * \brief Bandwidth of the downloads of all clients (bytes per second), 0 not to limit it
+ */
+#define DOWNLOAD_TOTAL_BYTES_PER_SECOND 16000000
+#endif
+
+/**
+ * \def DOWNLOAD_BURST_BYTES
+ * \brief Amount of bytes of downloads sent at once when the bandwidth wasn't used for a while
+ */
+#define DOWNLOAD_BURST_BYTES 65536
+
+#ifndef DOWNLOAD_READ_BYTES
+/**
+ * \def DOWNLOAD_READ_BYTES
+ * \brief Size of the buffer downloaded ranges are read by (bytes)
+ *
+ * MUST be a multiple of FILE_TRANSFER_CHUNK_SIZE : a chunk of data is never split between two reads.
+ */
+#define DOWNLOAD_READ_BYTES (256 * FILE_TRANSFER_CHUNK_SIZE)
+#endif
+
+/**
+ * \def TRANSFER_QUEUE_PER_CLIENT
+ * \brief Maximum amount of transfer requests of a client waiting to be started, further requests are rejected
+ */
+#define TRANSFER_QUEUE_PER_CLIENT 8
+
+/**
+ * \def HEARTBEAT_INTERVAL_MILLIS
+ * \brief Delay of silence from a client after which the server pings it (milliseconds)
+ */
+#define HEARTBEAT_INTERVAL_MILLIS 5000
+
+/**
+ * \def HEARTBEAT_TIMEOUT_MILLIS
+ * \brief Delay given to a client to answer a ping before being considered dead (milliseconds)
+ */
+#define HEARTBEAT_TIMEOUT_MILLIS 10000
+
+#ifndef CLIENT_HIBERNATION_DELAY_MILLIS
+/**
+ * \def CLIENT_HIBERNATION_DELAY_MILLIS
+ * \brief Delay without receiving anything after which a client hibernates (milliseconds), 0 to never (see hibernation.h)
+ */
+#define CLIENT_HIBERNATION_DELAY_MILLIS 10000
+#endif
+
+/**
+ * \def HIBERNATED_HEARTBEAT_INTERVAL_MILLIS
+ * \brief Minimum delay between two pings of a hibernated client (milliseconds)
+ */
+#define HIBERNATED_HEARTBEAT_INTERVAL_MILLIS 60000
+
+/**
+ * \def HIBERNATION_POLL_MILLIS
+ * \brief Delay after which the hibernation thread watches newly hibernated clients (milliseconds)
+ */
+#define HIBERNATION_POLL_MILLIS 100
+
+#ifndef SPECTATOR_MAX
+/**
+ * \def SPECTATOR_MAX
+ * \brief Maximum of simultaneous spectators, not counted in NUMBER_CLIENT_MAX
+ */
+#define SPECTATOR_MAX 100000
+#endif
+
+#ifndef SPECTATOR_BACKLOG_BYTES
+/**
+ * \def SPECTATOR_BACKLOG_BYTES
+ * \brief Maximum amount of bytes kept for a spectator which doesn't read fast enough, it's disconnected beyond
+ */
+#define SPECTATOR_BACKLOG_BYTES 8192
+#endif
+
+/**
+ * \def SPECTATOR_POLL_MILLIS
+ * \brief Delay after which the spectators thread watches new spectators and flushes backlogs again (milliseconds)
+ */
+#define SPECTATOR_POLL_MILLIS 100
+
+#ifndef ROOM_LOOP_THREADS
+/**
+ * \def ROOM_LOOP_THREADS
+ * \brief Number of threads running room operations, rooms being spread across them
+ */
+#define ROOM_LOOP_THREADS 4
+#endif
+
+/**
+ * \def ROOM_LOOP_INBOX_CAPACITY
+ * \brief Maximum amount of tasks waiting in the inbox of a room loop
+ */
+#define ROOM_LOOP_INBOX_CAPACITY 4096
+
+/**
+ * \def ROOM_LANE_INITIAL_CAPACITY
+ * \brief Amount of members a room lane can hold before its arrays are grown
+ */
+#define ROOM_LANE_INITIAL_CAPACITY 8
+
+/*
+ * Rate limits applied to each client, per class of packets.
+ * They can be overridden at build time (e.g. -DRATE_LIMIT_TEXT_PER_SECOND=10).
+ */
+
+/**
+ * \def RATE_LIMIT_TEXT
+ * \brief Rate limit class of text messages (dropped when exceeded)
+ */
+#define RATE_LIMIT_TEXT 0
+
+/**
+ * \def RATE_LIMIT_COMMAND
+ * \brief Rate limit class of commands : rooms, username, stats and transfer requests (dropped when exceeded)
+ */
+#define RATE_LIMIT_COMMAND 1
+
+/**
+ * \def RATE_LIMIT_FILE_DATA
+ * \brief Rate limit class of file data chunks (delayed when exceeded)
+ */
+#define RATE_LIMIT_FILE_DATA 2
+
+/**
+ * \def RATE_LIMIT_CLASSES
+ * \brief Number of rate limit classes
+ */
+#define RATE_LIMIT_CLASSES 3
+
+#ifndef RATE_LIMIT_TEXT_PER_SECOND
+/**
+ * \def RATE_LIMIT_TEXT_PER_SECOND
+ * \brief Sustained rate of text messages allowed per client
+ */
+#define RATE_LIMIT_TEXT_PER_SECOND 5
+#endif
+
+#ifndef RATE_LIMIT_TEXT_BURST
+/**
+ * \def RATE_LIMIT_TEXT_BURST
+ * \brief Amount of text messages a client can send at once
+ */
+#define RATE_LIMIT_TEXT_BURST 10
+#endif
+
+#ifndef RATE_LIMIT_COMMAND_PER_SECOND
+/**
+ * \def RATE_LIMIT_COMMAND_PER_SECOND
+ * \brief Sustained rate of commands allowed per client
+ */
+#define RATE_LIMIT_COMMAND_PER_SECOND 2
+#endif
+
+#ifndef RATE_LIMIT_COMMAND_BURST
+/**
+ * \def RATE_LIMIT_COMMAND_BURST
+ * \brief Amount of commands a client can send at once
+ */
+#define RATE_LIMIT_COMMAND_BURST 5
+#endif
+
+#ifndef RATE_LIMIT_FILE_DATA_PER_SECOND
+/**
+ * \def RATE_LIMIT_FILE_DATA_PER_SECOND
+ * \brief Sustained rate of file data chunks allowed per client
+ */
+#define RATE_LIMIT_FILE_DATA_PER_SECOND 20000
+#endif
+
+#ifndef RATE_LIMIT_FILE_DATA_BURST
+/**
+ * \def RATE_LIMIT_FILE_DATA_BURST
+ * \brief Amount of file data chunks a client can send at once
+ */
+#define RATE_LIMIT_FILE_DATA_BURST 2000
+#endif
 
 struct Room;
 
 /**
- * \class Client
- * \brief A type representing a connected client
+ * \def TRANSFER_UPLOAD
+ * \brief Kind of a transfer from a client to the server
  */
-typedef struct Client {
-    /** The socket from server to the client */
-    Socket socket;
-    /** A buffer meant to contain client username */
-    char username[USERNAME_MAX_LENGTH + 1];
+#define TRANSFER_UPLOAD 0
+
+/**
+ * \def TRANSFER_DOWNLOAD
+ * \brief Kind of a transfer from the server to a client
+ */
+#define TRANSFER_DOWNLOAD 1
+
+/**
+ * \class TransferRequest
+ * \brief A transfer request waiting for the transfer scheduler (see transfer-scheduler.h)
+ */
+typedef struct TransferRequest {
+    /** TRANSFER_UPLOAD or TRANSFER_DOWNLOAD */
+    char kind;
+    /** The file to download, unused for uploads */
+    unsigned int fileId;
+    long long fileSize;
+    /** Token of the interrupted upload to resume, 0 for a new upload */
+    unsigned long long resumeToken;
+    /** Offset of the range of the file to download */
+    long long offset;
+    /** Length of the range of the file to download, within the file */
+    long long length;
+} TransferRequest;
+
+/**
+ * \class ClientTransfers
+ * \brief The file transfers of a client, allocated by its first transfer request (see file-transfer.h)
+ *
+ * Most clients never transfer a file, so this state isn't part of the Client structure.
+ */
+typedef struct ClientTransfers {
     /**
-     * A short indicating whether or not, the client joined discussion.
-     * Equal to 0 if client isn't in the discussion, else 1.
+     * Protects uploadData against concurrent access from the client thread and the timers thread,
+     * and the file and range of download streams, read by the client thread while acknowledged.
      */
-    short joined;
-    /** Thread processing packets sent by user */
-    Thread thread;
-
-    // TODO: Implement in a better way
+    Mutex transferLock;
+    /** Taken slots of uploadData, protected by transferLock */
+    BitmapWord uploadSlots[BITMAP_WORDS(MAX_CONCURRENT_FILE_TRANSFER)];
     /* Upload */
     struct {
         unsigned int fileId;
+        /** Token allowing to resume the upload once interrupted */
+        unsigned long long token;
         long long fileSize;
         long long received;
+        /** CRC32C of the received bytes, updated as they are received and checked against the digest of the client */
+        unsigned int receivedChecksum;
+        /** Amount of received bytes acknowledged to the client */
+        long long acknowledged;
         char* fileContent;
+        /** Timer aborting the upload if the client stops sending data */
+        Timer stallTimer;
+        /** Time the last chunk of data was received (see timers_now) */
+        unsigned long long lastChunkTime;
     } uploadData[MAX_CONCURRENT_FILE_TRANSFER];
-    /* Download */
+    /** Held by download streams while sending the packets of a proof, so the packets of two proofs don't mix */
+    Mutex proofLock;
+    /** Taken slots of downloadData, taken when a download starts and freed by upload threads */
+    volatile BitmapWord downloadSlots[BITMAP_WORDS(MAX_DOWNLOAD_STREAMS)];
+    /* Download, a slot per range being sent */
     struct {
-        Thread downloadThread;
+        /** File being sent, protected by transferLock as the range. Stable while the stream owns its slot */
         unsigned int downloadedFileId;
-    } downloadData[MAX_CONCURRENT_FILE_TRANSFER];
+        /** Offset of the range of the file sent */
+        long long offset;
+        /** Length of the range of the file sent */
+        long long length;
+        /** Offset in the file up to which the client acknowledged data (see FILE_TRANSFER_WINDOW_BYTES) */
+        volatile unsigned long long acked;
+        /** Signaled when the client acknowledges data */
+        Event ackEvent;
+        /** Set once the client doesn't want the file anymore, so the range stops being sent */
+        volatile unsigned int canceled;
+    } downloadData[MAX_DOWNLOAD_STREAMS];
+    /** Set once the client is gone, so the threads sending downloads stop */
+    volatile unsigned int closing;
+    /** Bandwidth shared by the downloads of the client */
+    Throttle downloadThrottle;
+    /** Requests waiting to be started, oldest first. Protected by the transfer scheduler lock */
+    TransferRequest pending[TRANSFER_QUEUE_PER_CLIENT];
+    unsigned int pendingCount;
+    /** Uploads given a slot by the transfer scheduler but not set up yet. MUST be accessed using atomics */
+    volatile unsigned int startingUploads;
+} ClientTransfers;
 
+/**
+ * \class Client
+ * \brief A type representing a connected client
+ *
+ * Fields used to relay each packet come first : clients are allocated on a cache line (see slab.h),
+ * so these fields share a single line. Rarely used state comes last or is allocated on demand.
+ */
+typedef struct Client {
+    /** The socket from server to the client */
+    Socket socket;
     /**
      * A pointer to the room the client joined. Can be NULL.
      *
-     * It can be written to NULL by room-owner thread at any time if the room owner disband deletes the room.
-     * It can be written to NULL by self thread at any time if the client asks to leave the room.
-     * It can be written to non-NULL value ONLY by self thread when the client asks to create a join a room.
-     * It can be read by self thread at any time to relay packets to clients in the room.
+     * It can be written to NULL by the room loop at any time if the client leaves the room or if the room is disbanded.
+     * It can be written to non-NULL value by self thread when the client creates a room, or by the room loop
+     * when the client joins a room.
+     * It can be read by self thread at any time to post tasks to the room loop (see room-loop.h).
      *
      * We MUST acquire clientsLock to access this field.
      */
     struct Room* room;
+    /**
+     * Time of the last packet received from the client, except pongs (see timers_now).
+     * Written by the client thread and read by timers, it MUST be accessed using atomics_load64 and atomics_store64.
+     */
+    volatile unsigned long long lastActivity;
+    /**
+     * Whether or not, the client joined discussion. Equal to 0 if client isn't in the discussion, else 1.
+     *
+     * Written once by the client thread, it MUST be accessed using atomics_load and atomics_store.
+     */
+    volatile unsigned int joined;
+    /** Lane of the room the client is a member of. Only accessed by the loop of the room */
+    unsigned int roomLane;
+    /** Index of the client in the member arrays of its room lane. Only accessed by the loop of the room */
+    unsigned int roomSlot;
+    /** A buffer meant to contain client username */
+    char username[USERNAME_MAX_LENGTH + 1];
+
+    /** Token buckets limiting the rate of packets, per rate limit class. Only used by client thread. */
+    TokenBucket rateLimits[RATE_LIMIT_CLASSES];
+    /** Equal to 1 if the client was told it exceeded the rate limit of the class, else 0 */
+    short rateLimited[RATE_LIMIT_CLASSES];
+    /** The path packets are sent to the client through. Packets MUST NOT be sent on the socket directly */
+    Outbound outbound;
+    /** Signaled by room loops when a task the client thread waits for was run */
+    Event roomTaskDone;
+    /** Thread processing packets sent by user, none while the client hibernates. Written while holding clientsLock */
+    Thread thread;
+    /** Timer enforcing handshake deadline */
+    Timer handshakeTimer;
+
+    /**
+     * Heartbeat state. Pings are sent by the timers thread, pongs are processed by the client thread,
+     * or by the hibernation thread while the client hibernates.
+     *
+     * These fields MUST be accessed using atomics. The ping fields are written by the timers thread
+     * before it sets pingPending, and only read by the thread processing pongs while it's set. The
+     * round-trip time is written by the thread processing pongs only.
+     */
+    /** Timer sending pings on idle connection and evicting dead peers */
+    Timer heartbeatTimer;
+    /** Sequence number of the last sent ping */
+    volatile unsigned int pingSequence;
+    /** Equal to 1 if a ping wasn't answered yet, else 0 */
+    volatile unsigned int pingPending;
+    /** Time the last ping was sent at (see timers_nowMicros) */
+    volatile unsigned long long pingSentTime;
+    /** Smoothed round-trip time in microseconds. Equal to 0 until the first pong is received */
+    volatile unsigned long long smoothedRtt;
+    /** Round-trip time variance in microseconds */
+    volatile unsigned long long rttVariance;
+    /** Equal to 1 while the client hibernates, else 0. It MUST be accessed using atomics_load and atomics_store */
+    volatile unsigned int hibernated;
+
+    /**
+     * File transfers of the client, NULL until its first transfer request.
+     *
+     * Allocated by the client thread before any transfer starts, so timers and upload threads see it set.
+     */
+    ClientTransfers* transfers;
 } Client;
 
+/**
+ * \class Spectator
+ * \brief A read-only connection receiving the broadcasts of a room (see spectator.h)
+ *
+ * It only holds what's needed to be sent packets : no username, no transfers, no timers, no thread.
+ */
+typedef struct Spectator {
+    /** The socket from server to the spectator */
+    Socket socket;
+    /**
+     * A pointer to the watched room, written to NULL by the room loop when the room is disbanded.
+     *
+     * We MUST acquire clientsLock to access this field.
+     */
+    struct Room* room;
+    /** Lane of the room the spectator is in. Written by the loop of the room when the spectator joins */
+    unsigned int roomLane;
+    /** Index of the spectator in the spectator arrays of its room lane. Only accessed by the loop of the room */
+    unsigned int roomSlot;
+    /** Bytes of broadcasts the spectator didn't accept yet, NULL if none. Only accessed by the loop of its lane */
+    char* backlog;
+    unsigned int backlogSize;
+    /** Equal to 1 while the backlog isn't empty, else 0. Written by the loop of its lane, read by the spectators thread */
+    volatile unsigned int backlogged;
+    /** Equal to 1 once the spectator is disconnected for not reading, else 0. Only accessed by the loop of its lane */
+    unsigned int dropped;
+    /** Bytes left of the packet the spectator is sending, ignored. Only accessed by the spectators thread */
+    unsigned int skipping;
+    /** Signaled by room loops when a task the spectator waits for was run */
+    Event roomTaskDone;
+} Spectator;
+
+/**
+ * \class RoomLane
+ * \brief A share of the members and spectators of a room, packed at the front of parallel growable arrays
+ *
+ * Broadcasts walk outbounds only, without touching the Client structures. Packets to the members
+ * of a lane are always queued by the same loop, so they're received in order. That loop also
+ * sends them to the spectators of the lane itself (see spectator.h).
+ */
+typedef struct RoomLane {
+    /** Amount of members of the lane */
+    unsigned int count;
+    /** Amount of members the arrays can hold */
+    unsigned int capacity;
+    /** Outbound paths of the members, indexed as members */
+    Outbound** outbounds;
+    /** Clients of the lane */
+    Client** members;
+    /** Amount of spectators of the lane */
+    unsigned int spectatorCount;
+    /** Amount of spectators the arrays can hold, 0 until the first spectator joins the lane */
+    unsigned int spectatorCapacity;
+    /** Spectators of the lane */
+    Spectator** spectators;
+} RoomLane;
+
 typedef struct Room {
     char name[ROOM_NAME_MAX_LENGTH + 1];
     char description[ROOM_DESC_MAX_LENGTH + 1];
-    /**
-     * An array of pointers to clients who joined the room.
+    /*
+     * Members of the room. A regular room has a single lane, a large room has a lane per room loop
+     * so broadcasts are spread across loops.
      *
-     * It can be written by any client thread at any time if a client joins the room or leaves the room.
-     * It can be read by any client at any time to relay a packet.
-     *
-     * We MUST acquire lock field to access this field.
+     * They're owned by the loop of the room : they MUST only be accessed by tasks run on this loop (see room-loop.h).
      */
-    Client* clients[MAX_USERS_PER_ROOM];
+    /** Equal to 1 for a large room, else 0 */
+    short large;
+    /** Amount of clients who joined the room */
+    unsigned int memberCount;
+    /** Maximum amount of clients of the room */
+    unsigned int maxMembers;
+    /** Amount of lanes members are spread across. Spectators are spread across all lanes */
+    unsigned int laneCount;
+    RoomLane lanes[ROOM_LOOP_THREADS];
+    /** Amount of spectators watching the room */
+    unsigned int spectatorCount;
     Client* owner;
-    ReadWriteLock lock;
+    /** Index of the loop the room is pinned to */
+    unsigned int loop;
+    /** Equal to 1 once the room was disbanded, else 0. Only accessed by the loop of the room */
+    short closed;
+    /** Next closed room waiting to be released by the loop */
+    struct Room* nextClosed;
 } Room;
 
 extern ReadWriteLock clientsLock;
 extern ReadWriteLock roomsLock;
 extern Client* clients[NUMBER_CLIENT_MAX];
+/**
+ * Taken slots of the clients array. A slot is taken before the client is stored in it.
+ *
+ * We MUST acquire clientsLock to access this field.
+ */
+extern BitmapWord clientSlots[BITMAP_WORDS(NUMBER_CLIENT_MAX)];
 /**
  * An array containing all pointers to existing rooms.
  *
@@ -92,6 +550,26 @@ extern Client* clients[NUMBER_CLIENT_MAX];
  * We MUST acquire roomsLock to access this field.
  */
 extern Room* rooms[NUMBER_ROOM_MAX];
+/**
+ * Taken slots of the rooms array.
+ *
+ * We MUST acquire roomsLock to access this field.
+ */
+extern BitmapWord roomSlots[BITMAP_WORDS(NUMBER_ROOM_MAX)];
+
+/**
+ * Allocators of clients, rooms and spectators (see slab.h). Created before accepting connections.
+ */
+extern Slab* clientSlab;
+extern Slab* roomSlab;
+extern Slab* spectatorSlab;
+
+/**
+ * Amount of connected spectators.
+ *
+ * It MUST be accessed using atomics_load and atomics_fetchAdd.
+ */
+extern volatile unsigned int spectatorCount;
 
 /**
  * \def SYNC_CLIENT_READ
@@ -130,30 +608,17 @@ op;                               \
 releaseWrite(roomsLock);
 
 /**
- * \def SYNC_ROOM_READ
- * \brief Macro to synchronize read operation on a single room
- */
-#define SYNC_ROOM_READ(room, op)  \
-acquireRead(room->lock);          \
-op;                               \
-releaseRead(room->lock);
-
-/**
- * \def SYNC_ROOM_WRITE
- * \brief Macro to synchronize write operation on a single room
- */
-#define SYNC_ROOM_READ(room, op)  \
-acquireRead(room->lock);          \
-op;                               \
-releaseRead(room->lock);
-
-/**
- * \brief Catch interrupt signal.
+ * \brief Catch interrupt signal, asking the main thread to close the server.
  *
  * \param signal Incoming signal
  */
 void handleServerClose(int signal);
 
+/**
+ * \brief Stops the server threads, releases allocated resources and exits. Called by the main thread.
+ */
+void closeServer();
+
 /**
  * \brief Relay messages sent by given client to all known clients.
  *
@@ -161,7 +626,16 @@ void handleServerClose(int signal);
  * known clients.
  *
  * \param client The client to wait messages from
+ * \return 1 if the client must hibernate (see hibernation.h), 0 once it disconnected
+ */
+int handleClientsPackets(Client* client);
+
+/**
+ * \brief Processes the packets of the given client until it hibernates or disconnects. Run by the client thread.
+ *
+ * \param client The client to serve
+ * \param id The slot of the client
  */
-void handleClientsPackets(Client* client);
+void serveClient(Client* client, int id);
 
 #endif //C_CHAT_CLIENT_H
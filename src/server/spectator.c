@@ -0,0 +1,365 @@
+#include "spectator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "room.h"
+#include "room-loop.h"
+#include "../common/adaptive-lock.h"
+#include "../common/atomics.h"
+
+volatile unsigned int spectatorCount = 0;
+
+/** Spectators watched by the spectators thread, packed at the front of the array. Protected by watchedLock */
+static Spectator* watchedSpectators[SPECTATOR_MAX];
+static volatile unsigned int watchedCount = 0;
+static AdaptiveLock watchedLock = ADAPTIVE_LOCK_INITIALIZER;
+static Thread spectatorsThread;
+/** Signaled by room loops when the spectators thread flushes them (see roomLoops_flush) */
+static Event loopsFlushed;
+
+/**
+ * \brief Adds the spectator of the task to the room of the task. Run by the room loop.
+ */
+void spectator_join(RoomTask* task) {
+    if (task->room->closed) {
+        return;
+    }
+
+    SYNC_CLIENT_WRITE(task->spectator->room = task->room);
+    addRoomSpectator(task->room, task->spectator);
+}
+
+/**
+ * \brief Removes the spectator of the task from the room of the task. Run by the room loop.
+ */
+void spectator_leave(RoomTask* task) {
+    acquireWrite(clientsLock);
+
+    /* The room may have been disbanded since the task was posted */
+    if (task->room->closed || task->spectator->room != task->room) {
+        releaseWrite(clientsLock);
+        return;
+    }
+
+    task->spectator->room = NULL;
+    releaseWrite(clientsLock);
+    removeRoomSpectator(task->room, task->spectator);
+}
+
+/**
+ * \brief Posts the given operation on the given room on behalf of the given spectator and waits for it.
+ *
+ * \param run The operation
+ * \param spectator The spectator
+ * \param room The room, found holding lock
+ * \param lock The lock the room was found through, released by this function
+ * \return 1 if the operation was run, 0 if the loop of the room was overwhelmed
+ */
+int spectator_runTask(ROOM_TASK_FUNCTION run, Spectator* spectator, Room* room, ReadWriteLock lock) {
+    RoomTask* task = roomLoops_newTask(run, room, NULL);
+    task->spectator = spectator;
+    task->done = &spectator->roomTaskDone;
+    int posted = roomLoops_post(task);
+    releaseRead(lock);
+
+    if (posted) {
+        waitEvent(spectator->roomTaskDone);
+    }
+    return posted;
+}
+
+/**
+ * \brief Gives up on the given spectator, which doesn't read fast enough. Run by the loop of its lane.
+ */
+void spectator_drop(Spectator* spectator) {
+    spectator->dropped = 1;
+    free(spectator->backlog);
+    spectator->backlog = NULL;
+    spectator->backlogSize = 0;
+    atomics_store(&spectator->backlogged, 0);
+
+    /* The spectators thread sees the connection closed and releases the spectator */
+    shutdownSocket(spectator->socket);
+}
+
+/**
+ * \brief Sends as much of the backlog of the given spectator as it accepts right away. Run by the loop of its lane.
+ *
+ * \return 1 if the backlog is empty, else 0
+ */
+int spectator_flush(Spectator* spectator) {
+    if (spectator->backlogSize == 0) {
+        return 1;
+    }
+
+    int sent = sendAvailable(spectator->socket, spectator->backlog, spectator->backlogSize);
+    if (sent == SOCKET_WOULD_BLOCK) {
+        return 0;
+    }
+    if (sent <= 0) {
+        spectator_drop(spectator);
+        return 0;
+    }
+
+    spectator->backlogSize -= sent;
+    if (spectator->backlogSize > 0) {
+        memmove(spectator->backlog, spectator->backlog + sent, spectator->backlogSize);
+        return 0;
+    }
+    free(spectator->backlog);
+    spectator->backlog = NULL;
+    atomics_store(&spectator->backlogged, 0);
+    return 1;
+}
+
+/**
+ * \brief Sends the given bytes to the given spectator, keeping in its backlog what it doesn't accept right away.
+ *
+ * Run by the loop of its lane.
+ */
+void spectator_send(Spectator* spectator, const char* data, unsigned int size) {
+    if (spectator->dropped) {
+        return;
+    }
+
+    /* Bytes MUST be sent in order : the packet waits behind the backlog */
+    unsigned int sent = 0;
+    if (spectator_flush(spectator)) {
+        int callSuccess = sendAvailable(spectator->socket, data, size);
+        if (callSuccess != SOCKET_WOULD_BLOCK && callSuccess <= 0) {
+            spectator_drop(spectator);
+            return;
+        }
+        sent = callSuccess == SOCKET_WOULD_BLOCK ? 0 : (unsigned int) callSuccess;
+    }
+    if (spectator->dropped || sent == size) {
+        return;
+    }
+
+    if (spectator->backlogSize + size - sent > SPECTATOR_BACKLOG_BYTES) {
+        spectator_drop(spectator);
+        return;
+    }
+    if (spectator->backlog == NULL) {
+        spectator->backlog = malloc(SPECTATOR_BACKLOG_BYTES);
+        atomics_store(&spectator->backlogged, 1);
+    }
+    memcpy(spectator->backlog + spectator->backlogSize, data + sent, size - sent);
+    spectator->backlogSize += size - sent;
+}
+
+void spectator_sendToAll(Spectator* const* spectators, unsigned int count, Packet* packet) {
+    unsigned int size = packets_sizeOf(packet);
+    for (unsigned int i = 0; i < count; i++) {
+        spectator_send(spectators[i], (const char*) packet, size);
+    }
+}
+
+/**
+ * \brief Sends the backlog of the spectator of the task. Run by the loop of its lane.
+ */
+void spectator_flushTask(RoomTask* task) {
+    if (!task->spectator->dropped) {
+        spectator_flush(task->spectator);
+    }
+}
+
+/**
+ * \brief Asks the loop of the lane of the given spectator to send its backlog. Run by the spectators thread.
+ *
+ * Backlogs are otherwise only sent with the next broadcast, which may not come in a quiet room.
+ */
+void spectator_nudge(Spectator* spectator) {
+    acquireRead(clientsLock);
+    Room* room = spectator->room;
+    if (room != NULL) {
+        RoomTask* task = roomLoops_newTask(spectator_flushTask, NULL, NULL);
+        task->spectator = spectator;
+        /* Dropped if the loop is overwhelmed, the next round posts it again */
+        roomLoops_postToLoop(room->loop + spectator->roomLane, task);
+    }
+    releaseRead(clientsLock);
+}
+
+/**
+ * \brief Receives what the given spectator sent, which is ignored. Run by the spectators thread once data is available.
+ *
+ * \return 1 if the spectator still watches, 0 if it quit or its connection is closed
+ */
+int spectator_absorb(Spectator* spectator) {
+    char buffer[sizeof(Packet)];
+    int bytesReceived = receiveFrom(spectator->socket, buffer, sizeof(buffer));
+    if (bytesReceived <= 0) {
+        return 0;
+    }
+
+    /* Packets can be split across receives : the bytes left of the previous one are skipped first */
+    unsigned int received = (unsigned int) bytesReceived;
+    for (unsigned int i = 0; i < received;) {
+        if (spectator->skipping == 0) {
+            Packet header;
+            header.type = buffer[i];
+            if (header.type == QUIT_MESSAGE_TYPE) {
+                return 0;
+            }
+            /* Bytes of unknown types are skipped one by one */
+            unsigned int size = packets_sizeOf(&header);
+            spectator->skipping = size == 0 ? 1 : size;
+        }
+
+        unsigned int skipped = received - i < spectator->skipping ? received - i : spectator->skipping;
+        spectator->skipping -= skipped;
+        i += skipped;
+    }
+    return 1;
+}
+
+/**
+ * \brief Releases the given spectator. No room loop MUST reference it anymore.
+ */
+void spectator_free(Spectator* spectator) {
+    closeSocket(&(spectator->socket));
+    free(spectator->backlog);
+    destroyEvent(spectator->roomTaskDone);
+    slab_free(spectatorSlab, spectator);
+    atomics_fetchAdd(&spectatorCount, (unsigned int) -1);
+}
+
+/**
+ * \brief Removes the given spectators from their rooms, then releases them. Run by the spectators thread.
+ *
+ * \param leaving The spectators, no longer watched
+ * \param count The amount of spectators
+ */
+void spectator_release(Spectator** leaving, unsigned int count) {
+    for (unsigned int i = 0; i < count; i++) {
+        /* The spectator MUST leave before being released, even if the loop is overwhelmed */
+        int left;
+        do {
+            acquireRead(clientsLock);
+            Room* room = leaving[i]->room;
+            if (room == NULL) {
+                releaseRead(clientsLock);
+                left = 1;
+            } else if (!(left = spectator_runTask(spectator_leave, leaving[i], room, clientsLock))) {
+                threadSleep(1);
+            }
+        } while (!left);
+    }
+
+    /* Room loops may still send them packets, from batches taken before they left : a single flush covers them all */
+    roomLoops_flush(loopsFlushed);
+
+    for (unsigned int i = 0; i < count; i++) {
+        spectator_free(leaving[i]);
+    }
+}
+
+/**
+ * \brief Entry point of the spectators thread.
+ */
+THREAD_ENTRY_POINT spectator_poll(void* data) {
+    static Spectator* polled[SPECTATOR_MAX];
+    static Socket sockets[SPECTATOR_MAX];
+    static char ready[SPECTATOR_MAX];
+    static Spectator* leaving[SPECTATOR_MAX];
+    (void) data;
+
+    while (1) {
+        adaptiveLock_acquire(&watchedLock);
+        unsigned int count = watchedCount;
+        for (unsigned int i = 0; i < count; i++) {
+            polled[i] = watchedSpectators[i];
+            sockets[i] = polled[i]->socket;
+        }
+        adaptiveLock_release(&watchedLock);
+
+        if (count == 0) {
+            threadSleep(SPECTATOR_POLL_MILLIS);
+            continue;
+        }
+
+        for (unsigned int i = 0; i < count; i++) {
+            if (atomics_load(&polled[i]->backlogged)) {
+                spectator_nudge(polled[i]);
+            }
+        }
+
+        /* Spectators watching meanwhile are polled from the next round */
+        if (waitForData(sockets, count, ready, SPECTATOR_POLL_MILLIS) <= 0) {
+            continue;
+        }
+
+        /* Only this thread removes spectators : walking backwards, the ones moved by removals were already checked */
+        unsigned int leavingCount = 0;
+        for (int i = (int) count - 1; i >= 0; i--) {
+            if (ready[i] && !spectator_absorb(polled[i])) {
+                adaptiveLock_acquire(&watchedLock);
+                watchedSpectators[i] = watchedSpectators[watchedCount - 1];
+                atomics_store(&watchedCount, watchedCount - 1);
+                adaptiveLock_release(&watchedLock);
+
+                leaving[leavingCount++] = polled[i];
+            }
+        }
+        if (leavingCount > 0) {
+            spectator_release(leaving, leavingCount);
+        }
+    }
+}
+
+void spectator_init() {
+    loopsFlushed = createEvent();
+    spectatorsThread = createThread(spectator_poll, NULL);
+}
+
+void spectator_cleanUp() {
+    destroyThread(&spectatorsThread);
+}
+
+void spectator_watch(Socket socket, const char* roomName) {
+    const char* full = "Full.";
+    const char* okSpectator = "Ok";
+
+    if (atomics_fetchAdd(&spectatorCount, 1) >= SPECTATOR_MAX) {
+        atomics_fetchAdd(&spectatorCount, (unsigned int) -1);
+        sendTo(socket, full, strlen(full));
+        closeSocket(&socket);
+        return;
+    }
+
+    Spectator* spectator = slab_alloc(spectatorSlab);
+    spectator->socket = socket;
+    spectator->room = NULL;
+    spectator->backlog = NULL;
+    spectator->backlogSize = 0;
+    spectator->backlogged = 0;
+    spectator->dropped = 0;
+    spectator->skipping = 0;
+    spectator->roomTaskDone = createEvent();
+
+    /* Accepted before joining, so the answer doesn't interleave with broadcasts */
+    sendTo(socket, okSpectator, strlen(okSpectator));
+
+    acquireRead(roomsLock);
+    Room* room = findRoomByName(roomName);
+    if (room == NULL) {
+        releaseRead(roomsLock);
+    } else {
+        spectator_runTask(spectator_join, spectator, room, roomsLock);
+    }
+
+    SYNC_CLIENT_READ(int watching = spectator->room != NULL);
+    if (!watching) {
+        /* Never in a lane : no room loop references it */
+        spectator_free(spectator);
+        return;
+    }
+    printf("A spectator is watching room %s\n", roomName);
+
+    /* Spectators can't send anything : the spectators thread only waits for them to quit */
+    adaptiveLock_acquire(&watchedLock);
+    watchedSpectators[watchedCount] = spectator;
+    atomics_store(&watchedCount, watchedCount + 1);
+    adaptiveLock_release(&watchedLock);
+}
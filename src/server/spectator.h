@@ -0,0 +1,55 @@
+/**
+ * \file spectator.h
+ * \brief Read-only connections watching a room.
+ *
+ * A spectator connects like a client but sends SPECTATE_HANDSHAKE_PREFIX followed by a room name
+ * instead of a username. Once the room is found, its connection is handed over from the client
+ * slot to a Spectator, a far smaller structure : it takes no client slot, has no username, no
+ * transfers, no timers, no thread and no outbound path. Anything they send is ignored.
+ *
+ * Spectators are spread across the lanes of the room. The loop of a lane sends broadcasts to its
+ * spectators itself, straight from the packet of the broadcast, without waiting : the bytes a
+ * spectator doesn't accept right away are kept in its backlog and sent before the next packet.
+ * A spectator which lets more than SPECTATOR_BACKLOG_BYTES pile up is disconnected.
+ *
+ * A single spectators thread watches all spectators until they quit, flushes backlogs left
+ * behind by quiet rooms and releases the spectators once disconnected.
+ *
+ * A spectator is disconnected when the room is disbanded.
+ */
+
+#ifndef C_CHAT_SPECTATOR_H
+#define C_CHAT_SPECTATOR_H
+
+#include "server.h"
+
+/**
+ * \brief Starts the spectators thread.
+ */
+void spectator_init();
+
+/**
+ * \brief Stops the spectators thread.
+ */
+void spectator_cleanUp();
+
+/**
+ * \brief Adds a spectator to the given room, then hands it over to the spectators thread.
+ *
+ * Run by the thread of the connection, which can end once this function returns.
+ *
+ * \param socket The connection with the spectator, handed over from a client (see handOverConnection)
+ * \param roomName The name of the room to watch
+ */
+void spectator_watch(Socket socket, const char* roomName);
+
+/**
+ * \brief Sends the given packet to the given spectators without waiting. Called by the loop of their lane only.
+ *
+ * \param spectators The spectators of a lane
+ * \param count The amount of spectators
+ * \param packet The packet to send
+ */
+void spectator_sendToAll(Spectator* const* spectators, unsigned int count, Packet* packet);
+
+#endif //C_CHAT_SPECTATOR_H
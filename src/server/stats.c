@@ -0,0 +1,126 @@
+#include "stats.h"
+#include "communication.h"
+#include "room-loop.h"
+#include "hibernation.h"
+#include "upload-budget.h"
+#include "transfer-scheduler.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * \brief Formats the round-trip time of the given client in the given buffer. clientsLock MUST be acquired.
+ */
+void formatClientRtt(Client* client, char* buffer) {
+    unsigned long long smoothedRtt = atomics_load64(&client->smoothedRtt);
+    if (smoothedRtt == 0) {
+        sprintf(buffer, "%s : round-trip time unknown", client->username);
+    } else {
+        sprintf(
+            buffer,
+            "%s : round-trip time %.2f ms (variance %.2f ms)",
+            client->username,
+            smoothedRtt / 1000.0,
+            atomics_load64(&client->rttVariance) / 1000.0
+        );
+    }
+}
+
+/**
+ * \brief Sends the round-trip time of the members of the room of the task to the client of the task. Run by the room loop.
+ */
+void reportRoomRtt(RoomTask* task) {
+    if (task->room->closed) {
+        return;
+    }
+
+    Packet packet = NewPacketServerSuccess;
+    if (task->room->spectatorCount) {
+        sprintf(packet.asServerSuccessMessagePacket.message, "Room spectators : %u", task->room->spectatorCount);
+        sendToClient(task->client, &packet);
+    }
+    if (task->room->large) {
+        /* Too many members to list them all */
+        sprintf(packet.asServerSuccessMessagePacket.message, "Room members : %u", task->room->memberCount);
+        sendToClient(task->client, &packet);
+        SYNC_CLIENT_READ(formatClientRtt(task->client, packet.asServerSuccessMessagePacket.message));
+        sendToClient(task->client, &packet);
+        return;
+    }
+
+    SYNC_CLIENT_READ(
+        for (unsigned int i = 0; i < task->room->laneCount; i++) {
+            RoomLane* lane = &task->room->lanes[i];
+            for (unsigned int j = 0; j < lane->count; j++) {
+                formatClientRtt(lane->members[j], packet.asServerSuccessMessagePacket.message);
+                sendToClient(task->client, &packet);
+            }
+        }
+    );
+}
+
+/**
+ * \brief Formats the usage of the given allocator in the given buffer.
+ */
+void formatSlabStats(const char* name, Slab* slab, char* buffer) {
+    SlabStats stats;
+    slab_stats(slab, &stats);
+    sprintf(buffer, "%s : %u in use, %u free", name, stats.live, stats.free);
+}
+
+void handleStatsRequest(Client* client) {
+    Packet packet = NewPacketServerSuccess;
+    memcpy(packet.asServerSuccessMessagePacket.message, "Server statistics :", 20);
+    sendToClient(client, &packet);
+
+    formatSlabStats("Allocated clients", clientSlab, packet.asServerSuccessMessagePacket.message);
+    sendToClient(client, &packet);
+    formatSlabStats("Allocated rooms", roomSlab, packet.asServerSuccessMessagePacket.message);
+    sendToClient(client, &packet);
+    formatSlabStats("Allocated spectators", spectatorSlab, packet.asServerSuccessMessagePacket.message);
+    sendToClient(client, &packet);
+
+    acquireRead(clientsLock);
+    unsigned int connected = 0;
+    for (int i = bitmap_next(clientSlots, NUMBER_CLIENT_MAX, 0); i != -1; i = bitmap_next(clientSlots, NUMBER_CLIENT_MAX, i + 1)) {
+        if (clients[i] != NULL && atomics_load(&clients[i]->joined)) {
+            connected++;
+        }
+    }
+    sprintf(packet.asServerSuccessMessagePacket.message, "Connected clients : %u", connected);
+    sendToClient(client, &packet);
+    sprintf(packet.asServerSuccessMessagePacket.message, "Hibernated clients : %u", hibernation_count());
+    sendToClient(client, &packet);
+    sprintf(packet.asServerSuccessMessagePacket.message, "Spectators : %u", atomics_load(&spectatorCount));
+    sendToClient(client, &packet);
+
+    TransferSchedulerStats transfers;
+    transferScheduler_stats(&transfers);
+    sprintf(
+        packet.asServerSuccessMessagePacket.message,
+        "Transfers : %u/%u running, %u queued by %u clients",
+        transfers.running,
+        TRANSFER_SLOTS,
+        transfers.queued,
+        transfers.waitingClients
+    );
+    sendToClient(client, &packet);
+    sprintf(
+        packet.asServerSuccessMessagePacket.message,
+        "Upload memory : %lld/%lld KB",
+        uploadBudget_committed() / 1024,
+        (long long) UPLOAD_MEMORY_BUDGET / 1024
+    );
+    sendToClient(client, &packet);
+
+    Room* room = client->room;
+    if (room == NULL) {
+        formatClientRtt(client, packet.asServerSuccessMessagePacket.message);
+        releaseRead(clientsLock);
+        sendToClient(client, &packet);
+        return;
+    }
+
+    RoomTask* task = roomLoops_newTask(reportRoomRtt, room, client);
+    roomLoops_post(task);
+    releaseRead(clientsLock);
+}
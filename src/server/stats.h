@@ -0,0 +1,21 @@
+/**
+ * \file stats.h
+ * \brief Reports server statistics to clients
+ */
+
+#ifndef C_CHAT_STATS_H
+#define C_CHAT_STATS_H
+
+#include "server.h"
+
+/**
+ * \brief Processes a received PacketStatsRequest
+ *
+ * Sends to the client the usage of the server allocators, the number of connected clients and
+ * spectators, and the round-trip time of every client in its room.
+ *
+ * \param client The client who sent the packet
+ */
+void handleStatsRequest(Client* client);
+
+#endif //C_CHAT_STATS_H
@@ -0,0 +1,185 @@
+#include "timeouts.h"
+#include "communication.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "client-info.h"
+#include "transfer-scheduler.h"
+
+static TimerWheel* wheel;
+static Thread timersThread;
+/** Set when the server closes, the thread stops after its current tick */
+static volatile unsigned int stopping = 0;
+
+THREAD_ENTRY_POINT timersWorker(void* data) {
+    (void) data;
+    while (!atomics_load(&stopping)) {
+        threadSleep(TIMER_TICK_MILLIS);
+        timers_advance(wheel, timers_now());
+    }
+    return 0;
+}
+
+void timeouts_init() {
+    wheel = timers_createWheel(TIMER_TICK_MILLIS);
+    timersThread = createThread(timersWorker, NULL);
+}
+
+void timeouts_cleanUp() {
+    /* Not canceled : the thread may be running callbacks, holding the lock of the wheel */
+    atomics_store(&stopping, 1);
+    joinThread(&timersThread);
+    timers_destroyWheel(wheel);
+}
+
+TimerWheel* timeouts_getWheel() {
+    return wheel;
+}
+
+void onHandshakeTimeout(Timer* timer, void* data) {
+    (void) timer;
+    Client* client = data;
+
+    /* A quiet client which picked its username stays connected, heartbeats detect dead peers */
+    if (!atomics_load(&client->joined)) {
+        printf("A client didn't pick an username in time. Closing connection.\n");
+        shutdownSocket(client->socket);
+    }
+}
+
+void onUploadStalled(Timer* timer, void* data) {
+    Client* client = data;
+    ClientTransfers* transfers = client->transfers;
+    long long released = 0;
+
+    acquireMutex(&transfers->transferLock);
+    for (int i = 0; i < MAX_CONCURRENT_FILE_TRANSFER; i++) {
+        if (&transfers->uploadData[i].stallTimer == timer && transfers->uploadData[i].fileId != 0) {
+            unsigned long long stallTime = timers_now() - transfers->uploadData[i].lastChunkTime;
+            if (stallTime < FILE_TRANSFER_STALL_TIMEOUT_MILLIS) {
+                timers_arm(wheel, timer, FILE_TRANSFER_STALL_TIMEOUT_MILLIS - stallTime);
+                break;
+            }
+
+            Packet cancelPacket = NewPacketFileTransferCancel;
+            cancelPacket.asFileTransferCancelPacket.id = transfers->uploadData[i].fileId;
+
+            /* Set client upload state */
+            free(transfers->uploadData[i].fileContent);
+            transfers->uploadData[i].fileId = 0;
+            transfers->uploadData[i].received = 0;
+            transfers->uploadData[i].fileContent = NULL;
+            bitmap_release(transfers->uploadSlots, i);
+            released = transfers->uploadData[i].fileSize;
+
+            sendToClient(client, &cancelPacket);
+
+            Packet errorPacket = NewPacketServerErrorMessage;
+            memcpy(errorPacket.asServerErrorMessagePacket.message, "Upload stalled. Canceled.", 26);
+            sendToClient(client, &errorPacket);
+        }
+    }
+    releaseMutex(&transfers->transferLock);
+
+    if (released > 0) {
+        transferScheduler_finished(TRANSFER_UPLOAD, released);
+    }
+}
+
+void onHeartbeat(Timer* timer, void* data) {
+    Client* client = data;
+    short isDead = 0;
+    short mustPing = 0;
+    Packet pingPacket = NewPacketPing;
+
+    /* Only this thread writes the ping fields, the client thread only clears pingPending */
+    if (atomics_load(&client->pingPending)) {
+        isDead = (timers_nowMicros() - atomics_load64(&client->pingSentTime)) / 1000 >= HEARTBEAT_TIMEOUT_MILLIS;
+    } else if (atomics_load(&client->joined) && timers_now() - atomics_load64(&client->lastActivity) >= HEARTBEAT_INTERVAL_MILLIS
+               && (!atomics_load(&client->hibernated)
+                   || (timers_nowMicros() - atomics_load64(&client->pingSentTime)) / 1000 >= HIBERNATED_HEARTBEAT_INTERVAL_MILLIS)) {
+        /* Connection is quiet, checking the client is still there. The ping is published once its fields are set */
+        unsigned int sequence = atomics_load(&client->pingSequence) + 1;
+        atomics_store(&client->pingSequence, sequence);
+        atomics_store64(&client->pingSentTime, timers_nowMicros());
+        atomics_store(&client->pingPending, 1);
+        pingPacket.asPingPacket.sequence = sequence;
+        mustPing = 1;
+    }
+
+    if (isDead) {
+        char username[USERNAME_MAX_LENGTH + 1];
+        getClientUsername(client, username);
+        printf("Client %s didn't answer ping. Closing connection.\n", username);
+        shutdownSocket(client->socket);
+        return;
+    }
+
+    if (mustPing) {
+        sendToClient(client, &pingPacket);
+    }
+
+    timers_arm(wheel, timer, HEARTBEAT_INTERVAL_MILLIS);
+}
+
+void handlePong(Client* client, struct PacketPong* packet) {
+    /* The ping fields don't change while a ping is pending, only this thread clears it */
+    if (!atomics_load(&client->pingPending) || packet->sequence != atomics_load(&client->pingSequence)) {
+        return;
+    }
+    unsigned long long sample = timers_nowMicros() - atomics_load64(&client->pingSentTime);
+    atomics_store(&client->pingPending, 0);
+
+    /* Smoothing as TCP does for its retransmission timer (RFC 6298). Only this thread writes the round-trip time */
+    unsigned long long smoothedRtt = atomics_load64(&client->smoothedRtt);
+    unsigned long long rttVariance = atomics_load64(&client->rttVariance);
+    if (smoothedRtt == 0) {
+        rttVariance = sample / 2;
+        smoothedRtt = sample;
+    } else {
+        unsigned long long delta = smoothedRtt > sample ? smoothedRtt - sample : sample - smoothedRtt;
+        rttVariance = (3 * rttVariance + delta) / 4;
+        smoothedRtt = (7 * smoothedRtt + sample) / 8;
+    }
+    atomics_store64(&client->rttVariance, rttVariance);
+    atomics_store64(&client->smoothedRtt, smoothedRtt);
+}
+
+void timeouts_watchClient(Client* client) {
+    atomics_store64(&client->lastActivity, timers_now());
+    atomics_store(&client->pingSequence, 0);
+    atomics_store(&client->pingPending, 0);
+    atomics_store64(&client->pingSentTime, 0);
+    atomics_store64(&client->rttVariance, 0);
+    atomics_store64(&client->smoothedRtt, 0);
+    timers_init(&client->handshakeTimer, onHandshakeTimeout, client);
+    timers_init(&client->heartbeatTimer, onHeartbeat, client);
+    timers_arm(wheel, &client->handshakeTimer, HANDSHAKE_TIMEOUT_MILLIS);
+    timers_arm(wheel, &client->heartbeatTimer, HEARTBEAT_INTERVAL_MILLIS);
+}
+
+void timeouts_unwatchClient(Client* client) {
+    timers_cancel(wheel, &client->handshakeTimer);
+    timers_cancel(wheel, &client->heartbeatTimer);
+    timeouts_unwatchTransfers(client);
+}
+
+void timeouts_unwatchTransfers(Client* client) {
+    if (client->transfers != NULL) {
+        for (int i = 0; i < MAX_CONCURRENT_FILE_TRANSFER; i++) {
+            timers_cancel(wheel, &client->transfers->uploadData[i].stallTimer);
+        }
+    }
+}
+
+void timeouts_watchTransfers(Client* client) {
+    for (int i = 0; i < MAX_CONCURRENT_FILE_TRANSFER; i++) {
+        timers_init(&client->transfers->uploadData[i].stallTimer, onUploadStalled, client);
+    }
+}
+
+void timeouts_watchUpload(Client* client, int uploadId) {
+    Timer* timer = &client->transfers->uploadData[uploadId].stallTimer;
+    client->transfers->uploadData[uploadId].lastChunkTime = timers_now();
+    timers_arm(wheel, timer, FILE_TRANSFER_STALL_TIMEOUT_MILLIS);
+}
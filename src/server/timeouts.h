@@ -0,0 +1,87 @@
+/**
+ * \file timeouts.h
+ * \brief Time-based supervision of clients : handshake deadline, heartbeat and stalled uploads
+ */
+
+#ifndef C_CHAT_TIMEOUTS_H
+#define C_CHAT_TIMEOUTS_H
+
+#include "server.h"
+
+/**
+ * \brief Creates the server timer wheel and starts the thread driving it.
+ */
+void timeouts_init();
+
+/**
+ * \brief Stops the thread driving the timer wheel and releases it.
+ */
+void timeouts_cleanUp();
+
+/**
+ * \brief Starts supervising the given client.
+ *
+ * The client connection is shut down if the handshake isn't done within HANDSHAKE_TIMEOUT_MILLIS.
+ * A client which only reads stays connected as long as it answers pings.
+ * The client is pinged once it's quiet for HEARTBEAT_INTERVAL_MILLIS, and its connection is shut
+ * down if it doesn't answer within HEARTBEAT_TIMEOUT_MILLIS.
+ * The client thread is expected to update client->lastActivity when it receives a packet.
+ *
+ * \param client The client to supervise
+ */
+void timeouts_watchClient(Client* client);
+
+/**
+ * \brief Stops supervising the given client and all its uploads.
+ *
+ * Once this function returns, no timer callback uses the client anymore.
+ * It MUST NOT be called while holding the transferLock of the client transfers.
+ *
+ * \param client The client to stop supervising
+ */
+void timeouts_unwatchClient(Client* client);
+
+/**
+ * \brief Prepares the timers of the uploads of the given client, once its transfers were allocated.
+ *
+ * \param client The client which transfers were allocated
+ */
+void timeouts_watchTransfers(Client* client);
+
+/**
+ * \brief Stops supervising the uploads of the given client, before its transfers are released.
+ *
+ * It MUST NOT be called while holding the transferLock of the client transfers.
+ *
+ * \param client The client which transfers are about to be released
+ */
+void timeouts_unwatchTransfers(Client* client);
+
+/**
+ * \brief Starts supervising the upload in the given slot.
+ *
+ * The upload is aborted if no data is received during FILE_TRANSFER_STALL_TIMEOUT_MILLIS.
+ * The client thread is expected to update lastChunkTime of the upload when it receives data.
+ * Once the upload is over, the timer just expires without effect.
+ *
+ * \param client The uploading client
+ * \param uploadId The upload slot
+ */
+void timeouts_watchUpload(Client* client, int uploadId);
+
+/**
+ * \brief Processes a received PacketPong, updating the client round-trip time estimation
+ *
+ * \param client The client who sent the packet
+ * \param packet The received packet
+ */
+void handlePong(Client* client, struct PacketPong* packet);
+
+/**
+ * \brief Retrieves the timer wheel of the server, allowing other systems to schedule tasks.
+ *
+ * \return the server timer wheel
+ */
+TimerWheel* timeouts_getWheel();
+
+#endif //C_CHAT_TIMEOUTS_H
@@ -0,0 +1,318 @@
+#include "transfer-scheduler.h"
+#include <stdio.h>
+#include <string.h>
+#include "file-transfer.h"
+#include "upload-budget.h"
+#include "communication.h"
+
+/** Protects the whole scheduler and the pending requests of clients. Taken before the transfer lock of a client */
+static Mutex schedulerLock;
+/** Amount of running transfers */
+static unsigned int running = 0;
+/** Clients with waiting requests, in the order they are served */
+static Client* waiting[NUMBER_CLIENT_MAX];
+static unsigned int waitingCount = 0;
+/** Index in waiting of the next client to serve */
+static unsigned int cursor = 0;
+/** Client whose oldest request is an upload waiting for memory, if any */
+static Client* memoryWaiter = NULL;
+
+/**
+ * \brief An upload given a slot by schedule, set up by the starter thread
+ */
+typedef struct ScheduledUpload {
+    Client* client;
+    int uploadId;
+    TransferRequest request;
+} ScheduledUpload;
+
+/** Uploads given a slot and not set up yet. Each holds a running slot, so there are at most TRANSFER_SLOTS */
+static ScheduledUpload scheduledUploads[TRANSFER_SLOTS];
+static unsigned int scheduledCount = 0;
+/** Signaled once uploads are scheduled */
+static Event uploadsScheduled;
+static Thread starterThread;
+
+/**
+ * \brief Sets the uploads given a slot by schedule up. schedulerLock MUST NOT be held.
+ */
+void startScheduledUploads(const ScheduledUpload* uploads, unsigned int count) {
+    for (unsigned int i = 0; i < count; i++) {
+        startUpload(uploads[i].client, uploads[i].uploadId, &uploads[i].request);
+        /* The client may be forgotten as soon as none of its uploads is being set up */
+        atomics_fetchAdd(&uploads[i].client->transfers->startingUploads, (unsigned int) -1);
+    }
+}
+
+/**
+ * \brief Sets scheduled uploads up, off the threads freeing slots : it allocates their content and may read a file.
+ */
+THREAD_ENTRY_POINT uploadStarter(void* data) {
+    ScheduledUpload uploads[TRANSFER_SLOTS];
+    (void) data;
+
+    while (1) {
+        waitEvent(uploadsScheduled);
+
+        acquireMutex(&schedulerLock);
+        unsigned int count = scheduledCount;
+        memcpy(uploads, scheduledUploads, count * sizeof(ScheduledUpload));
+        scheduledCount = 0;
+        releaseMutex(&schedulerLock);
+
+        startScheduledUploads(uploads, count);
+    }
+}
+
+void transferScheduler_init() {
+    initMutex(&schedulerLock);
+    uploadsScheduled = createEvent();
+    starterThread = createThread(uploadStarter, NULL);
+}
+
+void transferScheduler_cleanUp() {
+    destroyThread(&starterThread);
+    acquireMutex(&schedulerLock);
+    waitingCount = 0;
+    scheduledCount = 0;
+    memoryWaiter = NULL;
+    releaseMutex(&schedulerLock);
+    destroyEvent(uploadsScheduled);
+}
+
+/**
+ * \brief Starts the oldest request of the given client if possible. schedulerLock MUST be held.
+ *
+ * \return the slot of the started request, or -1 if it can't start yet
+ */
+int startOldestRequest(Client* client) {
+    TransferRequest* request = &client->transfers->pending[0];
+    if (request->kind == TRANSFER_DOWNLOAD) {
+        return startTransfer(client, request);
+    }
+
+    if (memoryWaiter != NULL && memoryWaiter != client) {
+        return -1;
+    }
+
+    if (!uploadBudget_tryCommit(request->fileSize)) {
+        memoryWaiter = client;
+        return -1;
+    }
+
+    int uploadId = startTransfer(client, request);
+    if (uploadId == -1) {
+        /* The client is already uploading, it keeps its turn for memory if it was waiting */
+        uploadBudget_release(request->fileSize);
+        return -1;
+    }
+
+    memoryWaiter = NULL;
+    return uploadId;
+}
+
+/**
+ * \brief Removes the client at the given index of the waiting clients. schedulerLock MUST be held.
+ */
+void removeWaiting(unsigned int index) {
+    for (unsigned int i = index; i + 1 < waitingCount; i++) {
+        waiting[i] = waiting[i + 1];
+    }
+    waitingCount--;
+
+    /* The next client moved to the index of the removed one */
+    if (index < cursor) {
+        cursor--;
+    }
+}
+
+/**
+ * \brief Starts waiting requests while slots are available, one client at a time. schedulerLock MUST be held.
+ *
+ * Uploads are only given their slot, they are handed to the starter thread to be set up.
+ */
+void schedule() {
+    unsigned int uploadCount = 0;
+    /* Stops once a whole round of clients couldn't start anything */
+    unsigned int idle = 0;
+    while (running < TRANSFER_SLOTS && waitingCount > 0 && idle < waitingCount) {
+        if (cursor >= waitingCount) {
+            cursor = 0;
+        }
+
+        Client* client = waiting[cursor];
+        int slot = startOldestRequest(client);
+        if (slot == -1) {
+            idle++;
+            cursor++;
+            continue;
+        }
+
+        running++;
+        idle = 0;
+
+        ClientTransfers* transfers = client->transfers;
+        if (transfers->pending[0].kind == TRANSFER_UPLOAD) {
+            scheduledUploads[scheduledCount].client = client;
+            scheduledUploads[scheduledCount].uploadId = slot;
+            scheduledUploads[scheduledCount].request = transfers->pending[0];
+            scheduledCount++;
+            uploadCount++;
+            atomics_fetchAdd(&transfers->startingUploads, 1);
+        }
+        transfers->pendingCount--;
+        for (unsigned int i = 0; i < transfers->pendingCount; i++) {
+            transfers->pending[i] = transfers->pending[i + 1];
+        }
+
+        if (transfers->pendingCount == 0) {
+            removeWaiting(cursor);
+        } else {
+            cursor++;
+        }
+    }
+
+    if (uploadCount > 0) {
+        signalEvent(uploadsScheduled);
+    }
+}
+
+/**
+ * \brief Estimates the position of the given waiting request in the queue. schedulerLock MUST be held.
+ *
+ * Each round serves one request per client, so the requests of other clients started before this
+ * one are at most as many as the rounds it waits for.
+ *
+ * \param client The client owning the request
+ * \param index The index of the request in the pending requests of the client
+ * \return the 1-based position of the request
+ */
+unsigned int estimatePosition(Client* client, unsigned int index) {
+    unsigned int rounds = index + 1;
+    unsigned int position = rounds;
+    for (unsigned int i = 0; i < waitingCount; i++) {
+        if (waiting[i] != client) {
+            unsigned int pending = waiting[i]->transfers->pendingCount;
+            position += pending < rounds ? pending : rounds;
+        }
+    }
+
+    return position;
+}
+
+int transferScheduler_submit(Client* client, const TransferRequest* request) {
+    ClientTransfers* transfers = client->transfers;
+
+    acquireMutex(&schedulerLock);
+    if (transfers->pendingCount == TRANSFER_QUEUE_PER_CLIENT) {
+        releaseMutex(&schedulerLock);
+        return 0;
+    }
+
+    transfers->pending[transfers->pendingCount] = *request;
+    transfers->pendingCount++;
+    if (transfers->pendingCount == 1) {
+        waiting[waitingCount] = client;
+        waitingCount++;
+    }
+
+    schedule();
+
+    /* Requests of a client start in order : the newest one is waiting as long as any is */
+    if (transfers->pendingCount > 0) {
+        /* Sent while holding the lock, so the client is told before the transfer starts */
+        Packet queuedPacket = NewPacketServerSuccess;
+        sprintf(
+            queuedPacket.asServerSuccessMessagePacket.message,
+            "Transfer queued, position %u.",
+            estimatePosition(client, transfers->pendingCount - 1)
+        );
+        sendToClient(client, &queuedPacket);
+    }
+    releaseMutex(&schedulerLock);
+
+    return 1;
+}
+
+void transferScheduler_finished(char kind, long long fileSize) {
+    acquireMutex(&schedulerLock);
+    running--;
+    if (kind == TRANSFER_UPLOAD) {
+        uploadBudget_release(fileSize);
+    }
+    schedule();
+    releaseMutex(&schedulerLock);
+}
+
+int transferScheduler_hasPending(Client* client) {
+    acquireMutex(&schedulerLock);
+    int pending = client->transfers->pendingCount > 0;
+    releaseMutex(&schedulerLock);
+
+    return pending;
+}
+
+void transferScheduler_forget(Client* client) {
+    if (client->transfers == NULL) {
+        /* The client never requested a transfer */
+        return;
+    }
+
+    acquireMutex(&schedulerLock);
+    for (unsigned int i = 0; i < waitingCount; i++) {
+        if (waiting[i] == client) {
+            removeWaiting(i);
+            break;
+        }
+    }
+    client->transfers->pendingCount = 0;
+
+    if (memoryWaiter == client) {
+        /* Uploads of other clients may fit now */
+        memoryWaiter = NULL;
+        schedule();
+    }
+    releaseMutex(&schedulerLock);
+
+    /* Not waiting anymore, the client can't be given new uploads : the ones already given a slot are waited for */
+    while (atomics_load(&client->transfers->startingUploads) > 0) {
+        threadSleep(1);
+    }
+}
+
+void transferScheduler_cancelDownloads(Client* client, unsigned int fileId) {
+    ClientTransfers* transfers = client->transfers;
+
+    acquireMutex(&schedulerLock);
+    unsigned int kept = 0;
+    for (unsigned int i = 0; i < transfers->pendingCount; i++) {
+        if (transfers->pending[i].kind != TRANSFER_DOWNLOAD || transfers->pending[i].fileId != fileId) {
+            transfers->pending[kept] = transfers->pending[i];
+            kept++;
+        }
+    }
+
+    if (kept == 0 && transfers->pendingCount > 0) {
+        for (unsigned int i = 0; i < waitingCount; i++) {
+            if (waiting[i] == client) {
+                removeWaiting(i);
+                break;
+            }
+        }
+    }
+    transfers->pendingCount = kept;
+
+    stopDownloadStreams(client, fileId);
+    releaseMutex(&schedulerLock);
+}
+
+void transferScheduler_stats(TransferSchedulerStats* stats) {
+    acquireMutex(&schedulerLock);
+    stats->running = running;
+    stats->waitingClients = waitingCount;
+    stats->queued = 0;
+    for (unsigned int i = 0; i < waitingCount; i++) {
+        stats->queued += waiting[i]->transfers->pendingCount;
+    }
+    releaseMutex(&schedulerLock);
+}
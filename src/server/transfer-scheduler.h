@@ -0,0 +1,103 @@
+/**
+ * \file transfer-scheduler.h
+ * \brief Shares the transfer capacity of the server fairly between clients.
+ *
+ * At most TRANSFER_SLOTS uploads and downloads run at once across all clients, each client being
+ * limited to MAX_CONCURRENT_FILE_TRANSFER of each kind. Requests which can't start right away
+ * wait in a queue of their client, holding up to TRANSFER_QUEUE_PER_CLIENT requests.
+ *
+ * Clients with waiting requests are served round-robin : each round starts at most one request
+ * per client, so a client queuing many transfers doesn't delay the others more than a client
+ * queuing a single one. A client's requests start in the order they were made.
+ *
+ * Uploads also need their size to fit in the upload budget (see upload-budget.h). Once an upload
+ * waits for memory, no other upload is given memory before it, so large uploads aren't starved.
+ */
+
+#ifndef C_CHAT_TRANSFER_SCHEDULER_H
+#define C_CHAT_TRANSFER_SCHEDULER_H
+
+#include "server.h"
+
+/**
+ * \brief Usage of the transfer capacity
+ */
+typedef struct TransferSchedulerStats {
+    /** Amount of running transfers */
+    unsigned int running;
+    /** Amount of requests waiting to be started */
+    unsigned int queued;
+    /** Amount of clients with waiting requests */
+    unsigned int waitingClients;
+} TransferSchedulerStats;
+
+/**
+ * \brief Initializes the transfer scheduler and starts the thread setting scheduled uploads up.
+ */
+void transferScheduler_init();
+
+/**
+ * \brief Stops the thread setting scheduled uploads up and drops the waiting requests, when the server closes.
+ */
+void transferScheduler_cleanUp();
+
+/**
+ * \brief Queues a transfer request of the given client, starting it if possible.
+ *
+ * Called by the client thread, once the transfers of the client are allocated. Transfers are
+ * started by startTransfer, from the thread calling this function or transferScheduler_finished.
+ * Uploads are set up by startUpload on the starter thread of the scheduler, as it allocates their
+ * content and may read a file : the threads freeing slots, like the timers one, never do it.
+ * If the request has to wait, the client is told its estimated position in the queue.
+ *
+ * \param client The client requesting the transfer
+ * \param request The transfer to start
+ * \return 1 if the request was started or queued, 0 if the queue of the client is full
+ */
+int transferScheduler_submit(Client* client, const TransferRequest* request);
+
+/**
+ * \brief Frees the slot of a transfer which finished or was aborted, starting waiting requests.
+ *
+ * The transfer lock of the client MUST NOT be held, it's taken to start transfers. Uploads given
+ * the slot are set up later by the starter thread, so it's fine to call it from the timers thread.
+ *
+ * \param kind TRANSFER_UPLOAD or TRANSFER_DOWNLOAD
+ * \param fileSize The size of the transferred file, released from the upload budget for uploads
+ */
+void transferScheduler_finished(char kind, long long fileSize);
+
+/**
+ * \brief Checks whether the given client has requests waiting to be started.
+ *
+ * \param client The client to check
+ * \return 1 if requests of the client are waiting, else 0
+ */
+int transferScheduler_hasPending(Client* client);
+
+/**
+ * \brief Drops the waiting requests of the given client.
+ *
+ * Once it returns, no transfer of the client is being started anymore. It MUST be called before
+ * the timers of the client are stopped and its outbound path destroyed.
+ *
+ * \param client The client to forget
+ */
+void transferScheduler_forget(Client* client);
+
+/**
+ * \brief Drops the waiting downloads of the given file by the given client, and stops the running ones.
+ *
+ * \param client The client downloading the file
+ * \param fileId The file the client doesn't want anymore
+ */
+void transferScheduler_cancelDownloads(Client* client, unsigned int fileId);
+
+/**
+ * \brief Retrieves the usage of the transfer capacity.
+ *
+ * \param stats The structure to fill
+ */
+void transferScheduler_stats(TransferSchedulerStats* stats);
+
+#endif //C_CHAT_TRANSFER_SCHEDULER_H
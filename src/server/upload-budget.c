@@ -0,0 +1,35 @@
+#include "upload-budget.h"
+
+/** Protects committed */
+static Mutex budgetLock;
+/** Bytes committed to running uploads */
+static long long committed = 0;
+
+void uploadBudget_init() {
+    initMutex(&budgetLock);
+}
+
+int uploadBudget_tryCommit(long long fileSize) {
+    acquireMutex(&budgetLock);
+    int fits = committed + fileSize <= UPLOAD_MEMORY_BUDGET;
+    if (fits) {
+        committed += fileSize;
+    }
+    releaseMutex(&budgetLock);
+
+    return fits;
+}
+
+void uploadBudget_release(long long fileSize) {
+    acquireMutex(&budgetLock);
+    committed -= fileSize;
+    releaseMutex(&budgetLock);
+}
+
+long long uploadBudget_committed() {
+    acquireMutex(&budgetLock);
+    long long bytes = committed;
+    releaseMutex(&budgetLock);
+
+    return bytes;
+}
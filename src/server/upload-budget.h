@@ -0,0 +1,42 @@
+/**
+ * \file upload-budget.h
+ * \brief Bounds the memory committed to uploads across all clients.
+ *
+ * Uploads are buffered in memory until complete, so each running upload commits its whole
+ * size. The committed total never exceeds UPLOAD_MEMORY_BUDGET : uploads which don't fit wait
+ * in the transfer scheduler (see transfer-scheduler.h) until enough memory is released.
+ */
+
+#ifndef C_CHAT_UPLOAD_BUDGET_H
+#define C_CHAT_UPLOAD_BUDGET_H
+
+#include "server.h"
+
+/**
+ * \brief Initializes the upload budget.
+ */
+void uploadBudget_init();
+
+/**
+ * \brief Commits the given amount of bytes for an upload, if they fit in the budget.
+ *
+ * \param fileSize The size of the file to upload
+ * \return 1 if the bytes were committed, 0 if they don't fit
+ */
+int uploadBudget_tryCommit(long long fileSize);
+
+/**
+ * \brief Releases bytes committed to an upload which finished or was aborted.
+ *
+ * \param fileSize The size of the file which was uploaded
+ */
+void uploadBudget_release(long long fileSize);
+
+/**
+ * \brief Retrieves the amount of bytes committed to running uploads.
+ *
+ * \return the committed bytes
+ */
+long long uploadBudget_committed();
+
+#endif //C_CHAT_UPLOAD_BUDGET_H
@@ -0,0 +1,143 @@
+#include "upload-resume.h"
+#include <stdio.h>
+#include <stdint.h>
+#include "../common/files.h"
+#include "../common/adaptive-lock.h"
+#include "../common/timers.h"
+
+/**
+ * \brief An interrupted upload, whose received part is on disk
+ */
+struct ParkedUpload {
+    unsigned long long token;
+    unsigned int fileId;
+    long long fileSize;
+    long long received;
+    /** Time the upload was interrupted (see timers_now) */
+    unsigned long long parkTime;
+};
+
+/** Parked uploads, oldest first. Protected by parkedLock */
+static struct ParkedUpload parkedUploads[PARKED_UPLOADS_MAX];
+static unsigned int parkedCount = 0;
+/** State of the token generator, protected by parkedLock */
+static unsigned long long tokenState = 0;
+static AdaptiveLock parkedLock = ADAPTIVE_LOCK_INITIALIZER;
+
+/**
+ * \brief Formats the name of the file holding the received part of the given upload.
+ */
+void formatPartName(unsigned int fileId, char* buffer) {
+    sprintf(buffer, "%u.part", fileId);
+}
+
+/**
+ * \brief Removes the parked upload at the given index, deleting its part. parkedLock MUST be held.
+ */
+void dropParked(unsigned int index) {
+    char filename[17];
+    formatPartName(parkedUploads[index].fileId, filename);
+    files_deleteFile(filename);
+
+    for (unsigned int i = index; i + 1 < parkedCount; i++) {
+        parkedUploads[i] = parkedUploads[i + 1];
+    }
+    parkedCount--;
+}
+
+/**
+ * \brief Drops the parked uploads which can't be resumed anymore. parkedLock MUST be held.
+ */
+void dropExpired() {
+    unsigned long long now = timers_now();
+    while (parkedCount > 0 && now - parkedUploads[0].parkTime >= RESUME_GRACE_MILLIS) {
+        dropParked(0);
+    }
+}
+
+unsigned long long uploadResume_newToken() {
+    adaptiveLock_acquire(&parkedLock);
+    if (tokenState == 0) {
+        tokenState = timers_nowMicros() ^ (unsigned long long) (uintptr_t) &tokenState;
+    }
+
+    /* SplitMix64 : consecutive tokens look unrelated */
+    unsigned long long token;
+    do {
+        tokenState += 0x9E3779B97F4A7C15ULL;
+        token = tokenState;
+        token = (token ^ (token >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        token = (token ^ (token >> 27)) * 0x94D049BB133111EBULL;
+        token ^= token >> 31;
+    } while (token == 0);
+    adaptiveLock_release(&parkedLock);
+
+    return token;
+}
+
+void uploadResume_park(unsigned long long token, unsigned int fileId, long long fileSize, const char* content, long long received) {
+    if (received == 0) {
+        return;
+    }
+
+    /* Written before the upload can be claimed, without holding the lock */
+    char filename[17];
+    formatPartName(fileId, filename);
+    if (files_writeFile(filename, content, received) != (unsigned long) received) {
+        printf("Unable to keep the interrupted upload of file %u.\n", fileId);
+        return;
+    }
+
+    adaptiveLock_acquire(&parkedLock);
+    dropExpired();
+    if (parkedCount == PARKED_UPLOADS_MAX) {
+        dropParked(0);
+    }
+
+    struct ParkedUpload* parked = &parkedUploads[parkedCount];
+    parked->token = token;
+    parked->fileId = fileId;
+    parked->fileSize = fileSize;
+    parked->received = received;
+    parked->parkTime = timers_now();
+    parkedCount++;
+    adaptiveLock_release(&parkedLock);
+}
+
+int uploadResume_claim(unsigned long long token, long long fileSize, unsigned int* fileId, char* content, long long* received) {
+    struct ParkedUpload claimed;
+    int found = 0;
+
+    adaptiveLock_acquire(&parkedLock);
+    dropExpired();
+    for (unsigned int i = 0; i < parkedCount; i++) {
+        if (parkedUploads[i].token == token && parkedUploads[i].fileSize == fileSize) {
+            claimed = parkedUploads[i];
+            found = 1;
+
+            /* The part is read below, it's only removed from the parked uploads */
+            for (unsigned int j = i; j + 1 < parkedCount; j++) {
+                parkedUploads[j] = parkedUploads[j + 1];
+            }
+            parkedCount--;
+            break;
+        }
+    }
+    adaptiveLock_release(&parkedLock);
+
+    if (!found) {
+        return 0;
+    }
+
+    char filename[17];
+    formatPartName(claimed.fileId, filename);
+    int complete = files_readFile(filename, content, claimed.received) == (unsigned long) claimed.received;
+    files_deleteFile(filename);
+    if (!complete) {
+        return 0;
+    }
+
+    *fileId = claimed.fileId;
+    *received = claimed.received;
+    return 1;
+}
@@ -0,0 +1,53 @@
+/**
+ * \file upload-resume.h
+ * \brief Keeps the uploads interrupted by a disconnection, so they can be resumed.
+ *
+ * Each upload is given a token, sent in its validation. When the client disconnects, the bytes
+ * received so far are written to disk, in a file named after the file id with a ".part"
+ * extension, and their memory is released. Within RESUME_GRACE_MILLIS, an upload request of a
+ * file with the same size and the token resumes the upload from the received bytes. The checksum
+ * the client sends after the data covers the resumed bytes as well : a file changed meanwhile
+ * isn't kept.
+ *
+ * Expired parts are deleted the next time an upload is parked or resumed. Tokens are hard to
+ * guess by accident, but aren't meant to resist a determined attacker.
+ */
+
+#ifndef C_CHAT_UPLOAD_RESUME_H
+#define C_CHAT_UPLOAD_RESUME_H
+
+#include "server.h"
+
+/**
+ * \brief Generates a token for a new upload.
+ *
+ * \return a non-zero token
+ */
+unsigned long long uploadResume_newToken();
+
+/**
+ * \brief Writes the received part of an interrupted upload to disk, so it can be resumed.
+ *
+ * Nothing is kept if no byte was received yet.
+ *
+ * \param token The token of the upload
+ * \param fileId The file id of the upload
+ * \param fileSize The size of the whole file
+ * \param content The bytes received so far
+ * \param received The amount of bytes received so far
+ */
+void uploadResume_park(unsigned long long token, unsigned int fileId, long long fileSize, const char* content, long long received);
+
+/**
+ * \brief Retrieves the received part of an interrupted upload, which can't be resumed again.
+ *
+ * \param token The token of the upload
+ * \param fileSize The size of the whole file, which must be the one of the interrupted upload
+ * \param fileId Filled with the file id of the upload
+ * \param content A buffer of fileSize bytes, filled with the bytes received so far
+ * \param received Filled with the amount of bytes received so far
+ * \return 1 if the upload was resumed, 0 if there is no such upload or it expired
+ */
+int uploadResume_claim(unsigned long long token, long long fileSize, unsigned int* fileId, char* content, long long* received);
+
+#endif //C_CHAT_UPLOAD_RESUME_H